@@ -353,6 +353,10 @@ public:
                 [&](Expression *expr) { ENFORCE(false, "Unexpected node type in argument position."); });
         }
     }
+
+    static const class Local *arg2Local(const Expression *arg) {
+        return arg2Local(const_cast<Expression *>(arg));
+    }
 };
 
 } // namespace sorbet::ast
@@ -42,6 +42,8 @@ using namespace std;
 
 namespace sorbet::ast {
 
+thread_local Arena *Expression::arena = nullptr;
+
 /** https://git.corp.stripe.com/gist/nelhage/51564501674174da24822e60ad770f64
  *
  *  [] - prototype only
@@ -451,6 +453,7 @@ string MethodDef::showRaw(const core::GlobalState &gs, int tabs) {
     const pair<int, string_view> flags[] = {
         {SelfMethod, "self"sv},
         {DSLSynthesized, "dsl"sv},
+        {BodySkipped, "bodySkipped"sv},
     };
     for (auto &ent : flags) {
         if ((this->flags & ent.first) != 0) {
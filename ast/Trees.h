@@ -1,6 +1,7 @@
 #ifndef SORBET_TREES_H
 #define SORBET_TREES_H
 
+#include "common/Arena.h"
 #include "common/common.h"
 #include "core/Context.h"
 #include "core/LocalVariable.h"
@@ -48,6 +49,15 @@ public:
     virtual std::unique_ptr<Expression> _deepCopy(const Expression *avoid, bool root = false) const = 0;
 
     bool isSelfReference() const;
+
+    // The arena that nodes allocated on this thread come from, while an `Arena::Scope` over it is open.
+    static thread_local Arena *arena;
+    static void *operator new(size_t size) {
+        return Arena::allocate(arena, size);
+    }
+    static void operator delete(void *ptr) {
+        Arena::deallocate(ptr);
+    }
 };
 // CheckSize(Expression, 16, 8);
 
@@ -133,6 +143,8 @@ public:
     enum Flags {
         SelfMethod = 1,
         DSLSynthesized = 2,
+        // The body was not desugared. `loc` still spans the whole definition, so it can be parsed again from there.
+        BodySkipped = 4,
     };
 
     MethodDef(core::Loc loc, core::Loc declLoc, core::SymbolRef symbol, core::NameRef name, ARGS_store args,
@@ -150,6 +162,10 @@ public:
         return (flags & DSLSynthesized) != 0;
     }
 
+    bool isBodySkipped() const {
+        return (flags & BodySkipped) != 0;
+    }
+
 private:
     virtual void _sanityCheck();
 };
@@ -23,11 +23,13 @@ struct DesugarContext final {
     core::NameRef enclosingBlockArg;
     core::Loc enclosingMethodLoc;
     core::NameRef enclosingMethodName;
+    bool skipMethodBodies;
 
     DesugarContext(core::MutableContext ctx, u2 &uniqueCounter, core::NameRef enclosingBlockArg,
-                   core::Loc enclosingMethodLoc, core::NameRef enclosingMethodName)
+                   core::Loc enclosingMethodLoc, core::NameRef enclosingMethodName, bool skipMethodBodies)
         : ctx(ctx), uniqueCounter(uniqueCounter), enclosingBlockArg(enclosingBlockArg),
-          enclosingMethodLoc(enclosingMethodLoc), enclosingMethodName(enclosingMethodName){};
+          enclosingMethodLoc(enclosingMethodLoc), enclosingMethodName(enclosingMethodName),
+          skipMethodBodies(skipMethodBodies){};
 };
 
 core::NameRef blockArg2Name(DesugarContext dctx, const BlockArg &blkArg) {
@@ -199,7 +201,7 @@ unique_ptr<MethodDef> buildMethod(DesugarContext dctx, core::Loc loc, core::Loc
                                   unique_ptr<parser::Node> &argnode, unique_ptr<parser::Node> &body, bool isSelf) {
     // Reset uniqueCounter within this scope (to keep numbers small)
     u2 uniqueCounter = 1;
-    DesugarContext dctx1(dctx.ctx, uniqueCounter, dctx.enclosingBlockArg, declLoc, name);
+    DesugarContext dctx1(dctx.ctx, uniqueCounter, dctx.enclosingBlockArg, declLoc, name, dctx.skipMethodBodies);
     auto [args, destructures] = desugarArgs(dctx1, loc, argnode);
 
     if (args.empty() || !isa_tree<BlockArg>(args.back().get())) {
@@ -211,7 +213,17 @@ unique_ptr<MethodDef> buildMethod(DesugarContext dctx, core::Loc loc, core::Loc
     ENFORCE(blkArg != nullptr, "Every method's last arg must be a block arg by now.");
     auto enclosingBlockArg = blockArg2Name(dctx, *blkArg);
 
-    DesugarContext dctx2(dctx1.ctx, dctx1.uniqueCounter, enclosingBlockArg, declLoc, name);
+    // `initialize` is kept, since it declares the instance variables of its class.
+    if (dctx.skipMethodBodies && name != core::Names::initialize() && body != nullptr) {
+        auto mdef = MK::Method(loc, declLoc, name, std::move(args), MK::EmptyTree());
+        mdef->flags |= MethodDef::BodySkipped;
+        if (isSelf) {
+            mdef->flags |= MethodDef::SelfMethod;
+        }
+        return mdef;
+    }
+
+    DesugarContext dctx2(dctx1.ctx, dctx1.uniqueCounter, enclosingBlockArg, declLoc, name, dctx.skipMethodBodies);
     unique_ptr<Expression> desugaredBody = desugarBody(dctx2, loc, body, std::move(destructures));
     desugaredBody = validateRBIBody(dctx, move(desugaredBody));
 
@@ -321,7 +333,7 @@ ClassDef::RHS_store scopeNodeToBody(DesugarContext dctx, unique_ptr<parser::Node
     // Reset uniqueCounter within this scope (to keep numbers small)
     u2 uniqueCounter = 1;
     DesugarContext dctx1(dctx.ctx, uniqueCounter, dctx.enclosingBlockArg, dctx.enclosingMethodLoc,
-                         dctx.enclosingMethodName);
+                         dctx.enclosingMethodName, dctx.skipMethodBodies);
     if (auto *begin = parser::cast_node<parser::Begin>(node.get())) {
         body.reserve(begin->stmts.size());
         for (auto &stat : begin->stmts) {
@@ -1716,11 +1728,12 @@ unique_ptr<Expression> liftTopLevel(DesugarContext dctx, core::Loc loc, unique_p
 }
 } // namespace
 
-unique_ptr<Expression> node2Tree(core::MutableContext ctx, unique_ptr<parser::Node> what) {
+unique_ptr<Expression> node2Tree(core::MutableContext ctx, unique_ptr<parser::Node> what, bool skipMethodBodies) {
     try {
         u2 uniqueCounter = 1;
         // We don't have an enclosing block arg to start off.
-        DesugarContext dctx(ctx, uniqueCounter, core::NameRef::noName(), core::Loc::none(), core::NameRef::noName());
+        DesugarContext dctx(ctx, uniqueCounter, core::NameRef::noName(), core::Loc::none(), core::NameRef::noName(),
+                            skipMethodBodies);
         auto loc = what->loc;
         auto result = node2TreeImpl(dctx, std::move(what));
         result = liftTopLevel(dctx, loc, std::move(result));
@@ -7,7 +7,10 @@
 
 namespace sorbet::ast::desugar {
 
-std::unique_ptr<Expression> node2Tree(core::MutableContext ctx, std::unique_ptr<parser::Node> what);
+// With `skipMethodBodies`, the bodies of methods other than `initialize` are left out, and their MethodDefs are
+// marked BodySkipped. Only their arguments are desugared, which is all that naming and resolving need of them.
+std::unique_ptr<Expression> node2Tree(core::MutableContext ctx, std::unique_ptr<parser::Node> what,
+                                      bool skipMethodBodies = false);
 } // namespace sorbet::ast::desugar
 
 #endif // SORBET_DESUGAR_H
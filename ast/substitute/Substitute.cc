@@ -6,9 +6,24 @@
 namespace sorbet::ast {
 
 namespace {
-class SubstWalk {
+// Only remembers which names it saw, so that SubstWalk can be used to find the names a tree refers to.
+class NameMarker {
+    std::vector<bool> &used;
+
+public:
+    NameMarker(std::vector<bool> &used) : used(used) {}
+
+    core::NameRef substitute(core::NameRef from, bool allowSameFromTo = false) const {
+        if (from.exists() && from.id() < used.size()) {
+            used[from.id()] = true;
+        }
+        return from;
+    }
+};
+
+template <class Subst> class SubstWalk {
 private:
-    const core::GlobalSubstitution &subst;
+    const Subst &subst;
 
     unique_ptr<Expression> substClassName(core::MutableContext ctx, unique_ptr<Expression> node) {
         auto constLit = cast_tree<UnresolvedConstantLit>(node.get());
@@ -42,7 +57,7 @@ private:
     }
 
 public:
-    SubstWalk(const core::GlobalSubstitution &subst) : subst(subst) {}
+    SubstWalk(const Subst &subst) : subst(subst) {}
 
     unique_ptr<ClassDef> preTransformClassDef(core::MutableContext ctx, unique_ptr<ClassDef> original) {
         original->name = substClassName(ctx, move(original->name));
@@ -123,7 +138,15 @@ unique_ptr<Expression> Substitute::run(core::MutableContext ctx, const core::Glo
     if (subst.useFastPath()) {
         return what;
     }
-    SubstWalk walk(subst);
+    SubstWalk<core::GlobalSubstitution> walk(subst);
+    what = TreeMap::apply(ctx, walk, move(what));
+    return what;
+}
+
+unique_ptr<Expression> Substitute::markNames(core::MutableContext ctx, std::vector<bool> &used,
+                                             unique_ptr<Expression> what) {
+    NameMarker marker(used);
+    SubstWalk<NameMarker> walk(marker);
     what = TreeMap::apply(ctx, walk, move(what));
     return what;
 }
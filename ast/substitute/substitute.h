@@ -9,6 +9,10 @@ class Substitute {
 public:
     static std::unique_ptr<Expression> run(core::MutableContext ctx, const core::GlobalSubstitution &subst,
                                            std::unique_ptr<Expression> what);
+
+    // Sets `used[name.id()]` for every name in `what` that `run` would substitute.
+    static std::unique_ptr<Expression> markNames(core::MutableContext ctx, std::vector<bool> &used,
+                                                 std::unique_ptr<Expression> what);
 };
 } // namespace sorbet::ast
 #endif // SORBET_SUBSTITUTE_H
@@ -151,6 +151,48 @@ GENERATE_HAS_MEMBER(postTransformBlock);
 GENERATE_HAS_MEMBER(postTransformInsSeq);
 GENERATE_HAS_MEMBER(postTransformCast);
 
+GENERATE_HAS_MEMBER(preWalkExpression);
+GENERATE_HAS_MEMBER(preWalkClassDef);
+GENERATE_HAS_MEMBER(preWalkMethodDef);
+GENERATE_HAS_MEMBER(preWalkIf);
+GENERATE_HAS_MEMBER(preWalkWhile);
+GENERATE_HAS_MEMBER(preWalkBreak);
+GENERATE_HAS_MEMBER(preWalkNext);
+GENERATE_HAS_MEMBER(preWalkReturn);
+GENERATE_HAS_MEMBER(preWalkRescueCase);
+GENERATE_HAS_MEMBER(preWalkRescue);
+GENERATE_HAS_MEMBER(preWalkAssign);
+GENERATE_HAS_MEMBER(preWalkSend);
+GENERATE_HAS_MEMBER(preWalkHash);
+GENERATE_HAS_MEMBER(preWalkArray);
+GENERATE_HAS_MEMBER(preWalkBlock);
+GENERATE_HAS_MEMBER(preWalkInsSeq);
+GENERATE_HAS_MEMBER(preWalkCast);
+
+GENERATE_HAS_MEMBER(postWalkClassDef);
+GENERATE_HAS_MEMBER(postWalkMethodDef);
+GENERATE_HAS_MEMBER(postWalkIf);
+GENERATE_HAS_MEMBER(postWalkWhile);
+GENERATE_HAS_MEMBER(postWalkBreak);
+GENERATE_HAS_MEMBER(postWalkRetry);
+GENERATE_HAS_MEMBER(postWalkNext);
+GENERATE_HAS_MEMBER(postWalkReturn);
+GENERATE_HAS_MEMBER(postWalkRescueCase);
+GENERATE_HAS_MEMBER(postWalkRescue);
+GENERATE_HAS_MEMBER(postWalkField);
+GENERATE_HAS_MEMBER(postWalkUnresolvedIdent);
+GENERATE_HAS_MEMBER(postWalkAssign);
+GENERATE_HAS_MEMBER(postWalkSend);
+GENERATE_HAS_MEMBER(postWalkHash);
+GENERATE_HAS_MEMBER(postWalkArray);
+GENERATE_HAS_MEMBER(postWalkLiteral);
+GENERATE_HAS_MEMBER(postWalkUnresolvedConstantLit);
+GENERATE_HAS_MEMBER(postWalkConstantLit);
+GENERATE_HAS_MEMBER(postWalkBlock);
+GENERATE_HAS_MEMBER(postWalkInsSeq);
+GENERATE_HAS_MEMBER(postWalkLocal);
+GENERATE_HAS_MEMBER(postWalkCast);
+
 #define GENERATE_POSTPONE_PRECLASS(X)                                                   \
                                                                                         \
     template <class FUNC, class CTX, bool has> class PostPonePreTransform_##X {         \
@@ -719,6 +761,522 @@ public:
         }
     }
 };
+
+/**
+ * Given a tree visitor FUNC, walk a tree without changing it. This is for analyses, which TreeMap would make move
+ * every node out of the tree and back in.
+ *
+ * Nodes are visited in the same order and with the same context as TreeMap visits them. FUNC has the members it
+ * needs out of
+ *
+ *   void preWalkExpression(CTX ctx, const Expression &original);
+ *   void preWalk<Node>(CTX ctx, const <Node> &original);
+ *   void postWalk<Node>(CTX ctx, const <Node> &original);
+ *
+ * where pre* is only called for nodes that have children.
+ */
+template <class FUNC, class CTX> class TreeWalker {
+private:
+    friend class TreeWalk;
+
+    FUNC &func;
+
+    TreeWalker(FUNC &func) : func(func) {}
+
+    void walkClassDef(const ClassDef &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkClassDef<FUNC>::value) {
+            func.preWalkClassDef(ctx, v);
+        }
+        // Like TreeMap, this doesn't walk v.ancestors nor v.singletonAncestors.
+        for (auto &def : v.rhs) {
+            walkIt(def.get(), ctx.withOwner(v.symbol));
+        }
+        if constexpr (HAS_MEMBER_postWalkClassDef<FUNC>::value) {
+            func.postWalkClassDef(ctx, v);
+        }
+    }
+
+    void walkMethodDef(const MethodDef &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkMethodDef<FUNC>::value) {
+            func.preWalkMethodDef(ctx, v);
+        }
+        for (auto &arg : v.args) {
+            // Only OptionalArgs have subexpressions within them.
+            if (auto *optArg = cast_tree_const<OptionalArg>(arg.get())) {
+                walkIt(optArg->default_.get(), ctx.withOwner(v.symbol));
+            }
+        }
+        walkIt(v.rhs.get(), ctx.withOwner(v.symbol));
+        if constexpr (HAS_MEMBER_postWalkMethodDef<FUNC>::value) {
+            func.postWalkMethodDef(ctx, v);
+        }
+    }
+
+    void walkIf(const If &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkIf<FUNC>::value) {
+            func.preWalkIf(ctx, v);
+        }
+        walkIt(v.cond.get(), ctx);
+        walkIt(v.thenp.get(), ctx);
+        walkIt(v.elsep.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkIf<FUNC>::value) {
+            func.postWalkIf(ctx, v);
+        }
+    }
+
+    void walkWhile(const While &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkWhile<FUNC>::value) {
+            func.preWalkWhile(ctx, v);
+        }
+        walkIt(v.cond.get(), ctx);
+        walkIt(v.body.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkWhile<FUNC>::value) {
+            func.postWalkWhile(ctx, v);
+        }
+    }
+
+    void walkBreak(const Break &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkBreak<FUNC>::value) {
+            func.preWalkBreak(ctx, v);
+        }
+        walkIt(v.expr.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkBreak<FUNC>::value) {
+            func.postWalkBreak(ctx, v);
+        }
+    }
+
+    void walkRetry(const Retry &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkRetry<FUNC>::value) {
+            func.postWalkRetry(ctx, v);
+        }
+    }
+
+    void walkNext(const Next &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkNext<FUNC>::value) {
+            func.preWalkNext(ctx, v);
+        }
+        walkIt(v.expr.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkNext<FUNC>::value) {
+            func.postWalkNext(ctx, v);
+        }
+    }
+
+    void walkReturn(const Return &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkReturn<FUNC>::value) {
+            func.preWalkReturn(ctx, v);
+        }
+        walkIt(v.expr.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkReturn<FUNC>::value) {
+            func.postWalkReturn(ctx, v);
+        }
+    }
+
+    void walkRescueCase(const RescueCase &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkRescueCase<FUNC>::value) {
+            func.preWalkRescueCase(ctx, v);
+        }
+        for (auto &el : v.exceptions) {
+            walkIt(el.get(), ctx);
+        }
+        walkIt(v.var.get(), ctx);
+        walkIt(v.body.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkRescueCase<FUNC>::value) {
+            func.postWalkRescueCase(ctx, v);
+        }
+    }
+
+    void walkRescue(const Rescue &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkRescue<FUNC>::value) {
+            func.preWalkRescue(ctx, v);
+        }
+        walkIt(v.body.get(), ctx);
+        for (auto &el : v.rescueCases) {
+            walkRescueCase(*el, ctx);
+        }
+        walkIt(v.else_.get(), ctx);
+        walkIt(v.ensure.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkRescue<FUNC>::value) {
+            func.postWalkRescue(ctx, v);
+        }
+    }
+
+    void walkField(const Field &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkField<FUNC>::value) {
+            func.postWalkField(ctx, v);
+        }
+    }
+
+    void walkUnresolvedIdent(const UnresolvedIdent &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkUnresolvedIdent<FUNC>::value) {
+            func.postWalkUnresolvedIdent(ctx, v);
+        }
+    }
+
+    void walkAssign(const Assign &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkAssign<FUNC>::value) {
+            func.preWalkAssign(ctx, v);
+        }
+        walkIt(v.lhs.get(), ctx);
+        walkIt(v.rhs.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkAssign<FUNC>::value) {
+            func.postWalkAssign(ctx, v);
+        }
+    }
+
+    void walkSend(const Send &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkSend<FUNC>::value) {
+            func.preWalkSend(ctx, v);
+        }
+        walkIt(v.recv.get(), ctx);
+        for (auto &arg : v.args) {
+            walkIt(arg.get(), ctx);
+        }
+        if (v.block) {
+            walkBlock(*v.block, ctx);
+        }
+        if constexpr (HAS_MEMBER_postWalkSend<FUNC>::value) {
+            func.postWalkSend(ctx, v);
+        }
+    }
+
+    void walkHash(const Hash &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkHash<FUNC>::value) {
+            func.preWalkHash(ctx, v);
+        }
+        for (auto &key : v.keys) {
+            walkIt(key.get(), ctx);
+        }
+        for (auto &value : v.values) {
+            walkIt(value.get(), ctx);
+        }
+        if constexpr (HAS_MEMBER_postWalkHash<FUNC>::value) {
+            func.postWalkHash(ctx, v);
+        }
+    }
+
+    void walkArray(const Array &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkArray<FUNC>::value) {
+            func.preWalkArray(ctx, v);
+        }
+        for (auto &elem : v.elems) {
+            walkIt(elem.get(), ctx);
+        }
+        if constexpr (HAS_MEMBER_postWalkArray<FUNC>::value) {
+            func.postWalkArray(ctx, v);
+        }
+    }
+
+    void walkLiteral(const Literal &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkLiteral<FUNC>::value) {
+            func.postWalkLiteral(ctx, v);
+        }
+    }
+
+    void walkUnresolvedConstantLit(const UnresolvedConstantLit &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkUnresolvedConstantLit<FUNC>::value) {
+            func.postWalkUnresolvedConstantLit(ctx, v);
+        }
+    }
+
+    void walkConstantLit(const ConstantLit &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkConstantLit<FUNC>::value) {
+            func.postWalkConstantLit(ctx, v);
+        }
+    }
+
+    void walkBlock(const Block &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkBlock<FUNC>::value) {
+            func.preWalkBlock(ctx, v);
+        }
+        for (auto &arg : v.args) {
+            // Only OptionalArgs have subexpressions within them.
+            if (auto *optArg = cast_tree_const<OptionalArg>(arg.get())) {
+                walkIt(optArg->default_.get(), ctx);
+            }
+        }
+        walkIt(v.body.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkBlock<FUNC>::value) {
+            func.postWalkBlock(ctx, v);
+        }
+    }
+
+    void walkInsSeq(const InsSeq &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkInsSeq<FUNC>::value) {
+            func.preWalkInsSeq(ctx, v);
+        }
+        for (auto &stat : v.stats) {
+            walkIt(stat.get(), ctx);
+        }
+        walkIt(v.expr.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkInsSeq<FUNC>::value) {
+            func.postWalkInsSeq(ctx, v);
+        }
+    }
+
+    void walkLocal(const Local &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_postWalkLocal<FUNC>::value) {
+            func.postWalkLocal(ctx, v);
+        }
+    }
+
+    void walkCast(const Cast &v, CTX ctx) {
+        if constexpr (HAS_MEMBER_preWalkCast<FUNC>::value) {
+            func.preWalkCast(ctx, v);
+        }
+        walkIt(v.arg.get(), ctx);
+        if constexpr (HAS_MEMBER_postWalkCast<FUNC>::value) {
+            func.postWalkCast(ctx, v);
+        }
+    }
+
+    void walkIt(const Expression *what, CTX ctx) {
+        if (what == nullptr) {
+            return;
+        }
+
+        try {
+            if constexpr (HAS_MEMBER_preWalkExpression<FUNC>::value) {
+                func.preWalkExpression(ctx, *what);
+            }
+
+            if (cast_tree_const<EmptyTree>(what) != nullptr || cast_tree_const<ZSuperArgs>(what) != nullptr) {
+                return;
+            }
+
+            if (auto *unresolvedConstantLit = cast_tree_const<UnresolvedConstantLit>(what)) {
+                walkUnresolvedConstantLit(*unresolvedConstantLit, ctx);
+            } else if (auto *constantLit = cast_tree_const<ConstantLit>(what)) {
+                walkConstantLit(*constantLit, ctx);
+            } else if (auto *send = cast_tree_const<Send>(what)) {
+                walkSend(*send, ctx);
+            } else if (auto *literal = cast_tree_const<Literal>(what)) {
+                walkLiteral(*literal, ctx);
+            } else if (auto *unresolvedIdent = cast_tree_const<UnresolvedIdent>(what)) {
+                walkUnresolvedIdent(*unresolvedIdent, ctx);
+            } else if (auto *local = cast_tree_const<Local>(what)) {
+                walkLocal(*local, ctx);
+            } else if (auto *methodDef = cast_tree_const<MethodDef>(what)) {
+                walkMethodDef(*methodDef, ctx);
+            } else if (auto *insSeq = cast_tree_const<InsSeq>(what)) {
+                walkInsSeq(*insSeq, ctx);
+            } else if (auto *hash = cast_tree_const<Hash>(what)) {
+                walkHash(*hash, ctx);
+            } else if (auto *classDef = cast_tree_const<ClassDef>(what)) {
+                walkClassDef(*classDef, ctx);
+            } else if (auto *if_ = cast_tree_const<If>(what)) {
+                walkIf(*if_, ctx);
+            } else if (auto *while_ = cast_tree_const<While>(what)) {
+                walkWhile(*while_, ctx);
+            } else if (auto *break_ = cast_tree_const<Break>(what)) {
+                walkBreak(*break_, ctx);
+            } else if (auto *retry = cast_tree_const<Retry>(what)) {
+                walkRetry(*retry, ctx);
+            } else if (auto *next = cast_tree_const<Next>(what)) {
+                walkNext(*next, ctx);
+            } else if (auto *return_ = cast_tree_const<Return>(what)) {
+                walkReturn(*return_, ctx);
+            } else if (auto *rescue = cast_tree_const<Rescue>(what)) {
+                walkRescue(*rescue, ctx);
+            } else if (auto *field = cast_tree_const<Field>(what)) {
+                walkField(*field, ctx);
+            } else if (auto *assign = cast_tree_const<Assign>(what)) {
+                walkAssign(*assign, ctx);
+            } else if (auto *array = cast_tree_const<Array>(what)) {
+                walkArray(*array, ctx);
+            } else if (auto *cast = cast_tree_const<Cast>(what)) {
+                walkCast(*cast, ctx);
+            } else {
+                Exception::raise("should never happen. Forgot to add new tree kind? {}",
+                                 const_cast<Expression *>(what)->nodeName());
+            }
+        } catch (SorbetException &e) {
+            Exception::failInFuzzer();
+
+            throw ReportedRubyException{e, what->loc};
+        }
+    }
+};
+
+class TreeWalk {
+public:
+    template <typename CTX, typename FUNC> static void apply(CTX ctx, FUNC &func, const Expression *tree) {
+        TreeWalker<FUNC, CTX> walker(func);
+        try {
+            walker.walkIt(tree, ctx);
+        } catch (ReportedRubyException &exception) {
+            Exception::failInFuzzer();
+            if (auto e = ctx.state.beginError(exception.onLoc, core::errors::Internal::InternalError)) {
+                e.setHeader("Failed to process tree (backtrace is above)");
+            }
+            throw exception.reported;
+        }
+    }
+};
+
+/**
+ * Fuses two tree transformers, so that a single TreeMap traversal does the work of running FIRST and then SECOND
+ * over the tree, and every node is moved out of its parent and back only once.
+ *
+ * At every node, FIRST's pre hook runs before SECOND's, and SECOND's post hook before FIRST's: SECOND sees what
+ * FIRST made of a node before its children were visited, and FIRST sees what SECOND made of it after. This is the
+ * same as running the passes one after the other when
+ *
+ *  - FIRST doesn't look at what SECOND changes. Nodes that SECOND adds in a pre hook are visited by both passes.
+ *  - SECOND's hooks on a node don't depend on FIRST having visited the node's children.
+ *  - Both don't report errors that have to come in pass order, since they are now interleaved.
+ *
+ * A node that SECOND's post hook replaces by another kind of node isn't handed to FIRST's post hook.
+ *
+ * Fusions nest: FusedTransform<A, FusedTransform<B, C, CTX>, CTX> runs A, B, and C in one traversal.
+ */
+template <class FIRST, class SECOND, class CTX> class FusedTransform;
+
+#define GENERATE_FUSED_PRECLASS(X)                                                                              \
+                                                                                                                \
+    template <class FIRST, class SECOND, class CTX,                                                             \
+              bool has = HAS_MEMBER_preTransform##X<FIRST>::value || HAS_MEMBER_preTransform##X<SECOND>::value> \
+    class FusedPreTransform_##X {};                                                                             \
+                                                                                                                \
+    template <class FIRST, class SECOND, class CTX> class FusedPreTransform_##X<FIRST, SECOND, CTX, true> {     \
+    public:                                                                                                     \
+        unique_ptr<X> preTransform##X(CTX ctx, unique_ptr<X> v) {                                               \
+            auto &self = static_cast<FusedTransform<FIRST, SECOND, CTX> &>(*this);                              \
+            if constexpr (HAS_MEMBER_preTransform##X<FIRST>::value) {                                           \
+                v = self.first.preTransform##X(ctx, move(v));                                                   \
+            }                                                                                                   \
+            if constexpr (HAS_MEMBER_preTransform##X<SECOND>::value) {                                          \
+                v = self.second.preTransform##X(ctx, move(v));                                                  \
+            }                                                                                                   \
+            return v;                                                                                           \
+        }                                                                                                       \
+    };
+
+#define GENERATE_FUSED_POSTCLASS(X)                                                                               \
+                                                                                                                  \
+    template <class FIRST, class SECOND, class CTX,                                                               \
+              bool has = HAS_MEMBER_postTransform##X<FIRST>::value || HAS_MEMBER_postTransform##X<SECOND>::value> \
+    class FusedPostTransform_##X {};                                                                              \
+                                                                                                                  \
+    template <class FIRST, class SECOND, class CTX> class FusedPostTransform_##X<FIRST, SECOND, CTX, true> {      \
+    public:                                                                                                       \
+        unique_ptr<Expression> postTransform##X(CTX ctx, unique_ptr<X> v) {                                       \
+            auto &self = static_cast<FusedTransform<FIRST, SECOND, CTX> &>(*this);                                \
+            if constexpr (!HAS_MEMBER_postTransform##X<SECOND>::value) {                                          \
+                return self.first.postTransform##X(ctx, move(v));                                                 \
+            } else if constexpr (!HAS_MEMBER_postTransform##X<FIRST>::value) {                                    \
+                return self.second.postTransform##X(ctx, move(v));                                                \
+            } else {                                                                                              \
+                unique_ptr<Expression> result = self.second.postTransform##X(ctx, move(v));                       \
+                if (!isa_tree<X>(result.get())) {                                                                 \
+                    return result;                                                                                \
+                }                                                                                                 \
+                return self.first.postTransform##X(ctx, unique_ptr<X>(static_cast<X *>(result.release())));       \
+            }                                                                                                     \
+        }                                                                                                         \
+    };
+
+GENERATE_FUSED_PRECLASS(ClassDef);
+GENERATE_FUSED_PRECLASS(MethodDef);
+GENERATE_FUSED_PRECLASS(If);
+GENERATE_FUSED_PRECLASS(While);
+GENERATE_FUSED_PRECLASS(Break);
+GENERATE_FUSED_PRECLASS(Retry);
+GENERATE_FUSED_PRECLASS(Next);
+GENERATE_FUSED_PRECLASS(Return);
+GENERATE_FUSED_PRECLASS(RescueCase);
+GENERATE_FUSED_PRECLASS(Rescue);
+GENERATE_FUSED_PRECLASS(Assign);
+GENERATE_FUSED_PRECLASS(Send);
+GENERATE_FUSED_PRECLASS(Hash);
+GENERATE_FUSED_PRECLASS(Array);
+GENERATE_FUSED_PRECLASS(Block);
+GENERATE_FUSED_PRECLASS(InsSeq);
+GENERATE_FUSED_PRECLASS(Cast);
+
+GENERATE_FUSED_POSTCLASS(ClassDef);
+GENERATE_FUSED_POSTCLASS(MethodDef);
+GENERATE_FUSED_POSTCLASS(If);
+GENERATE_FUSED_POSTCLASS(While);
+GENERATE_FUSED_POSTCLASS(Break);
+GENERATE_FUSED_POSTCLASS(Retry);
+GENERATE_FUSED_POSTCLASS(Next);
+GENERATE_FUSED_POSTCLASS(Return);
+GENERATE_FUSED_POSTCLASS(RescueCase);
+GENERATE_FUSED_POSTCLASS(Rescue);
+GENERATE_FUSED_POSTCLASS(Field);
+GENERATE_FUSED_POSTCLASS(UnresolvedIdent);
+GENERATE_FUSED_POSTCLASS(Assign);
+GENERATE_FUSED_POSTCLASS(Send);
+GENERATE_FUSED_POSTCLASS(Hash);
+GENERATE_FUSED_POSTCLASS(Array);
+GENERATE_FUSED_POSTCLASS(Local);
+GENERATE_FUSED_POSTCLASS(Literal);
+GENERATE_FUSED_POSTCLASS(UnresolvedConstantLit);
+GENERATE_FUSED_POSTCLASS(ConstantLit);
+GENERATE_FUSED_POSTCLASS(Block);
+GENERATE_FUSED_POSTCLASS(InsSeq);
+GENERATE_FUSED_POSTCLASS(Cast);
+
+template <class FIRST, class SECOND, class CTX>
+class FusedTransform : public FusedPreTransform_ClassDef<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_MethodDef<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_If<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_While<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Break<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Retry<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Next<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Return<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_RescueCase<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Rescue<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Assign<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Send<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Hash<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Array<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Block<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_InsSeq<FIRST, SECOND, CTX>,
+                       public FusedPreTransform_Cast<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_ClassDef<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_MethodDef<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_If<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_While<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Break<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Retry<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Next<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Return<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_RescueCase<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Rescue<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Field<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_UnresolvedIdent<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Assign<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Send<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Hash<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Array<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Local<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Literal<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_UnresolvedConstantLit<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_ConstantLit<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Block<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_InsSeq<FIRST, SECOND, CTX>,
+                       public FusedPostTransform_Cast<FIRST, SECOND, CTX> {
+public:
+    FIRST &first;
+    SECOND &second;
+    // Nodes visited, each of which would otherwise have been visited once more by a separate traversal.
+    u8 nodes = 0;
+
+    FusedTransform(FIRST &first, SECOND &second) : first(first), second(second) {}
+
+    unique_ptr<Expression> preTransformExpression(CTX ctx, unique_ptr<Expression> v) {
+        nodes++;
+        if constexpr (HAS_MEMBER_preTransformExpression<FIRST>::value) {
+            v = first.preTransformExpression(ctx, move(v));
+        }
+        if constexpr (HAS_MEMBER_preTransformExpression<SECOND>::value) {
+            v = second.preTransformExpression(ctx, move(v));
+        }
+        return v;
+    }
+};
 } // namespace sorbet::ast
 
 #endif // SORBET_TREEMAP_H
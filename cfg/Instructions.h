@@ -90,7 +90,7 @@ public:
 
     virtual std::string toString(core::Context ctx);
 };
-CheckSize(Send, 152, 8);
+CheckSize(Send, 160, 8);
 
 class Return final : public Instruction {
 public:
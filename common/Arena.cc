@@ -0,0 +1,75 @@
+#include "common/Arena.h"
+#include "common/Counters.h"
+#include <new>
+
+using namespace std;
+
+namespace sorbet {
+
+namespace {
+// Every allocation starts with the arena it came from, or nullptr if it came from the heap. Padded to keep the
+// alignment that `operator new` guarantees.
+constexpr size_t HEADER_SIZE = alignof(max_align_t);
+static_assert(HEADER_SIZE >= sizeof(Arena *));
+
+size_t alignUp(size_t size) {
+    return (size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1);
+}
+} // namespace
+
+Arena::Scope::Scope(Arena *&current) : current(current), previous(current) {
+    current = new Arena();
+}
+
+Arena::Scope::~Scope() {
+    auto *arena = current;
+    current = previous;
+    arena->release();
+}
+
+void *Arena::allocate(Arena *arena, size_t size) {
+    size_t needed = HEADER_SIZE + alignUp(size);
+    char *block;
+    if (arena == nullptr || needed > MAX_ARENA_ALLOCATION) {
+        block = static_cast<char *>(::operator new(needed));
+        arena = nullptr;
+    } else {
+        if (arena->chunkUsed + needed > CHUNK_SIZE) {
+            arena->chunks.emplace_back(static_cast<char *>(::operator new(CHUNK_SIZE)));
+            arena->chunkUsed = 0;
+            prodCounterInc("arena.chunks");
+        }
+        block = arena->chunks.back() + arena->chunkUsed;
+        arena->chunkUsed += needed;
+        arena->references.fetch_add(1, memory_order_relaxed);
+    }
+    *reinterpret_cast<Arena **>(block) = arena;
+    return block + HEADER_SIZE;
+}
+
+void Arena::deallocate(void *ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    char *block = static_cast<char *>(ptr) - HEADER_SIZE;
+    auto *arena = *reinterpret_cast<Arena **>(block);
+    if (arena == nullptr) {
+        ::operator delete(block);
+    } else {
+        arena->release();
+    }
+}
+
+void Arena::release() noexcept {
+    if (references.fetch_sub(1, memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+Arena::~Arena() {
+    for (auto *chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+} // namespace sorbet
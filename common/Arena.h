@@ -0,0 +1,53 @@
+#ifndef SORBET_COMMON_ARENA_H
+#define SORBET_COMMON_ARENA_H
+
+#include "common/common.h"
+#include <atomic>
+
+namespace sorbet {
+
+/**
+ * Bump allocator for the nodes of one file's trees.
+ *
+ * A tree family opts in by forwarding its class-level `operator new` and `operator delete` to `allocate` and
+ * `deallocate`, with a thread_local `Arena *` of its own. While an `Arena::Scope` over that pointer is alive, nodes
+ * allocated on its thread come from a fresh arena, and nodes allocated anywhere else come from the heap as usual.
+ *
+ * Deleting a node still runs its destructor, but only counts down the arena it came from. The arena's memory is
+ * released at once when its scope is closed and its last node was deleted, from whatever thread that happens on.
+ */
+class Arena final {
+public:
+    class Scope final {
+    public:
+        Scope(Arena *&current);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Arena *&current;
+        Arena *previous;
+    };
+
+    static void *allocate(Arena *arena, size_t size);
+    static void deallocate(void *ptr) noexcept;
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    // Allocations larger than this come from the heap, so that they don't waste the rest of a chunk.
+    static constexpr size_t MAX_ARENA_ALLOCATION = CHUNK_SIZE / 8;
+
+    Arena() = default;
+    ~Arena();
+    void release() noexcept;
+
+    std::vector<char *> chunks;
+    size_t chunkUsed = CHUNK_SIZE;
+    // Live nodes, plus one while the scope is open.
+    std::atomic<u4> references{1};
+};
+
+} // namespace sorbet
+
+#endif // SORBET_COMMON_ARENA_H
@@ -1,5 +1,7 @@
 #include "common/Counters.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "common/Counters_impl.h"
 #include <algorithm>
 #include <chrono>
@@ -130,6 +132,44 @@ void counterConsume(CounterState cs) {
     }
 }
 
+string getAndClearThreadCountersForParent() {
+    string out;
+    for (auto &cat : counterState.countersByCategory) {
+        for (auto &e : cat.second) {
+            absl::StrAppend(&out, "k ", (uintptr_t)cat.first, " ", (uintptr_t)e.first, " ", e.second, "\n");
+        }
+    }
+    for (auto &hist : counterState.histograms) {
+        for (auto &e : hist.second) {
+            absl::StrAppend(&out, "h ", (uintptr_t)hist.first, " ", e.first, " ", e.second, "\n");
+        }
+    }
+    for (auto &e : counterState.counters) {
+        absl::StrAppend(&out, "c ", (uintptr_t)e.first, " ", e.second, "\n");
+    }
+    counterState.clear();
+    return out;
+}
+
+void counterConsumeFromChild(string_view fromChild) {
+    for (string_view line : absl::StrSplit(fromChild, '\n', absl::SkipEmpty())) {
+        vector<string_view> fields = absl::StrSplit(line, ' ');
+        uintptr_t first, second;
+        int key;
+        CounterImpl::CounterType value;
+        if (fields.size() == 4 && fields[0] == "k" && absl::SimpleAtoi(fields[1], &first) &&
+            absl::SimpleAtoi(fields[2], &second) && absl::SimpleAtoi(fields[3], &value)) {
+            counterState.prodCategoryCounterAdd((const char *)first, (const char *)second, value);
+        } else if (fields.size() == 4 && fields[0] == "h" && absl::SimpleAtoi(fields[1], &first) &&
+                   absl::SimpleAtoi(fields[2], &key) && absl::SimpleAtoi(fields[3], &value)) {
+            counterState.prodHistogramAdd((const char *)first, key, value);
+        } else if (fields.size() == 3 && fields[0] == "c" && absl::SimpleAtoi(fields[1], &first) &&
+                   absl::SimpleAtoi(fields[2], &value)) {
+            counterState.prodCounterAdd((const char *)first, value);
+        }
+    }
+}
+
 void counterAdd(ConstExprStr counter, unsigned long value) {
     counterState.counterAdd(counter.str, value);
 }
@@ -80,6 +80,12 @@ struct Counters {
 
 CounterState getAndClearThreadCounters();
 void counterConsume(CounterState cs);
+/**
+ * Moves the counters of this thread into a string, which `counterConsumeFromChild` adds to the counters of the process
+ * that forked this one. Names are passed as addresses, which only stay valid across `fork`. Timings are dropped.
+ */
+std::string getAndClearThreadCountersForParent();
+void counterConsumeFromChild(std::string_view fromChild);
 
 void prodCounterInc(ConstExprStr counter);
 void prodCounterAdd(ConstExprStr counter, unsigned long value);
@@ -11,6 +11,8 @@ class FileOps final {
 public:
     static bool exists(std::string_view filename);
     static std::string read(std::string_view filename);
+    /** Reads the first `maxBytes` bytes of the file, or all of it if it is shorter. */
+    static std::string readPrefix(std::string_view filename, size_t maxBytes);
     static void write(std::string_view filename, const std::vector<sorbet::u1> &data);
     static void append(std::string_view filename, std::string_view text);
     static void write(std::string_view filename, std::string_view text);
@@ -41,6 +43,10 @@ public:
      * Throws FileReadException on EOF or error.
      */
     static int readFd(int fd, std::vector<char> &output, int timeoutMs = 100);
+    /**
+     * Like the above, but reads up to `size` bytes into `output`.
+     */
+    static int readFd(int fd, char *output, size_t size, int timeoutMs = 100);
     /**
      * Attempts to read data up to a newline (\n) from the given file descriptor.
      * Timeout is specified in milliseconds.
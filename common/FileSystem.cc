@@ -4,10 +4,22 @@
 namespace sorbet {
 using namespace std;
 
+string FileSystem::readFilePrefix(string_view path, size_t maxBytes) const {
+    auto contents = readFile(path);
+    if (contents.size() > maxBytes) {
+        contents.resize(maxBytes);
+    }
+    return contents;
+}
+
 string OSFileSystem::readFile(string_view path) const {
     return FileOps::read(path);
 }
 
+string OSFileSystem::readFilePrefix(string_view path, size_t maxBytes) const {
+    return FileOps::readPrefix(path, maxBytes);
+}
+
 void OSFileSystem::writeFile(string_view filename, string_view text) {
     return FileOps::write(filename, text);
 }
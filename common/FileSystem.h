@@ -18,6 +18,12 @@ public:
     /** Read the file at the given path. Throws a `FileNotFoundException` if not found. */
     virtual std::string readFile(std::string_view path) const = 0;
 
+    /**
+     * Read the first `maxBytes` bytes of the file at the given path, or all of it if it is shorter. Throws a
+     * `FileNotFoundException` if not found. Reads the whole file unless overridden.
+     */
+    virtual std::string readFilePrefix(std::string_view path, size_t maxBytes) const;
+
     /** Writes the specified data to the given file. */
     virtual void writeFile(std::string_view filename, std::string_view text) = 0;
 
@@ -44,6 +50,7 @@ public:
     OSFileSystem() = default;
 
     std::string readFile(std::string_view path) const override;
+    std::string readFilePrefix(std::string_view path, size_t maxBytes) const override;
     void writeFile(std::string_view filename, std::string_view text) override;
     std::vector<std::string> listFilesInDir(std::string_view path, const UnorderedSet<std::string> &extensions,
                                             bool recursive, const std::vector<std::string> &absoluteIgnorePatterns,
@@ -0,0 +1,69 @@
+#include "common/IgnoreMatcher.h"
+#include "absl/strings/str_split.h"
+
+using namespace std;
+
+namespace sorbet {
+
+IgnoreMatcher::IgnoreMatcher(const vector<string> &absoluteIgnorePatterns,
+                             const vector<string> &relativeIgnorePatterns)
+    : nodes(2) {
+    for (auto &p : absoluteIgnorePatterns) {
+        add(ABSOLUTE_ROOT, p);
+    }
+    for (auto &p : relativeIgnorePatterns) {
+        ENFORCE(!p.empty());
+        add(RELATIVE_ROOT, p);
+    }
+}
+
+void IgnoreMatcher::add(u4 root, string_view pattern) {
+    // Patterns are normalized to start with a `/`, so that they can only match whole names. An empty absolute pattern
+    // matches everything.
+    ENFORCE(pattern.empty() || pattern[0] == '/');
+    u4 node = root;
+    if (!pattern.empty()) {
+        for (auto name : absl::StrSplit(pattern.substr(1), '/')) {
+            auto fnd = nodes[node].children.find(name);
+            if (fnd != nodes[node].children.end()) {
+                node = fnd->second;
+                continue;
+            }
+            u4 child = nodes.size();
+            nodes[node].children.emplace(string(name), child);
+            nodes.emplace_back();
+            node = child;
+        }
+    }
+    nodes[node].isMatch = true;
+}
+
+IgnoreMatcher::State IgnoreMatcher::initialState() const {
+    return State{ABSOLUTE_ROOT};
+}
+
+bool IgnoreMatcher::step(u4 node, string_view name, State &entry) const {
+    auto &children = nodes[node].children;
+    auto fnd = children.find(name);
+    if (fnd == children.end()) {
+        return false;
+    }
+    auto &child = nodes[fnd->second];
+    if (child.isMatch) {
+        return true;
+    }
+    entry.emplace_back(fnd->second);
+    return false;
+}
+
+bool IgnoreMatcher::enter(const State &dir, string_view name, State &entry) const {
+    entry.clear();
+    for (auto node : dir) {
+        if (nodes[node].isMatch || step(node, name, entry)) {
+            return true;
+        }
+    }
+    return step(RELATIVE_ROOT, name, entry);
+}
+
+} // namespace sorbet
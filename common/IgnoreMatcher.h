@@ -0,0 +1,53 @@
+#ifndef SORBET_COMMON_IGNOREMATCHER_H
+#define SORBET_COMMON_IGNOREMATCHER_H
+
+#include "common/common.h"
+
+namespace sorbet {
+
+/**
+ * The ignore patterns of `FileOps::isFileIgnored`, compiled into a trie over path components for walking a directory
+ * tree top down.
+ *
+ * Every pattern is a `/`-separated list of whole folder or file names. Absolute patterns match the first names of a
+ * path relative to the walk's base, and relative patterns match consecutive names anywhere in it. Walking from a
+ * directory into one of its entries moves from the directory's State to the entry's, and tells whether the entry is
+ * ignored. Entries of ignored directories are never looked at, so a path is only reported as ignored by a pattern
+ * match that ends at its last name.
+ */
+class IgnoreMatcher final {
+public:
+    // The trie nodes of all patterns that the path walked so far is a partial match of.
+    using State = InlinedVector<u4, 4>;
+
+    IgnoreMatcher(const std::vector<std::string> &absoluteIgnorePatterns,
+                  const std::vector<std::string> &relativeIgnorePatterns);
+
+    /** The state of the walk's base directory. */
+    State initialState() const;
+
+    /**
+     * Moves from the state of a directory to the state of its entry `name`, in `entry`. Returns true if the entry is
+     * ignored, in which case `entry` is meaningless.
+     */
+    bool enter(const State &dir, std::string_view name, State &entry) const;
+
+private:
+    struct Node {
+        UnorderedMap<std::string, u4> children;
+        bool isMatch = false;
+    };
+
+    static constexpr u4 ABSOLUTE_ROOT = 0;
+    static constexpr u4 RELATIVE_ROOT = 1;
+
+    void add(u4 root, std::string_view pattern);
+    // Returns true if the child of `node` named `name` completes a pattern, and otherwise adds it to `entry`.
+    bool step(u4 node, std::string_view name, State &entry) const;
+
+    std::vector<Node> nodes;
+};
+
+} // namespace sorbet
+
+#endif // SORBET_COMMON_IGNOREMATCHER_H
@@ -0,0 +1,197 @@
+#ifndef SORBET_PAGED_VECTOR_H
+#define SORBET_PAGED_VECTOR_H
+
+#include "common/Counters.h"
+#include "common/common.h"
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace sorbet {
+
+namespace paged_vector_internal {
+template <class T, class = void> struct HasDeepCopy : std::false_type {};
+template <class T>
+struct HasDeepCopy<T, std::void_t<decltype(std::declval<const T &>().deepCopy())>> : std::true_type {};
+
+template <class T> T copyElement(const T &elem) {
+    if constexpr (HasDeepCopy<T>::value) {
+        return elem.deepCopy();
+    } else {
+        return elem;
+    }
+}
+} // namespace paged_vector_internal
+
+/**
+ * A vector that stores its elements in fixed-size pages which are shared between copies of the container.
+ *
+ * Copying a PagedVector only copies the page table. A page is duplicated lazily, the first time one of the copies
+ * asks for mutable access to an element that lives in it (via `mutableAt` or `emplace_back`). This makes copying
+ * O(#pages) and mutating a copy O(#pages touched).
+ *
+ * Elements never move once inserted, so `emplace_back` doesn't invalidate references. A page copy does: a reference
+ * obtained through `operator[]` keeps pointing at the old (still alive, but no longer ours) page after `mutableAt`
+ * on any element of the same page.
+ *
+ * `capacity()` is a logical capacity that is only affected by `reserve` and `resize`. It's tracked so that callers
+ * can keep their own growth policies (e.g. the name hash table in GlobalState).
+ *
+ * Elements are copied with `T::deepCopy()` if it exists, and with the copy constructor otherwise.
+ */
+template <class T, int PAGE_BITS = 12> class PagedVector final {
+public:
+    using value_type = T;
+    static constexpr u4 PAGE_SIZE = 1u << PAGE_BITS;
+    static constexpr u4 PAGE_MASK = PAGE_SIZE - 1;
+
+    class const_iterator {
+        const PagedVector *vec;
+        u4 idx;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator(const PagedVector *vec, u4 idx) : vec(vec), idx(idx) {}
+        const T &operator*() const {
+            return (*vec)[idx];
+        }
+        const T *operator->() const {
+            return &(*vec)[idx];
+        }
+        const_iterator &operator++() {
+            idx++;
+            return *this;
+        }
+        bool operator==(const const_iterator &rhs) const {
+            return idx == rhs.idx;
+        }
+        bool operator!=(const const_iterator &rhs) const {
+            return idx != rhs.idx;
+        }
+    };
+
+    PagedVector() = default;
+    PagedVector(PagedVector &&) noexcept = default;
+    PagedVector &operator=(PagedVector &&) noexcept = default;
+    // Copying is cheap: pages are shared until one of the copies mutates them.
+    PagedVector(const PagedVector &) = default;
+    PagedVector &operator=(const PagedVector &) = default;
+
+    u4 size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    u4 capacity() const {
+        return std::max(capacity_, size_);
+    }
+
+    u4 pagesUsed() const {
+        return pages.size();
+    }
+
+    /** Number of pages that are (at the moment) also referenced by another PagedVector. */
+    u4 sharedPages() const {
+        u4 res = 0;
+        for (auto &page : pages) {
+            if (page.use_count() != 1) {
+                res++;
+            }
+        }
+        return res;
+    }
+
+    void reserve(u4 n) {
+        if (n > capacity_) {
+            capacity_ = n;
+            pages.reserve((n + PAGE_SIZE - 1) >> PAGE_BITS);
+        }
+    }
+
+    /** Grows the vector to `n` default-constructed elements. Shrinking is not supported. */
+    void resize(u4 n) {
+        ENFORCE(n >= size_, "PagedVector can't shrink");
+        reserve(n);
+        while (size_ < n) {
+            emplace_back();
+        }
+    }
+
+    void clear() {
+        pages.clear();
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    const T &operator[](u4 idx) const {
+        ENFORCE(idx < size_);
+        return (*pages[idx >> PAGE_BITS])[idx & PAGE_MASK];
+    }
+
+    /** Returns a mutable reference to the element, copying its page first if it is shared with another vector. */
+    T &mutableAt(u4 idx) {
+        ENFORCE(idx < size_);
+        return mutablePage(idx >> PAGE_BITS)[idx & PAGE_MASK];
+    }
+
+    template <class... Args> T &emplace_back(Args &&... args) {
+        if ((size_ & PAGE_MASK) == 0) {
+            auto &page = pages.emplace_back(std::make_shared<std::vector<T>>());
+            page->reserve(PAGE_SIZE);
+        }
+        auto &page = mutablePage(pages.size() - 1);
+        size_++;
+        return page.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /** Returns the index of `elem`, which has to live in one of our pages. O(#pages), so keep it off hot paths. */
+    u4 indexOf(const T *elem) const {
+        std::less<const T *> lt;
+        for (u4 pageId = 0; pageId < pages.size(); pageId++) {
+            const T *first = pages[pageId]->data();
+            if (!lt(elem, first) && lt(elem, first + pages[pageId]->size())) {
+                return (pageId << PAGE_BITS) + (elem - first);
+            }
+        }
+        Exception::raise("element does not belong to this PagedVector");
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, size_);
+    }
+
+private:
+    std::vector<std::shared_ptr<std::vector<T>>> pages;
+    u4 size_ = 0;
+    u4 capacity_ = 0;
+
+    std::vector<T> &mutablePage(u4 pageId) {
+        auto &page = pages[pageId];
+        if (page.use_count() != 1) {
+            auto copy = std::make_shared<std::vector<T>>();
+            copy->reserve(PAGE_SIZE);
+            for (auto &elem : *page) {
+                copy->emplace_back(paged_vector_internal::copyElement(elem));
+            }
+            page = std::move(copy);
+            counterInc("paged_vector.page_copies");
+        }
+        return *page;
+    }
+};
+
+} // namespace sorbet
+#endif // SORBET_PAGED_VECTOR_H
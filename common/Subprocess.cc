@@ -1,6 +1,11 @@
 #include "common/Subprocess.h"
 #include "common/common.h"
+#include "common/os/os.h"
 #include <array>
+#include <csignal>
+#include <climits>
+#include <mutex>
+#include <poll.h>
 #include <spawn.h>
 #include <sstream>
 #include <string>
@@ -51,6 +56,10 @@ private:
     posix_spawn_file_actions_t fileActions;
     bool _initialized;
 };
+
+// Held from creating a child's pipes until it is spawned. Where pipes can't be created close-on-exec atomically, this
+// keeps them from leaking into a child that another thread spawns meanwhile.
+mutex spawnMutex;
 } // namespace
 
 // can't take string_views because we need char * not const char *
@@ -62,8 +71,8 @@ optional<string> sorbet::Subprocess::spawn(string executable, vector<string> arg
     int ret;
     pid_t childPid;
 
-    ret = pipe(readWrite);
-    if (ret) {
+    unique_lock<mutex> spawning(spawnMutex);
+    if (!pipeCloseOnExec(readWrite)) {
         return nullopt;
     }
     FileCloser closeRead(readWrite[0]);
@@ -99,6 +108,7 @@ optional<string> sorbet::Subprocess::spawn(string executable, vector<string> arg
             return nullopt;
         }
     }
+    spawning.unlock();
 
     stringstream sink;
     array<char, 512> chunk;
@@ -128,3 +138,153 @@ optional<string> sorbet::Subprocess::spawn(string executable, vector<string> arg
 
     return sink.str();
 }
+
+namespace sorbet {
+
+namespace {
+void ignoreSigpipe() {
+    // A persistent child can exit while we write to it. Report that as a failed write instead of dying of SIGPIPE.
+    static once_flag ignored;
+    call_once(ignored, []() { signal(SIGPIPE, SIG_IGN); });
+}
+
+// A write of at most this many bytes doesn't block once poll says the pipe is writable.
+constexpr size_t PIPE_BUF_SIZE = PIPE_BUF;
+} // namespace
+
+PersistentSubprocess::PersistentSubprocess(pid_t childPid, int toChild, int fromChild)
+    : childPid(childPid), toChild(toChild), fromChild(fromChild) {}
+
+unique_ptr<PersistentSubprocess> PersistentSubprocess::spawn(string executable, vector<string> arguments) {
+    if (emscripten_build) {
+        return nullptr;
+    }
+    ignoreSigpipe();
+    // No pipe end may leak into other children: a child that holds the write end of another child's stdin keeps it
+    // from ever seeing EOF. The ends that this child gets are dup2'd to its stdin and stdout, which aren't
+    // close-on-exec.
+    int input[2];
+    int output[2];
+    lock_guard<mutex> spawning(spawnMutex);
+    if (!pipeCloseOnExec(input)) {
+        return nullptr;
+    }
+    FileCloser closeInputRead(input[0]);
+    if (!pipeCloseOnExec(output)) {
+        close(input[1]);
+        return nullptr;
+    }
+    FileCloser closeOutputWrite(output[1]);
+
+    pid_t childPid;
+    int ret;
+    {
+        FileActions fileActions;
+        ret = fileActions.initialized() ? 0 : -1;
+        if (!ret) {
+            ret = posix_spawn_file_actions_adddup2(fileActions, input[0], 0);
+        }
+        if (!ret) {
+            ret = posix_spawn_file_actions_adddup2(fileActions, output[1], 1);
+        }
+        if (!ret) {
+            vector<char *> argv;
+            argv.reserve(arguments.size() + 2);
+            argv.push_back(executable.data());
+            for (auto &arg : arguments) {
+                argv.push_back(arg.data());
+            }
+            argv.push_back(nullptr);
+            ret = posix_spawnp(&childPid, executable.data(), fileActions, nullptr, argv.data(), nullptr);
+        }
+    }
+    if (ret) {
+        close(input[1]);
+        close(output[0]);
+        return nullptr;
+    }
+    return unique_ptr<PersistentSubprocess>(new PersistentSubprocess(childPid, input[1], output[0]));
+}
+
+PersistentSubprocess::~PersistentSubprocess() {
+    close(toChild);
+    close(fromChild);
+    while (waitpid(childPid, nullptr, 0) == -1 && errno == EINTR) {
+    }
+}
+
+bool PersistentSubprocess::write(string_view data) {
+    while (!data.empty()) {
+        // Keep reading while we write. Otherwise a child that replies before it read everything could fill its stdout
+        // while we wait for room in its stdin, and neither of us would make progress.
+        array<pollfd, 2> fds{{{toChild, POLLOUT, 0}, {fromChild, POLLIN, 0}}};
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if ((fds[1].revents & (POLLIN | POLLHUP)) != 0 && !fill()) {
+            return false;
+        }
+        if ((fds[0].revents & (POLLERR | POLLHUP)) != 0) {
+            return false;
+        }
+        if ((fds[0].revents & POLLOUT) == 0) {
+            continue;
+        }
+        const ssize_t written = ::write(toChild, data.data(), min(data.size(), PIPE_BUF_SIZE));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+bool PersistentSubprocess::fill() {
+    array<char, 4096> chunk;
+    while (true) {
+        const ssize_t bytesRead = ::read(fromChild, chunk.data(), chunk.size());
+        if (bytesRead > 0) {
+            buffered.append(chunk.data(), bytesRead);
+            return true;
+        } else if (bytesRead == 0) {
+            return false;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+optional<string> PersistentSubprocess::readLine() {
+    size_t searchFrom = 0;
+    while (true) {
+        auto newline = buffered.find('\n', searchFrom);
+        if (newline != string::npos) {
+            string line = buffered.substr(0, newline);
+            buffered.erase(0, newline + 1);
+            return line;
+        }
+        searchFrom = buffered.size();
+        if (!fill()) {
+            return nullopt;
+        }
+    }
+}
+
+optional<string> PersistentSubprocess::read(size_t length) {
+    while (buffered.size() < length) {
+        if (!fill()) {
+            return nullopt;
+        }
+    }
+    string result = buffered.substr(0, length);
+    buffered.erase(0, length);
+    return result;
+}
+
+} // namespace sorbet
@@ -1,7 +1,11 @@
 #ifndef SORBET_SUBPROCESS_H
 #define SORBET_SUBPROCESS_H
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
 
 namespace sorbet {
 
@@ -12,5 +16,34 @@ public:
     static std::optional<std::string> spawn(std::string executable, std::vector<std::string> arguments);
 };
 
+/**
+ * A child process that keeps running between requests. We write requests to its stdin and read replies from its
+ * stdout. Destroying it closes the child's stdin, which tells it to exit, and then reaps it.
+ *
+ * Any failure to talk to the child (it exited, or closed its end of a pipe) makes `write` return false and the reads
+ * return nullopt. The child can't be trusted after that, and should be destroyed.
+ */
+class PersistentSubprocess final {
+    pid_t childPid;
+    int toChild;
+    int fromChild;
+    // Bytes read from the child that haven't been returned yet.
+    std::string buffered;
+
+    PersistentSubprocess(pid_t childPid, int toChild, int fromChild);
+    bool fill();
+
+public:
+    static std::unique_ptr<PersistentSubprocess> spawn(std::string executable, std::vector<std::string> arguments);
+    ~PersistentSubprocess();
+    PersistentSubprocess(const PersistentSubprocess &) = delete;
+    PersistentSubprocess &operator=(const PersistentSubprocess &) = delete;
+
+    bool write(std::string_view data);
+    // Returns the next line without its trailing newline.
+    std::optional<std::string> readLine();
+    std::optional<std::string> read(size_t length);
+};
+
 } // namespace sorbet
 #endif // SORBET_SUBPROCESS_H
@@ -1,16 +1,21 @@
 #include "common/common.h"
 #include "common/Exception.h"
 #include "common/FileOps.h"
+#include "common/IgnoreMatcher.h"
 #include "os/os.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include <array>
+#include <condition_variable>
 #include <csignal>
 #include <cstdarg>
 #include <cstdio>
 #include <cxxabi.h>
+#include <deque>
 #include <dirent.h>
 #include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -36,7 +41,10 @@ string sorbet::FileOps::read(string_view filename) {
     if (fp) {
         string contents;
         fseek(fp, 0, SEEK_END);
-        contents.resize(ftell(fp));
+        auto size = ftell(fp);
+        // core::File terminates sources with two NULs, which must not make it copy the whole file.
+        contents.reserve(size + 2);
+        contents.resize(size);
         rewind(fp);
         auto readBytes = fread(&contents[0], 1, contents.size(), fp);
         fclose(fp);
@@ -49,6 +57,22 @@ string sorbet::FileOps::read(string_view filename) {
     throw sorbet::FileNotFoundException();
 }
 
+string sorbet::FileOps::readPrefix(string_view filename, size_t maxBytes) {
+    FILE *fp = std::fopen((string(filename)).c_str(), "rb");
+    if (fp) {
+        string contents(maxBytes, '\0');
+        auto readBytes = fread(&contents[0], 1, maxBytes, fp);
+        bool failed = ferror(fp) != 0;
+        fclose(fp);
+        if (failed) {
+            throw sorbet::FileNotFoundException();
+        }
+        contents.resize(readBytes);
+        return contents;
+    }
+    throw sorbet::FileNotFoundException();
+}
+
 void sorbet::FileOps::write(string_view filename, const vector<sorbet::u1> &data) {
     FILE *fp = std::fopen(string(filename).c_str(), "wb");
     if (fp) {
@@ -93,6 +117,10 @@ string_view sorbet::FileOps::getExtension(string_view path) {
 }
 
 int sorbet::FileOps::readFd(int fd, std::vector<char> &output, int timeoutMs) {
+    return readFd(fd, output.data(), output.size(), timeoutMs);
+}
+
+int sorbet::FileOps::readFd(int fd, char *output, size_t size, int timeoutMs) {
     // Prepare to use select()
     fd_set set;
     FD_ZERO(&set);
@@ -111,7 +139,7 @@ int sorbet::FileOps::readFd(int fd, std::vector<char> &output, int timeoutMs) {
         // A timeout occurred.
         return 0;
     } else {
-        auto read = ::read(fd, output.data(), output.size());
+        auto read = ::read(fd, output, size);
         if (read == 0) {
             throw sorbet::FileReadException("EOF");
         } else if (read < 0) {
@@ -194,13 +222,24 @@ bool sorbet::FileOps::isFileIgnored(string_view basePath, string_view filePath,
     return false;
 }
 
-void appendFilesInDir(string_view basePath, string_view path, const sorbet::UnorderedSet<string> &extensions,
-                      bool recursive, vector<string> &result, const std::vector<std::string> &absoluteIgnorePatterns,
-                      const std::vector<std::string> &relativeIgnorePatterns) {
-    DIR *dir;
+namespace {
+struct PendingDir {
+    string path;
+    sorbet::IgnoreMatcher::State state;
+};
+
+// Directories are listed by this many threads at most. Listing is bound by system calls, so more threads than cores
+// still help, but not without limit.
+constexpr unsigned int MAX_LIST_THREADS = 8;
+
+// Appends the matching files of one directory to `files`, and the subdirectories to walk next to `subdirs`.
+void listDir(const PendingDir &dir, const sorbet::IgnoreMatcher &matcher,
+             const sorbet::UnorderedSet<string> &extensions, bool recursive, vector<string> &files,
+             vector<PendingDir> &subdirs) {
+    DIR *handle;
     struct dirent *entry;
 
-    if ((dir = opendir(string(path).c_str())) == nullptr) {
+    if ((handle = opendir(dir.path.c_str())) == nullptr) {
         switch (errno) {
             case ENOTDIR:
                 throw sorbet::FileNotDirException();
@@ -210,35 +249,102 @@ void appendFilesInDir(string_view basePath, string_view path, const sorbet::Unor
         }
     }
 
-    while ((entry = readdir(dir)) != nullptr) {
-        auto fullPath = fmt::format("{}/{}", path, entry->d_name);
-        if (sorbet::FileOps::isFileIgnored(basePath, fullPath, absoluteIgnorePatterns, relativeIgnorePatterns)) {
+    sorbet::IgnoreMatcher::State state;
+    while ((entry = readdir(handle)) != nullptr) {
+        string_view name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        if (matcher.enter(dir.state, name, state)) {
             continue;
-        } else if (entry->d_type == DT_DIR) {
-            if (!recursive || strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                continue;
+        }
+        if (entry->d_type == DT_DIR) {
+            if (recursive) {
+                subdirs.push_back(PendingDir{fmt::format("{}/{}", dir.path, name), state});
             }
-            appendFilesInDir(basePath, fullPath, extensions, recursive, result, absoluteIgnorePatterns,
-                             relativeIgnorePatterns);
-        } else {
-            auto dotLocation = fullPath.rfind('.');
-            // Note: Can't call substr with an index > string length, so explicitly check if a dot isn't found.
-            if (dotLocation != string::npos) {
-                auto ext = fullPath.substr(dotLocation);
-                if (extensions.find(ext) != extensions.end()) {
-                    result.emplace_back(fullPath);
+            continue;
+        }
+        auto dotLocation = name.rfind('.');
+        if (dotLocation != string_view::npos && extensions.find(name.substr(dotLocation)) != extensions.end()) {
+            files.emplace_back(fmt::format("{}/{}", dir.path, name));
+        }
+    }
+    closedir(handle);
+}
+
+// Walks the trees under `pending` from several threads, which take directories from a shared queue and put the
+// subdirectories they find back on it. The first error from any of them is rethrown once they are done.
+void walkDirs(vector<PendingDir> pending, const sorbet::IgnoreMatcher &matcher,
+              const sorbet::UnorderedSet<string> &extensions, vector<string> &result) {
+    mutex mtx;
+    condition_variable changed;
+    deque<PendingDir> queue(make_move_iterator(pending.begin()), make_move_iterator(pending.end()));
+    // Directories that are being listed, and may still add to the queue.
+    int listing = 0;
+    exception_ptr error;
+
+    auto worker = [&]() {
+        vector<string> files;
+        vector<PendingDir> subdirs;
+        while (true) {
+            PendingDir dir;
+            {
+                unique_lock<mutex> lock(mtx);
+                changed.wait(lock, [&] { return !queue.empty() || listing == 0 || error != nullptr; });
+                if (queue.empty() || error != nullptr) {
+                    break;
                 }
+                dir = move(queue.front());
+                queue.pop_front();
+                listing++;
             }
+            subdirs.clear();
+            exception_ptr listError;
+            try {
+                listDir(dir, matcher, extensions, true, files, subdirs);
+            } catch (...) {
+                listError = current_exception();
+            }
+            {
+                unique_lock<mutex> lock(mtx);
+                listing--;
+                if (listError != nullptr && error == nullptr) {
+                    error = listError;
+                }
+                queue.insert(queue.end(), make_move_iterator(subdirs.begin()), make_move_iterator(subdirs.end()));
+            }
+            changed.notify_all();
         }
+        unique_lock<mutex> lock(mtx);
+        result.insert(result.end(), make_move_iterator(files.begin()), make_move_iterator(files.end()));
+    };
+
+    auto threads = min(max(thread::hardware_concurrency(), 1u), MAX_LIST_THREADS);
+    vector<unique_ptr<Joinable>> helpers;
+    for (unsigned int i = 1; i < threads; i++) {
+        helpers.emplace_back(runInAThread("listFilesInDir", worker));
+    }
+    worker();
+    // Joins the helpers.
+    helpers.clear();
+
+    if (error != nullptr) {
+        rethrow_exception(error);
     }
-    closedir(dir);
 }
+} // namespace
 
 vector<string> sorbet::FileOps::listFilesInDir(string_view path, const UnorderedSet<string> &extensions, bool recursive,
                                                const std::vector<std::string> &absoluteIgnorePatterns,
                                                const std::vector<std::string> &relativeIgnorePatterns) {
+    IgnoreMatcher matcher(absoluteIgnorePatterns, relativeIgnorePatterns);
     vector<string> result;
-    appendFilesInDir(path, path, extensions, recursive, result, absoluteIgnorePatterns, relativeIgnorePatterns);
+    vector<PendingDir> subdirs;
+    // The top directory is listed on this thread, so that an error about it is thrown from here.
+    listDir(PendingDir{string(path), matcher.initialState()}, matcher, extensions, recursive, result, subdirs);
+    if (!subdirs.empty()) {
+        walkDirs(move(subdirs), matcher, extensions, result);
+    }
     fast_sort(result);
     return result;
 }
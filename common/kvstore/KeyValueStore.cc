@@ -1,4 +1,6 @@
 #include "common/kvstore/KeyValueStore.h"
+#include "absl/strings/str_cat.h"
+#include "common/Counters.h"
 
 #include <utility>
 
@@ -6,16 +8,45 @@ using namespace std;
 namespace sorbet {
 constexpr string_view OLD_VERSION_KEY = "VERSION"sv;
 constexpr string_view VERSION_KEY = "DB_FORMAT_VERSION"sv;
+constexpr string_view GENERATION_KEY = "DB_GENERATION"sv;
+// Part of the version of every store. Changes whenever the way the store keeps its own entries changes.
+constexpr string_view STORE_FORMAT = "uses2"sv;
 constexpr size_t MAX_DB_SIZE_BYTES =
     1L * 1024 * 1024 * 1024; // 1G. This is both maximum fs db size and max virtual memory usage.
+static_assert(KeyValueStore::DEFAULT_EVICTION_THRESHOLD_BYTES <= MAX_DB_SIZE_BYTES / 2);
+
+namespace {
+// The value of an entry of `usesDbi`.
+struct Use {
+    u4 generation;
+    u4 size;
+};
+
+Use readUse(const MDB_val &val) {
+    Use use;
+    ENFORCE(val.mv_size == sizeof(use));
+    memcpy(&use, val.mv_data, sizeof(use));
+    return use;
+}
+
+string_view readStringValue(const MDB_val &val) {
+    if (val.mv_data == nullptr) {
+        return string_view();
+    }
+    size_t sz;
+    memcpy(&sz, val.mv_data, sizeof(sz));
+    return string_view(((const char *)val.mv_data) + sizeof(sz), sz);
+}
+} // namespace
 
 static void throw_mdb_error(string_view what, int err) {
     fmt::print(stderr, "mdb error: {}: {}\n", what, mdb_strerror(err));
     throw invalid_argument(string(what));
 }
 
-KeyValueStore::KeyValueStore(string version, string path, string flavor)
-    : path(move(path)), flavor(move(flavor)), writerId(this_thread::get_id()) {
+KeyValueStore::KeyValueStore(string version, string path, string flavor, size_t evictionThresholdBytes)
+    : path(move(path)), flavor(move(flavor)), writerId(this_thread::get_id()),
+      evictionThresholdBytes(evictionThresholdBytes) {
     int rc;
     rc = mdb_env_create(&env);
     if (rc != 0) {
@@ -35,14 +66,24 @@ KeyValueStore::KeyValueStore(string version, string path, string flavor)
     }
     refreshMainTransaction();
     {
-        if (read(OLD_VERSION_KEY)) { // remove databases that use old(non-string) versioning scheme.
+        // remove databases that use old(non-string) versioning scheme.
+        if (lookup(OLD_VERSION_KEY).mv_data != nullptr) {
             clear();
         }
-        auto dbVersion = readString(VERSION_KEY);
-        if (dbVersion != version) {
+        auto fullVersion = absl::StrCat(version, "-", STORE_FORMAT);
+        auto dbVersion = readStringValue(lookup(VERSION_KEY));
+        if (dbVersion != fullVersion) {
             clear();
-            writeString(VERSION_KEY, version);
+            putString(VERSION_KEY, fullVersion);
         }
+
+        auto lastGeneration = lookup(GENERATION_KEY);
+        if (lastGeneration.mv_data != nullptr) {
+            memcpy(&generation, lastGeneration.mv_data, sizeof(generation));
+        }
+        generation++;
+        put(dbi, GENERATION_KEY, &generation, sizeof(generation));
+        evictLeastRecentlyUsed();
         return;
     }
 fail:
@@ -53,12 +94,21 @@ KeyValueStore::~KeyValueStore() noexcept(false) {
         return;
     }
 
+    reportStats();
     mdb_txn_abort(txn);
+    if (writerId == this_thread::get_id()) {
+        try {
+            commitUses();
+        } catch (invalid_argument &) {
+            // Forgetting what was read only makes eviction less accurate.
+        }
+    }
     mdb_close(env, dbi);
+    mdb_close(env, usesDbi);
     mdb_env_close(env);
 }
 
-void KeyValueStore::write(string_view key, const vector<u1> &value) {
+void KeyValueStore::put(MDB_dbi db, string_view key, const void *data, size_t size) {
     if (writerId != this_thread::get_id()) {
         throw invalid_argument("KeyValueStore can only write from thread that created it");
     }
@@ -66,17 +116,33 @@ void KeyValueStore::write(string_view key, const vector<u1> &value) {
     MDB_val dv;
     kv.mv_size = key.size();
     kv.mv_data = (void *)key.data();
-    dv.mv_size = value.size();
-    dv.mv_data = (void *)value.data();
+    dv.mv_size = size;
+    dv.mv_data = (void *)data;
 
     int rc;
-    rc = mdb_put(txn, dbi, &kv, &dv, 0);
+    rc = mdb_put(txn, db, &kv, &dv, 0);
     if (rc != 0) {
         throw invalid_argument("failed write into database");
     }
 }
 
-u1 *KeyValueStore::read(string_view key) {
+void KeyValueStore::write(string_view key, const vector<u1> &value) {
+    writePinned(key, value);
+    recordUse(key, value.size());
+}
+
+void KeyValueStore::writePinned(string_view key, const vector<u1> &value) {
+    put(dbi, key, value.data(), value.size());
+    prodCounterInc("kvstore.write.entries");
+    prodCounterAdd("kvstore.write.bytes", value.size());
+}
+
+void KeyValueStore::recordUse(string_view key, u4 size) {
+    Use use{generation, size};
+    put(usesDbi, key, &use, sizeof(use));
+}
+
+MDB_val KeyValueStore::lookup(string_view key) {
     MDB_txn *txn = nullptr;
     int rc = 0;
     {
@@ -105,13 +171,136 @@ u1 *KeyValueStore::read(string_view key) {
     rc = mdb_get(txn, dbi, &kv, &data);
     if (rc != 0) {
         if (rc == MDB_NOTFOUND) {
-            return nullptr;
+            return MDB_val{0, nullptr};
         }
         throw_mdb_error("failed read from the database"sv, rc);
     }
+    return data;
+}
+
+u1 *KeyValueStore::read(string_view key) {
+    auto data = lookup(key);
+    if (data.mv_data == nullptr) {
+        misses++;
+        prodCounterInc("kvstore.read.miss");
+        return nullptr;
+    }
+    hits++;
+    prodCounterInc("kvstore.read.hit");
+    prodCounterAdd("kvstore.read.bytes", data.mv_size);
+    {
+        absl::MutexLock lk(&readKeys_mtx);
+        readKeys.emplace(key);
+    }
     return (u1 *)data.mv_data;
 }
 
+u1 *KeyValueStore::readPinned(string_view key) {
+    return (u1 *)lookup(key).mv_data;
+}
+
+string_view KeyValueStore::readStringPinned(string_view key) {
+    return readStringValue(lookup(key));
+}
+
+void KeyValueStore::recordReads() {
+    absl::MutexLock lk(&readKeys_mtx);
+    for (auto &key : readKeys) {
+        MDB_val kv;
+        kv.mv_size = key.size();
+        kv.mv_data = (void *)key.data();
+        MDB_val data;
+        // Only what was written through `write` is tracked, and so can be evicted.
+        if (mdb_get(txn, usesDbi, &kv, &data) != 0) {
+            continue;
+        }
+        auto use = readUse(data);
+        if (use.generation != generation) {
+            recordUse(key, use.size);
+        }
+    }
+    readKeys.clear();
+}
+
+// Most runs only read from the store, and never commit. Their reads still count as uses: otherwise the entries that
+// every run needs would look as old as the last run that wrote anything, and be the first to go.
+void KeyValueStore::commitUses() {
+    {
+        absl::MutexLock lk(&readKeys_mtx);
+        if (readKeys.empty()) {
+            return;
+        }
+    }
+    refreshMainTransaction();
+    put(dbi, GENERATION_KEY, &generation, sizeof(generation));
+    recordReads();
+    auto rc = mdb_txn_commit(txn);
+    if (rc != 0) {
+        throw_mdb_error("failed to commit uses"sv, rc);
+    }
+}
+
+size_t KeyValueStore::usedBytes() {
+    size_t total = 0;
+    for (auto db : {dbi, usesDbi}) {
+        MDB_stat stat;
+        if (mdb_stat(txn, db, &stat) == 0) {
+            total += (stat.ms_branch_pages + stat.ms_leaf_pages + stat.ms_overflow_pages) * stat.ms_psize;
+        }
+    }
+    return total;
+}
+
+void KeyValueStore::evictLeastRecentlyUsed() {
+    auto used = usedBytes();
+    if (used <= evictionThresholdBytes) {
+        return;
+    }
+
+    vector<tuple<u4, u4, string>> entries; // generation, size, key
+    MDB_cursor *cursor;
+    int rc = mdb_cursor_open(txn, usesDbi, &cursor);
+    if (rc != 0) {
+        throw_mdb_error("failed to open cursor"sv, rc);
+    }
+    MDB_val kv;
+    MDB_val data;
+    while (mdb_cursor_get(cursor, &kv, &data, MDB_NEXT) == 0) {
+        auto use = readUse(data);
+        entries.emplace_back(use.generation, use.size, string((const char *)kv.mv_data, kv.mv_size));
+    }
+    mdb_cursor_close(cursor);
+    fast_sort(entries);
+
+    // Sizes of entries leave out LMDB's own overhead, so this frees somewhat less than it sets out to.
+    size_t toFree = used - evictionThresholdBytes / 2;
+    size_t freed = 0;
+    u4 evicted = 0;
+    for (auto &[entryGeneration, size, key] : entries) {
+        if (freed >= toFree) {
+            break;
+        }
+        kv.mv_size = key.size();
+        kv.mv_data = (void *)key.data();
+        mdb_del(txn, dbi, &kv, nullptr);
+        mdb_del(txn, usesDbi, &kv, nullptr);
+        freed += key.size() + size;
+        evicted++;
+    }
+    prodCounterAdd("kvstore.evicted.entries", evicted);
+    prodCounterAdd("kvstore.evicted.bytes", freed);
+    // Pages that are freed by a committed transaction can be reused by the next one.
+    commitAndRefresh();
+}
+
+void KeyValueStore::reportStats() {
+    u8 reads = hits + misses;
+    if (reads > 0) {
+        prodHistogramInc("kvstore.read.hit_rate_percent", hits * 100 / reads);
+    }
+    prodHistogramInc("kvstore.size_mb", usedBytes() / (1024 * 1024));
+}
+
 void KeyValueStore::clear() {
     if (writerId != this_thread::get_id()) {
         throw invalid_argument("KeyValueStore can only write from thread that created it");
@@ -120,20 +309,32 @@ void KeyValueStore::clear() {
     if (rc != 0) {
         goto fail;
     }
-    rc = mdb_txn_commit(txn);
+    rc = mdb_drop(txn, usesDbi, 0);
     if (rc != 0) {
         goto fail;
     }
-    refreshMainTransaction();
+    commitAndRefresh();
     return;
 fail:
     throw_mdb_error("failed to clear the database"sv, rc);
 }
 
+void KeyValueStore::commitAndRefresh() {
+    auto rc = mdb_txn_commit(txn);
+    if (rc != 0) {
+        throw_mdb_error("failed to commit transaction"sv, rc);
+    }
+    refreshMainTransaction();
+}
+
 string_view KeyValueStore::readString(string_view key) {
+    return readStringIfPresent(key).value_or(string_view());
+}
+
+optional<string_view> KeyValueStore::readStringIfPresent(string_view key) {
     auto rawData = read(key);
     if (!rawData) {
-        return string_view();
+        return nullopt;
     }
     size_t sz;
     memcpy(&sz, rawData, sizeof(sz));
@@ -141,12 +342,27 @@ string_view KeyValueStore::readString(string_view key) {
     return result;
 }
 
-void KeyValueStore::writeString(string_view key, string_view value) {
+namespace {
+vector<u1> encodeString(string_view value) {
     vector<u1> rawData(value.size() + sizeof(size_t));
     size_t sz = value.size();
     memcpy(rawData.data(), &sz, sizeof(sz));
     memcpy(rawData.data() + sizeof(sz), value.data(), sz);
-    write(key, move(rawData));
+    return rawData;
+}
+} // namespace
+
+void KeyValueStore::writeString(string_view key, string_view value) {
+    write(key, encodeString(value));
+}
+
+void KeyValueStore::writeStringPinned(string_view key, string_view value) {
+    writePinned(key, encodeString(value));
+}
+
+void KeyValueStore::putString(string_view key, string_view value) {
+    auto rawData = encodeString(value);
+    put(dbi, key, rawData.data(), rawData.size());
 }
 
 void KeyValueStore::refreshMainTransaction() {
@@ -161,6 +377,10 @@ void KeyValueStore::refreshMainTransaction() {
     if (rc != 0) {
         goto fail;
     }
+    rc = mdb_dbi_open(txn, absl::StrCat(flavor, "-uses").c_str(), MDB_CREATE, &usesDbi);
+    if (rc != 0) {
+        goto fail;
+    }
     // Per the docs for mdb_dbi_open:
     //
     // The database handle will be private to the current transaction
@@ -192,6 +412,8 @@ fail:
 
 bool KeyValueStore::commit(unique_ptr<KeyValueStore> k) {
     int rc;
+    k->recordReads();
+    k->reportStats();
     k->commited = true;
     rc = mdb_txn_commit(k->txn);
 
@@ -199,6 +421,7 @@ bool KeyValueStore::commit(unique_ptr<KeyValueStore> k) {
         return false;
     }
     mdb_close(k->env, k->dbi);
+    mdb_close(k->env, k->usesDbi);
     mdb_env_close(k->env);
     return true;
 }
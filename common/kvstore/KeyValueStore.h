@@ -3,6 +3,7 @@
 #include "absl/synchronization/mutex.h"
 #include "common/common.h"
 #include "lmdb.h"
+#include <atomic>
 #include <thread>
 namespace sorbet {
 
@@ -10,10 +11,16 @@ namespace sorbet {
  * A database with single writer and multiple readers.
  * Only the thread that created KeyValueStore is allowed to invoke Write.
  * Creating KeyValueStore grabs a lock and allows to have consistent view over database.
+ *
+ * Every opening of a store is a new generation. Entries remember the last generation that wrote or read them, and
+ * once a flavor grows past a share of the database's size, the entries that were used longest ago are evicted. Pinned
+ * entries are never evicted.
  */
 class KeyValueStore {
     MDB_env *env;
     MDB_dbi dbi;
+    // Maps the keys of `dbi` to the generation that last used them, and to their size.
+    MDB_dbi usesDbi;
     MDB_txn *txn;
     const std::string path;
     const std::string flavor;
@@ -21,11 +28,34 @@ class KeyValueStore {
     UnorderedMap<std::thread::id, MDB_txn *> readers;
     absl::Mutex readers_mtx;
     bool commited = false;
+    const size_t evictionThresholdBytes;
+    u4 generation = 0;
+    // Keys read in this generation, recorded as used when committing.
+    UnorderedSet<std::string> readKeys;
+    absl::Mutex readKeys_mtx;
+    std::atomic<u8> hits{0};
+    std::atomic<u8> misses{0};
 
     void clear();
     void refreshMainTransaction();
+    void commitAndRefresh();
+    MDB_val lookup(std::string_view key);
+    void put(MDB_dbi db, std::string_view key, const void *data, size_t size);
+    void putString(std::string_view key, std::string_view value);
+    void recordUse(std::string_view key, u4 size);
+    void recordReads();
+    void commitUses();
+    size_t usedBytes();
+    void evictLeastRecentlyUsed();
+    void reportStats();
 
 public:
+    /**
+     * Once a flavor is larger than this when opened, its least recently used entries are evicted until it is down to
+     * half of it. Flavors share the database, so each of them only gets to fill a part of it.
+     */
+    static constexpr size_t DEFAULT_EVICTION_THRESHOLD_BYTES = 512L * 1024 * 1024;
+
     /**
      * A KeyValueStore lives at a given `path` on disk, which must be
      * a pre-existing, writeable, directory.
@@ -43,13 +73,25 @@ public:
      * `KeyValueStore`s opened with different `flavor`s will not share
      * any entries, but each will see their own set of values.
      */
-    KeyValueStore(std::string version, std::string path, std::string flavor);
+    KeyValueStore(std::string version, std::string path, std::string flavor,
+                  size_t evictionThresholdBytes = DEFAULT_EVICTION_THRESHOLD_BYTES);
     /** returns nullptr if not found*/
     u1 *read(std::string_view key);
     std::string_view readString(std::string_view key);
+    /** Like `readString`, but tells a missing entry from an empty string. */
+    std::optional<std::string_view> readStringIfPresent(std::string_view key);
     void writeString(std::string_view key, std::string_view value);
     /** can only be called from main thread */
     void write(std::string_view key, const std::vector<u1> &value);
+    /**
+     * Like `write`, but the entry is never evicted. For the few entries that others are useless without, like the
+     * name table that cached trees refer to.
+     */
+    void writePinned(std::string_view key, const std::vector<u1> &value);
+    void writeStringPinned(std::string_view key, std::string_view value);
+    /** Reads pinned entries. They aren't counted as hits or misses, which are about the entries that can be evicted. */
+    u1 *readPinned(std::string_view key);
+    std::string_view readStringPinned(std::string_view key);
     ~KeyValueStore() noexcept(false);
     static bool commit(std::unique_ptr<KeyValueStore>);
 };
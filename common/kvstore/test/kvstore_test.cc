@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+// violates our requirements, thus has to go first
+#include "absl/strings/str_cat.h"
+#include "common/common.h"
+#include "common/kvstore/KeyValueStore.h"
+#include <cstdlib>
+
+using namespace std;
+
+namespace sorbet {
+
+namespace {
+// Large values take whole pages, so that the size of the store is predictable enough for a small threshold.
+constexpr size_t LARGE_VALUE_BYTES = 96 * 1024 - 16;
+
+string makeTempDir() {
+    char dir[] = "/tmp/kvstore_test.XXXXXX";
+    auto made = mkdtemp(dir);
+    EXPECT_NE(nullptr, made);
+    return dir;
+}
+} // namespace
+
+TEST(KeyValueStoreTest, EvictsLeastRecentlyUsed) { // NOLINT
+    auto dir = makeTempDir();
+    {
+        auto kvstore = make_unique<KeyValueStore>("1", dir, "test");
+        for (int i = 0; i < 10; i++) {
+            kvstore->write(absl::StrCat("large", i), vector<u1>(LARGE_VALUE_BYTES, i));
+            kvstore->writeString(absl::StrCat("small", i), "value");
+        }
+        kvstore->writeStringPinned("pinned", "value");
+        ASSERT_TRUE(KeyValueStore::commit(move(kvstore)));
+    }
+    {
+        // Closed without committing, like most runs that only read.
+        auto kvstore = make_unique<KeyValueStore>("1", dir, "test");
+        for (int i = 0; i < 10; i++) {
+            EXPECT_EQ("value", kvstore->readString(absl::StrCat("small", i)));
+        }
+    }
+    {
+        // Larger than the threshold, and freeing the large values alone gets it below half of it.
+        auto kvstore = make_unique<KeyValueStore>("1", dir, "test", 128 * 1024);
+        for (int i = 0; i < 10; i++) {
+            EXPECT_EQ(nullptr, kvstore->read(absl::StrCat("large", i)));
+            EXPECT_EQ("value", kvstore->readString(absl::StrCat("small", i)));
+        }
+        EXPECT_EQ("value", kvstore->readString("pinned"));
+    }
+    {
+        // What was evicted stays evicted.
+        auto kvstore = make_unique<KeyValueStore>("1", dir, "test");
+        EXPECT_EQ(nullptr, kvstore->read("large0"));
+        EXPECT_EQ("value", kvstore->readString("small0"));
+    }
+    system(absl::StrCat("rm -rf ", dir).c_str());
+}
+
+} // namespace sorbet
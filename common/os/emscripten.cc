@@ -15,4 +15,16 @@ bool setCurrentThreadName(string_view name) {
     return false;
 }
 
+size_t currentResidentMemory() {
+    return 0;
+}
+
+size_t peakResidentMemory() {
+    return 0;
+}
+
+bool pipeCloseOnExec(int fds[2]) {
+    return false;
+}
+
 #endif
@@ -5,8 +5,10 @@
 #include <csignal>
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <sstream>
 #include <string>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -108,4 +110,32 @@ bool bindThreadToCore(pthread_t handle, int coreId) {
     int rc = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuset);
     return rc == 0;
 }
+size_t currentResidentMemory() {
+    // The second field of statm is the number of resident pages.
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) {
+        return 0;
+    }
+    unsigned long totalPages = 0;
+    unsigned long residentPages = 0;
+    int read = fscanf(statm, "%lu %lu", &totalPages, &residentPages);
+    fclose(statm);
+    if (read != 2) {
+        return 0;
+    }
+    return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+size_t peakResidentMemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports kilobytes.
+    return usage.ru_maxrss * 1024;
+}
+
+bool pipeCloseOnExec(int fds[2]) {
+    return pipe2(fds, O_CLOEXEC) == 0;
+}
 #endif
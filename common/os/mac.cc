@@ -2,10 +2,13 @@
 #include "common/common.h"
 #include <cassert>
 #include <cstdio>
+#include <fcntl.h>
 #include <mach-o/dyld.h> /* _NSGetExecutablePath */
 
+#import <mach/mach.h>
 #import <mach/thread_act.h>
 #include <string>
+#include <sys/resource.h>
 #include <sys/sysctl.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -87,4 +90,37 @@ bool bindThreadToCore(pthread_t handle, int coreId) {
     auto ret = thread_policy_set(mach_thread, THREAD_AFFINITY_POLICY, (thread_policy_t)&policy, 1);
     return ret == 0;
 }
+size_t currentResidentMemory() {
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+}
+
+size_t peakResidentMemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // macOS reports bytes.
+    return usage.ru_maxrss;
+}
+
+bool pipeCloseOnExec(int fds[2]) {
+    // macOS has no pipe2, so a program that another thread execs before the flags are set inherits both ends.
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        int flags = fcntl(fds[i], F_GETFD);
+        if (flags == -1 || fcntl(fds[i], F_SETFD, flags | FD_CLOEXEC) == -1) {
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+    }
+    return true;
+}
 #endif
@@ -47,4 +47,12 @@ bool stopInDebugger();
 bool amIBeingDebugged();
 
 void intentionallyLeakMemory(void *ptr);
+
+// Resident memory of this process, in bytes. 0 if the platform doesn't tell us.
+size_t currentResidentMemory();
+// The largest resident memory this process ever had, in bytes. 0 if the platform doesn't tell us.
+size_t peakResidentMemory();
+// Like pipe(2), but both ends are closed in programs that this process execs. Returns false on failure. Atomic where
+// the platform has pipe2; elsewhere, a program that another thread execs meanwhile can inherit the ends.
+bool pipeCloseOnExec(int fds[2]);
 #endif // SORBET_OS_H
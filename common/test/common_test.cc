@@ -1,6 +1,11 @@
 #include "gtest/gtest.h"
 // violates our requirements, thus has to go first
+#include "absl/strings/str_split.h"
+#include "common/Arena.h"
+#include "common/FileOps.h"
+#include "common/IgnoreMatcher.h"
 #include "common/Levenstein.h"
+#include "common/PagedVector.h"
 #include "common/common.h"
 
 namespace sorbet::common {
@@ -12,4 +17,119 @@ TEST(CommonTest, Levenstein) { // NOLINT
     EXPECT_EQ(INT_MAX, Levenstein::distance("Java", "S", 1));
 }
 
+TEST(CommonTest, PagedVectorCopyOnWrite) { // NOLINT
+    PagedVector<int, 2> original;
+    for (int i = 0; i < 10; i++) {
+        original.emplace_back(i);
+    }
+    EXPECT_EQ(10u, original.size());
+    EXPECT_EQ(3u, original.pagesUsed());
+
+    auto copy = original;
+    EXPECT_EQ(3u, copy.sharedPages());
+
+    copy.mutableAt(5) = 42;
+    EXPECT_EQ(42, copy[5]);
+    EXPECT_EQ(5, original[5]);
+    EXPECT_EQ(2u, copy.sharedPages());
+
+    // The last page is shared, so appending to it must not be visible in the original.
+    copy.emplace_back(10);
+    EXPECT_EQ(11u, copy.size());
+    EXPECT_EQ(10u, original.size());
+    EXPECT_EQ(1u, copy.sharedPages());
+    EXPECT_EQ(8, original[8]);
+
+    int expected = 0;
+    for (auto elem : original) {
+        EXPECT_EQ(expected, elem);
+        expected++;
+    }
+    EXPECT_EQ(7u, original.indexOf(&original[7]));
+}
+
+namespace {
+struct ArenaNode {
+    static thread_local Arena *arena;
+    static int liveNodes;
+    std::unique_ptr<ArenaNode> child;
+    char payload[40];
+
+    ArenaNode() {
+        liveNodes++;
+    }
+    ~ArenaNode() {
+        liveNodes--;
+    }
+    static void *operator new(size_t size) {
+        return Arena::allocate(arena, size);
+    }
+    static void operator delete(void *ptr) {
+        Arena::deallocate(ptr);
+    }
+};
+thread_local Arena *ArenaNode::arena = nullptr;
+int ArenaNode::liveNodes = 0;
+} // namespace
+
+TEST(CommonTest, ArenaOutlivesScope) { // NOLINT
+    std::unique_ptr<ArenaNode> root;
+    {
+        Arena::Scope scope(ArenaNode::arena);
+        root = std::make_unique<ArenaNode>();
+        auto *last = root.get();
+        for (int i = 0; i < 2000; i++) {
+            last->child = std::make_unique<ArenaNode>();
+            last = last->child.get();
+        }
+        EXPECT_NE(nullptr, ArenaNode::arena);
+    }
+    EXPECT_EQ(nullptr, ArenaNode::arena);
+    // Nodes allocated outside of a scope come from the heap, and can be mixed with arena nodes.
+    root->child->child = std::make_unique<ArenaNode>();
+    EXPECT_EQ(3, ArenaNode::liveNodes);
+    root.reset();
+    EXPECT_EQ(0, ArenaNode::liveNodes);
+}
+
+TEST(CommonTest, IgnoreMatcherAgreesWithIsFileIgnored) { // NOLINT
+    std::vector<std::string> absolute = {"/vendor", "/app/generated"};
+    std::vector<std::string> relative = {"/node_modules", "/test/fixtures", "/foo.rb"};
+    IgnoreMatcher matcher(absolute, relative);
+
+    std::vector<std::string> paths = {
+        "/vendor/a.rb",
+        "/vendors/a.rb",
+        "/app/vendor/a.rb",
+        "/app/generated/a.rb",
+        "/app/generated.rb",
+        "/lib/node_modules",
+        "/lib/node_modules2/a.rb",
+        "/lib/test/fixtures/a.rb",
+        "/test/fixture/a.rb",
+        "/test/test/fixtures",
+        "/lib/foo.rb",
+        "/lib/foo.rbi",
+    };
+    for (auto &path : paths) {
+        // Walk down the path the way listFilesInDir does, stopping at the first ignored directory.
+        auto state = matcher.initialState();
+        IgnoreMatcher::State next;
+        bool ignored = false;
+        for (auto name : absl::StrSplit(std::string_view(path).substr(1), '/')) {
+            if (matcher.enter(state, name, next)) {
+                ignored = true;
+                break;
+            }
+            state = next;
+        }
+        EXPECT_EQ(FileOps::isFileIgnored("", path, absolute, relative), ignored) << path;
+    }
+
+    // An empty absolute pattern comes from `--ignore /`, and ignores everything.
+    IgnoreMatcher everything({""}, {});
+    IgnoreMatcher::State next;
+    EXPECT_TRUE(everything.enter(everything.initialState(), "a.rb", next));
+}
+
 } // namespace sorbet::common
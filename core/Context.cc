@@ -135,6 +135,9 @@ GlobalSubstitution::GlobalSubstitution(const GlobalState &from, GlobalState &to,
     to.sanityCheck();
 }
 
+GlobalSubstitution::GlobalSubstitution(vector<NameRef> nameSubstitution, const GlobalState &to)
+    : nameSubstitution(move(nameSubstitution)), fastPath(false), toGlobalStateId(to.globalStateId) {}
+
 bool GlobalSubstitution::useFastPath() const {
     return fastPath;
 }
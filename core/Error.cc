@@ -105,10 +105,23 @@ string Error::toString(const GlobalState &gs) const {
     return buf.str();
 }
 
+namespace {
+thread_local FileRef regionFile;
+}
+
+ErrorRegion::ErrorRegion(const GlobalState &gs, FileRef f) : gs(gs), f(f) {
+    regionFile = f;
+}
+
 ErrorRegion::~ErrorRegion() {
+    regionFile = FileRef();
     gs.errorQueue->markFileForFlushing(this->f);
 }
 
+FileRef ErrorRegion::current() {
+    return regionFile;
+}
+
 ErrorBuilder::ErrorBuilder(const GlobalState &gs, bool willBuild, Loc loc, ErrorClass what)
     : gs(gs), state(willBuild ? State::WillBuild : State::Unreported), loc(loc), what(what) {
     ENFORCE(willBuild || what.minLevel != StrictLevel::Internal);
@@ -166,6 +179,10 @@ void ErrorColors::enableColors() {
     buf << INTERPOLATION_COLOR << "{}" << REVERT_COLOR_SIGIL;
     coloredPatternReplace = buf.str();
 }
+bool ErrorColors::enabled() {
+    return coloredPatternReplace != coloredPatternSigil;
+}
+
 void ErrorColors::disableColors() {
     coloredPatternReplace = coloredPatternSigil;
     rang::setControlMode(rang::control::Off);
@@ -39,6 +39,7 @@ public:
     }
     static void enableColors();
     static void disableColors();
+    static bool enabled();
 };
 
 struct ErrorLine {
@@ -96,9 +97,12 @@ public:
  */
 class ErrorRegion {
 public:
-    ErrorRegion(const GlobalState &gs, FileRef f) : gs(gs), f(f){};
+    ErrorRegion(const GlobalState &gs, FileRef f);
     ~ErrorRegion();
 
+    /** The file of the region the calling thread is in, if any. Errors pushed from that thread are tagged with it. */
+    static FileRef current();
+
 private:
     const GlobalState &gs;
     FileRef f;
@@ -54,6 +54,9 @@ vector<unique_ptr<core::Error>> ErrorQueue::drainAllErrors() {
 void ErrorQueue::flushErrors(bool all) {
     checkOwned();
     if (ignoreFlushes) {
+        if (onFlush) {
+            reportFlushed();
+        }
         return;
     }
 
@@ -64,9 +67,45 @@ void ErrorQueue::flushErrors(bool all) {
     } else {
         errors = drainFlushed();
     }
+    if (onFlushedError) {
+        for (auto &error : errors) {
+            if (error->kind == ErrorQueueMessage::Kind::Error) {
+                onFlushedError(*error);
+            }
+        }
+    }
     errorFlusher.flushErrors(logger, move(errors));
 }
 
+void ErrorQueue::observeFlushedErrors(function<void(const ErrorQueueMessage &)> onFlushedError) {
+    checkOwned();
+    this->onFlushedError = move(onFlushedError);
+}
+
+void ErrorQueue::streamFlushes(function<void(FileRef, const vector<ErrorQueueMessage> &)> onFlush) {
+    checkOwned();
+    ENFORCE(ignoreFlushes);
+    // Files flushed before this call are not reported.
+    this->onFlush = nullptr;
+    reportFlushed();
+    this->onFlush = move(onFlush);
+}
+
+void ErrorQueue::reportFlushed() {
+    static const vector<ErrorQueueMessage> empty;
+    core::ErrorQueueMessage msg;
+    for (auto result = queue.try_pop(msg); result.gotItem(); result = queue.try_pop(msg)) {
+        if (msg.kind == core::ErrorQueueMessage::Kind::Flush) {
+            if (onFlush) {
+                auto fnd = collected.find(msg.whatFile);
+                onFlush(msg.whatFile, fnd == collected.end() ? empty : fnd->second);
+            }
+        } else {
+            collected[msg.whatFile].emplace_back(move(msg));
+        }
+    }
+}
+
 void ErrorQueue::flushErrorCount() {
     errorFlusher.flushErrorCount(logger, nonSilencedErrorCount);
 }
@@ -76,13 +115,23 @@ void ErrorQueue::flushAutocorrects(const GlobalState &gs, FileSystem &fs) {
 }
 
 void ErrorQueue::pushError(const core::GlobalState &gs, unique_ptr<core::Error> error) {
+    auto text = error->toString(gs);
+    pushMessage(move(error), move(text));
+}
+
+void ErrorQueue::pushCachedError(unique_ptr<core::Error> error, string text) {
+    pushMessage(move(error), move(text));
+}
+
+void ErrorQueue::pushMessage(unique_ptr<core::Error> error, string text) {
     if (!error->isSilenced) {
         this->nonSilencedErrorCount.fetch_add(1);
     }
     core::ErrorQueueMessage msg;
     msg.kind = core::ErrorQueueMessage::Kind::Error;
     msg.whatFile = error->loc.file();
-    msg.text = error->toString(gs);
+    msg.regionFile = ErrorRegion::current();
+    msg.text = move(text);
     msg.error = move(error);
     this->queue.push(move(msg), 1);
 }
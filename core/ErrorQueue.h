@@ -6,6 +6,7 @@
 #include "core/ErrorQueueMessage.h"
 #include "core/lsp/QueryResponse.h"
 #include <atomic>
+#include <functional>
 
 namespace sorbet {
 class FileSystem;
@@ -17,10 +18,14 @@ private:
     std::vector<std::unique_ptr<ErrorQueueMessage>> drainAll();
     std::vector<std::unique_ptr<ErrorQueueMessage>> drainFlushed();
     void collectForFile(core::FileRef whatFile, std::vector<std::unique_ptr<core::ErrorQueueMessage>> &out);
+    void reportFlushed();
     ErrorFlusher errorFlusher;
     const std::thread::id owner;
     UnorderedMap<core::FileRef, std::vector<core::ErrorQueueMessage>> collected;
     ConcurrentUnBoundedQueue<core::ErrorQueueMessage> queue;
+    std::function<void(FileRef, const std::vector<ErrorQueueMessage> &)> onFlush;
+    std::function<void(const ErrorQueueMessage &)> onFlushedError;
+    void pushMessage(std::unique_ptr<Error> error, std::string text);
 
 public:
     spdlog::logger &logger;
@@ -33,6 +38,8 @@ public:
 
     /** register a new error to be reported */
     void pushError(const GlobalState &gs, std::unique_ptr<Error> error);
+    /** register an error that an earlier run reported as `text` */
+    void pushCachedError(std::unique_ptr<Error> error, std::string text);
     void pushQueryResponse(std::unique_ptr<lsp::QueryResponse> response);
     /** indicate that errors for `file` should be flushed on next call to to flushErrors */
     void markFileForFlushing(FileRef file);
@@ -44,6 +51,17 @@ public:
     std::vector<std::unique_ptr<core::Error>> drainAllErrors();
 
     void flushErrors(bool all = false);
+    /**
+     * While flushes are ignored, calls `onFlush` with everything collected for a file each time it is flushed from now
+     * on, until called again with nullptr. The errors stay in the queue. Used by LSP to publish diagnostics for some
+     * files before a typecheck run is over.
+     */
+    void streamFlushes(std::function<void(FileRef, const std::vector<ErrorQueueMessage> &)> onFlush);
+    /**
+     * Calls `onFlushedError` with every error right before it is printed, until called again with nullptr. Used to
+     * remember the errors of a file for a later run.
+     */
+    void observeFlushedErrors(std::function<void(const ErrorQueueMessage &)> onFlushedError);
     void flushErrorCount();
     void flushAutocorrects(const GlobalState &gs, FileSystem &fs);
 };
@@ -11,6 +11,8 @@ struct ErrorQueueMessage {
     enum class Kind { Error, Flush, QueryResponse };
     Kind kind;
     core::FileRef whatFile;
+    // The file whose region pushed the error. It differs from `whatFile` for errors reported in other files.
+    core::FileRef regionFile;
     std::string text;
     std::unique_ptr<Error> error;
     std::unique_ptr<lsp::QueryResponse> queryResponse;
@@ -97,23 +97,49 @@ StrictLevel File::fileSigil(string_view source) {
     }
 }
 
+optional<StrictLevel> File::fileSigilFromPrefix(string_view prefix, bool isWholeFile) {
+    if (isWholeFile) {
+        return fileSigil(prefix);
+    }
+    // `fileSigil` never looks past the end of the line holding the sigil it returns, so a sigil found in the complete
+    // lines of the prefix is the one it would find in the whole file.
+    auto lastNewline = prefix.rfind('\n');
+    if (lastNewline == string_view::npos) {
+        return nullopt;
+    }
+    auto sigil = fileSigil(prefix.substr(0, lastNewline + 1));
+    if (sigil == StrictLevel::None) {
+        return nullopt;
+    }
+    return sigil;
+}
+
+namespace {
+string padSource(string &&source) {
+    source.append("\0\0", 2);
+    return move(source);
+}
+
+string_view withoutPadding(const string &source) {
+    return string_view(source).substr(0, source.size() - 2);
+}
+} // namespace
+
 File::File(string &&path_, string &&source_, Type sourceType)
-    : sourceType(sourceType), path_(path_), source_(source_), originalSigil(fileSigil(this->source_)),
-      strictLevel(originalSigil) {}
+    : sourceType(sourceType), path_(move(path_)), source_(padSource(move(source_))),
+      originalSigil(fileSigil(withoutPadding(this->source_))), strictLevel(originalSigil) {}
 
 unique_ptr<File> File::deepCopy(GlobalState &gs) const {
-    string sourceCopy = source_;
+    string sourceCopy(source());
     string pathCopy = path_;
     auto ret = make_unique<File>(move(pathCopy), move(sourceCopy), sourceType);
     ret->lineBreaks_ = lineBreaks_;
-    ret->minErrorLevel_ = minErrorLevel_;
+    ret->minErrorLevel_ = minErrorLevel_.load();
     ret->strictLevel = strictLevel;
     return ret;
 }
 
-FileRef::FileRef(unsigned int id) : _id(id) {
-    ENFORCE(((u2)id) == id, "FileRef overflow. Do you have 2^16 files?");
-}
+FileRef::FileRef(unsigned int id) : _id(id) {}
 
 const File &FileRef::data(const GlobalState &gs) const {
     ENFORCE(gs.files[_id]->sourceType != File::TombStone);
@@ -144,11 +170,11 @@ string_view File::path() const {
 string_view File::source() const {
     ENFORCE(this->sourceType != Type::TombStone);
     ENFORCE(this->sourceType != File::NotYetRead);
-    return this->source_;
+    return withoutPadding(this->source_);
 }
 
 StrictLevel File::minErrorLevel() const {
-    return minErrorLevel_;
+    return minErrorLevel_.load();
 }
 
 bool File::isPayload() const {
@@ -170,7 +196,7 @@ vector<int> &File::lineBreaks() const {
     if (ptr) {
         return *ptr;
     } else {
-        auto my = make_shared<vector<int>>(findLineBreaks(this->source_));
+        auto my = make_shared<vector<int>>(findLineBreaks(source()));
         atomic_compare_exchange_weak(&lineBreaks_, &ptr, my);
         return lineBreaks();
     }
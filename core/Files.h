@@ -3,6 +3,7 @@
 
 #include "core/Names.h"
 #include "core/StrictLevel.h"
+#include <atomic>
 #include <string>
 
 namespace sorbet::core {
@@ -39,7 +40,7 @@ public:
         return _id > rhs._id;
     }
 
-    inline u2 id() const {
+    inline u4 id() const {
         return _id;
     }
 
@@ -53,9 +54,9 @@ public:
     File &dataAllowingUnsafe(GlobalState &gs) const;
 
 private:
-    u2 _id;
+    u4 _id;
 };
-CheckSize(FileRef, 2, 2);
+CheckSize(FileRef, 4, 4);
 
 class File final {
 public:
@@ -75,6 +76,8 @@ public:
     friend class ::sorbet::core::serialize::SerializerImpl;
 
     static StrictLevel fileSigil(std::string_view source);
+    // The sigil of a file whose first bytes are `prefix`, if they are enough to tell without reading the rest.
+    static std::optional<StrictLevel> fileSigilFromPrefix(std::string_view prefix, bool isWholeFile);
 
     std::string_view path() const;
     std::string_view source() const;
@@ -98,9 +101,12 @@ public:
 
 private:
     const std::string path_;
+    // Followed by two NULs that `source()` leaves out, so that the parser can lex it in place.
     const std::string source_;
     mutable std::shared_ptr<std::vector<int>> lineBreaks_;
-    mutable StrictLevel minErrorLevel_ = StrictLevel::Max;
+    // Files are shared between GlobalStates, and LSP reports errors to two of them at once: one on the main thread and
+    // one on the snapshot query thread.
+    mutable std::atomic<StrictLevel> minErrorLevel_{StrictLevel::Max};
 
 public:
     const StrictLevel originalSigil;
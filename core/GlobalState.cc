@@ -1,6 +1,7 @@
 #include "GlobalState.h"
 
 #include "common/Timer.h"
+#include "common/typecase.h"
 #include "core/Error.h"
 #include "core/Hashing.h"
 #include "core/NameHash.h"
@@ -27,7 +28,7 @@ SymbolRef GlobalState::synthesizeClass(NameRef nameId, u4 superclass, bool isMod
     // This can't use enterClass since there is a chicken and egg problem.
     // These will be added to Symbols::root().members later.
     SymbolRef symRef = SymbolRef(this, symbols.size());
-    symbols.emplace_back();
+    symbols.emplace_back().id = symRef._id;
     SymbolData data = symRef.dataAllowingNone(*this); // allowing noSymbol is needed because this enters noSymbol.
     data->name = nameId;
     data->owner = Symbols::root();
@@ -47,7 +48,7 @@ const int Symbols::MAX_PROC_ARITY;
 
 GlobalState::GlobalState(shared_ptr<ErrorQueue> errorQueue)
     : globalStateId(globalStateIdCounter.fetch_add(1)), errorQueue(std::move(errorQueue)),
-      lspQuery(lsp::Query::noQuery()) {
+      lspQuery(lsp::Query::noQuery()), typecheckCanceled(make_shared<atomic<bool>>(false)) {
     // Empirically determined to be the smallest powers of two larger than the
     // values required by the payload
     unsigned int maxNameCount = 8192;
@@ -64,9 +65,9 @@ void GlobalState::initEmpty() {
     UnfreezeFileTable fileTableAccess(*this);
     UnfreezeNameTable nameTableAccess(*this);
     UnfreezeSymbolTable symTableAccess(*this);
-    names.emplace_back(); // first name is used in hashes to indicate empty cell
-    names[0].kind = NameKind::UTF8;
-    names[0].raw.utf8 = string_view();
+    auto &emptyName = names.emplace_back(); // first name is used in hashes to indicate empty cell
+    emptyName.kind = NameKind::UTF8;
+    emptyName.raw.utf8 = string_view();
     Names::registerNames(*this);
 
     SymbolRef id;
@@ -551,6 +552,25 @@ void GlobalState::reserveMemory(u4 kb) {
                        " names=", names.capacity()));
 }
 
+int GlobalState::reserveTables(u4 nameCount, u4 symbolCount, u4 fileCount) {
+    // namesByHash is twice as big as `names`, and has to fit its indices in an unsigned int.
+    constexpr u4 MAX_NAMES = 1u << 30;
+    int doublings = 0;
+    for (u4 capacity = names.capacity(); capacity < nameCount && capacity < MAX_NAMES; capacity *= 2) {
+        doublings++;
+    }
+    if (doublings > 0) {
+        expandNames(1 << doublings);
+    }
+    symbols.reserve(symbolCount);
+    files.reserve(fileCount);
+    sanityCheck();
+
+    trace(absl::StrCat("Reserved tables for ", nameCount, " names, ", symbolCount, " symbols and ", fileCount,
+                       " files. symbols=", symbols.capacity(), " names=", names.capacity()));
+    return doublings;
+}
+
 constexpr decltype(GlobalState::STRINGS_PAGE_SIZE) GlobalState::STRINGS_PAGE_SIZE;
 
 SymbolRef GlobalState::enterSymbol(Loc loc, SymbolRef owner, NameRef name, u4 flags) {
@@ -570,7 +590,7 @@ SymbolRef GlobalState::enterSymbol(Loc loc, SymbolRef owner, NameRef name, u4 fl
 
     SymbolRef ret = SymbolRef(this, symbols.size());
     store = ret; // DO NOT MOVE this assignment down. emplace_back on symbol invalidates `store`
-    symbols.emplace_back();
+    symbols.emplace_back().id = ret._id;
     SymbolData data = ret.dataAllowingNone(*this);
     data->name = name;
     data->flags = flags;
@@ -754,7 +774,7 @@ NameRef GlobalState::enterNameUTF8(string_view nm) {
             auto &nm2 = names[nameId];
             if (nm2.kind == NameKind::UTF8 && nm2.raw.utf8 == nm) {
                 counterInc("names.utf8.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, nameId);
             } else {
                 counterInc("names.hash_collision.utf8");
             }
@@ -767,6 +787,8 @@ NameRef GlobalState::enterNameUTF8(string_view nm) {
     ENFORCE(probeCount != hashTableSize, "Full table?");
 
     if (names.size() == names.capacity()) {
+        // Presizing in `reserveTables` also expands the tables, but only running out of room is a resize.
+        prodCounterInc("names.resizes");
         expandNames();
         hashTableSize = namesByHash.size();
         mask = hashTableSize - 1;
@@ -779,14 +801,14 @@ NameRef GlobalState::enterNameUTF8(string_view nm) {
     }
 
     auto idx = names.size();
-    auto &bucket = namesByHash[bucketId];
+    auto &bucket = namesByHash.mutableAt(bucketId);
     bucket.first = hs;
     bucket.second = idx;
-    names.emplace_back();
+    auto &inserted = names.emplace_back();
 
-    names[idx].kind = NameKind::UTF8;
-    names[idx].raw.utf8 = enterString(nm);
-    ENFORCE(names[idx].hash(*this) == hs);
+    inserted.kind = NameKind::UTF8;
+    inserted.raw.utf8 = enterString(nm);
+    ENFORCE(inserted.hash(*this) == hs);
     categoryCounterInc("names", "utf8");
 
     wasModified_ = true;
@@ -812,7 +834,7 @@ NameRef GlobalState::enterNameConstant(NameRef original) {
             auto &nm2 = names[bucket.second];
             if (nm2.kind == CONSTANT && nm2.cnst.original == original) {
                 counterInc("names.constant.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, bucket.second);
             } else {
                 counterInc("names.hash_collision.constant");
             }
@@ -826,6 +848,7 @@ NameRef GlobalState::enterNameConstant(NameRef original) {
     ENFORCE(!nameTableFrozen);
 
     if (names.size() == names.capacity()) {
+        prodCounterInc("names.resizes");
         expandNames();
         hashTableSize = namesByHash.size();
         mask = hashTableSize - 1;
@@ -838,16 +861,16 @@ NameRef GlobalState::enterNameConstant(NameRef original) {
         }
     }
 
-    auto &bucket = namesByHash[bucketId];
+    auto &bucket = namesByHash.mutableAt(bucketId);
     bucket.first = hs;
     bucket.second = names.size();
 
     auto idx = names.size();
-    names.emplace_back();
+    auto &inserted = names.emplace_back();
 
-    names[idx].kind = CONSTANT;
-    names[idx].cnst.original = original;
-    ENFORCE(names[idx].hash(*this) == hs);
+    inserted.kind = CONSTANT;
+    inserted.cnst.original = original;
+    ENFORCE(inserted.hash(*this) == hs);
     wasModified_ = true;
     categoryCounterInc("names", "constant");
     return NameRef(*this, idx);
@@ -857,8 +880,9 @@ NameRef GlobalState::enterNameConstant(string_view original) {
     return enterNameConstant(enterNameUTF8(original));
 }
 
-void moveNames(pair<unsigned int, unsigned int> *from, pair<unsigned int, unsigned int> *to, unsigned int szFrom,
-               unsigned int szTo) {
+template <class Table> void moveNames(const Table &from, Table &to) {
+    auto szFrom = from.size();
+    auto szTo = to.size();
     // printf("\nResizing name hash table from %u to %u\n", szFrom, szTo);
     ENFORCE((szTo & (szTo - 1)) == 0, "name hash table size corruption");
     ENFORCE((szFrom & (szFrom - 1)) == 0, "name hash table size corruption");
@@ -872,7 +896,7 @@ void moveNames(pair<unsigned int, unsigned int> *from, pair<unsigned int, unsign
                 bucketId = (bucketId + probe) & mask;
                 probe++;
             }
-            to[bucketId] = from[orig];
+            to.mutableAt(bucketId) = from[orig];
         }
     }
 }
@@ -881,9 +905,10 @@ void GlobalState::expandNames(int growBy) {
     sanityCheck();
 
     names.reserve(names.capacity() * growBy);
-    vector<pair<unsigned int, unsigned int>> new_namesByHash(namesByHash.capacity() * growBy);
-    moveNames(namesByHash.data(), new_namesByHash.data(), namesByHash.size(), new_namesByHash.capacity());
-    namesByHash.swap(new_namesByHash);
+    decltype(namesByHash) new_namesByHash;
+    new_namesByHash.resize(namesByHash.capacity() * growBy);
+    moveNames(namesByHash, new_namesByHash);
+    namesByHash = std::move(new_namesByHash);
 }
 
 NameRef GlobalState::getNameUnique(UniqueNameKind uniqueNameKind, NameRef original, u2 num) const {
@@ -901,7 +926,7 @@ NameRef GlobalState::getNameUnique(UniqueNameKind uniqueNameKind, NameRef origin
             if (nm2.kind == UNIQUE && nm2.unique.uniqueNameKind == uniqueNameKind && nm2.unique.num == num &&
                 nm2.unique.original == original) {
                 counterInc("names.unique.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, bucket.second);
             } else {
                 counterInc("names.hash_collision.unique");
             }
@@ -927,7 +952,7 @@ NameRef GlobalState::freshNameUnique(UniqueNameKind uniqueNameKind, NameRef orig
             if (nm2.kind == UNIQUE && nm2.unique.uniqueNameKind == uniqueNameKind && nm2.unique.num == num &&
                 nm2.unique.original == original) {
                 counterInc("names.unique.hit");
-                return nm2.ref(*this);
+                return NameRef(*this, bucket.second);
             } else {
                 counterInc("names.hash_collision.unique");
             }
@@ -941,6 +966,7 @@ NameRef GlobalState::freshNameUnique(UniqueNameKind uniqueNameKind, NameRef orig
     ENFORCE(!nameTableFrozen);
 
     if (names.size() == names.capacity()) {
+        prodCounterInc("names.resizes");
         expandNames();
         hashTableSize = namesByHash.size();
         mask = hashTableSize - 1;
@@ -953,18 +979,18 @@ NameRef GlobalState::freshNameUnique(UniqueNameKind uniqueNameKind, NameRef orig
         }
     }
 
-    auto &bucket = namesByHash[bucketId];
+    auto &bucket = namesByHash.mutableAt(bucketId);
     bucket.first = hs;
     bucket.second = names.size();
 
     auto idx = names.size();
-    names.emplace_back();
+    auto &inserted = names.emplace_back();
 
-    names[idx].kind = UNIQUE;
-    names[idx].unique.num = num;
-    names[idx].unique.uniqueNameKind = uniqueNameKind;
-    names[idx].unique.original = original;
-    ENFORCE(names[idx].hash(*this) == hs);
+    inserted.kind = UNIQUE;
+    inserted.unique.num = num;
+    inserted.unique.uniqueNameKind = uniqueNameKind;
+    inserted.unique.original = original;
+    ENFORCE(inserted.hash(*this) == hs);
     wasModified_ = true;
     categoryCounterInc("names", "unique");
     return NameRef(*this, idx);
@@ -1046,6 +1072,89 @@ unsigned int GlobalState::namesUsed() const {
     return names.size();
 }
 
+namespace {
+template <class T> u8 vectorBytes(const std::vector<T> &vec) {
+    return vec.capacity() * sizeof(T);
+}
+
+// Types are shared, so each one is only counted the first time it's seen.
+u8 typeBytes(const TypePtr &type, UnorderedSet<const Type *> &seen) {
+    if (type == nullptr || !seen.insert(type.get()).second) {
+        return 0;
+    }
+    u8 bytes = 0;
+    typecase(
+        type.get(),
+        [&](OrType *o) { bytes = sizeof(OrType) + typeBytes(o->left, seen) + typeBytes(o->right, seen); },
+        [&](AndType *a) { bytes = sizeof(AndType) + typeBytes(a->left, seen) + typeBytes(a->right, seen); },
+        [&](ShapeType *shape) {
+            bytes = sizeof(ShapeType) + vectorBytes(shape->keys) + vectorBytes(shape->values);
+            for (auto &key : shape->keys) {
+                bytes += typeBytes(key, seen);
+            }
+            for (auto &value : shape->values) {
+                bytes += typeBytes(value, seen);
+            }
+        },
+        [&](TupleType *tuple) {
+            bytes = sizeof(TupleType) + vectorBytes(tuple->elems);
+            for (auto &elem : tuple->elems) {
+                bytes += typeBytes(elem, seen);
+            }
+        },
+        [&](AppliedType *applied) {
+            bytes = sizeof(AppliedType) + vectorBytes(applied->targs);
+            for (auto &targ : applied->targs) {
+                bytes += typeBytes(targ, seen);
+            }
+        },
+        [&](MetaType *meta) { bytes = sizeof(MetaType) + typeBytes(meta->wrapped, seen); },
+        [&](LiteralType *literal) { bytes = sizeof(LiteralType); },
+        [&](ClassType *klass) { bytes = sizeof(ClassType); },
+        [&](Type *other) { bytes = sizeof(Type); });
+    return bytes;
+}
+} // namespace
+
+vector<TableMemory> GlobalState::memoryUsage() const {
+    vector<TableMemory> res;
+    res.push_back({"names", names.size(), u8(names.capacity()) * sizeof(Name)});
+    res.push_back({"namesByHash", namesByHash.size(),
+                   u8(namesByHash.capacity()) * sizeof(decltype(namesByHash)::value_type)});
+    res.push_back({"strings", strings.size(), u8(strings.size()) * STRINGS_PAGE_SIZE});
+
+    u8 symbolBytes = u8(symbols.capacity()) * sizeof(Symbol);
+    u8 typesBytes = 0;
+    UnorderedSet<const Type *> seenTypes;
+    for (auto &sym : symbols) {
+        symbolBytes += sym.members().capacity() * sizeof(pair<NameRef, SymbolRef>) + vectorBytes(sym.arguments());
+        typesBytes += typeBytes(sym.resultType, seenTypes);
+        for (auto &arg : sym.arguments()) {
+            typesBytes += typeBytes(arg.type, seenTypes);
+        }
+    }
+    res.push_back({"symbols", symbols.size(), symbolBytes});
+
+    u8 fileBytes = vectorBytes(files);
+    u8 lineBreakCount = 0;
+    u8 lineBreakBytes = 0;
+    for (auto &file : files) {
+        if (!file) {
+            continue;
+        }
+        fileBytes += sizeof(File) + file->path_.capacity() + file->source_.capacity();
+        // Line breaks are computed lazily, and concurrently with this in LSP.
+        if (auto lineBreaks = atomic_load(&file->lineBreaks_)) {
+            lineBreakCount += lineBreaks->size();
+            lineBreakBytes += vectorBytes(*lineBreaks);
+        }
+    }
+    res.push_back({"files", files.size(), fileBytes});
+    res.push_back({"lineBreaks", lineBreakCount, lineBreakBytes});
+    res.push_back({"types", seenTypes.size(), typesBytes});
+    return res;
+}
+
 string GlobalState::toStringWithOptions(bool showFull, bool showRaw) const {
     return Symbols::root().data(*this)->toStringWithOptions(*this, 0, showFull, showRaw);
 }
@@ -1156,23 +1265,13 @@ unique_ptr<GlobalState> GlobalState::deepCopy(bool keepId) const {
     result->onlyErrorClasses = this->onlyErrorClasses;
     result->dslPlugins = this->dslPlugins;
     result->dslRubyExtraArgs = this->dslRubyExtraArgs;
-    result->names.reserve(this->names.capacity());
-    if (keepId) {
-        result->names.resize(this->names.size());
-        ::memcpy(result->names.data(), this->names.data(), this->names.size() * sizeof(Name));
-    } else {
-        for (auto &nm : this->names) {
-            result->names.emplace_back(nm.deepCopy(*result));
-        }
-    }
-
-    result->namesByHash.reserve(this->namesByHash.size());
+    result->dslPersistentPlugins = this->dslPersistentPlugins;
+    result->dslPluginScriptHashes = this->dslPluginScriptHashes;
+    // These only copy page tables. Pages are shared with `this` until either side writes to them. NameRefs stored in
+    // shared pages keep the id of the GlobalState that created them, which is fine: `deepCloneHistory` records it.
+    result->names = this->names;
     result->namesByHash = this->namesByHash;
-
-    result->symbols.reserve(this->symbols.size());
-    for (auto &sym : this->symbols) {
-        result->symbols.emplace_back(sym.deepCopy(*result, keepId));
-    }
+    result->symbols = this->symbols;
     result->pathPrefix = this->pathPrefix;
     result->sanityCheck();
     {
@@ -1182,6 +1281,81 @@ unique_ptr<GlobalState> GlobalState::deepCopy(bool keepId) const {
     return result;
 }
 
+unique_ptr<GlobalState> GlobalState::compactNames(u4 firstCollectable, vector<bool> live,
+                                                  vector<NameRef> &substitution) const {
+    Timer timeit(tracer(), "GlobalState::compactNames");
+    ENFORCE(firstCollectable > Names::LAST_WELL_KNOWN_NAME, "well known names can't be collected");
+    live.resize(names.size());
+    // Names are entered after the names they are built from, so one pass from the back marks everything needed.
+    for (u4 id = names.size(); id-- > firstCollectable;) {
+        if (!live[id]) {
+            continue;
+        }
+        auto &nm = names[id];
+        if (nm.kind == NameKind::CONSTANT) {
+            live[nm.cnst.original.id()] = true;
+        } else if (nm.kind == NameKind::UNIQUE) {
+            live[nm.unique.original.id()] = true;
+        }
+    }
+
+    auto result = deepCopy();
+    // Names from `this` that were collected must not be used with the copy.
+    for (auto &entry : result->deepCloneHistory) {
+        entry.lastNameKnownByParentGlobalState = min(entry.lastNameKnownByParentGlobalState, firstCollectable);
+    }
+    // Strings are entered anew, so that the pages of collected names are freed along with `this`.
+    result->strings.clear();
+    result->stringsLastPageUsed = STRINGS_PAGE_SIZE + 1;
+    result->names.clear();
+    result->namesByHash.clear();
+    u4 liveCount = 0;
+    for (u4 id = 0; id < names.size(); id++) {
+        if (id < firstCollectable || live[id]) {
+            liveCount++;
+        }
+    }
+    u4 capacity = max(nextPowerOfTwo(liveCount), 8192u);
+    result->names.reserve(capacity);
+    result->namesByHash.resize(2 * capacity);
+
+    UnfreezeNameTable nameTableAccess(*result);
+    substitution.clear();
+    substitution.reserve(names.size());
+    for (u4 id = 0; id < names.size(); id++) {
+        if (id >= firstCollectable && !live[id]) {
+            substitution.emplace_back();
+            continue;
+        }
+        auto &nm = names[id];
+        if (id == 0) {
+            // The first name marks empty buckets in `namesByHash`.
+            auto &emptyName = result->names.emplace_back();
+            emptyName.kind = NameKind::UTF8;
+            emptyName.raw.utf8 = string_view();
+            substitution.emplace_back(*result, 0);
+            continue;
+        }
+        switch (nm.kind) {
+            case NameKind::UTF8:
+                substitution.emplace_back(result->enterNameUTF8(nm.raw.utf8));
+                break;
+            case NameKind::CONSTANT:
+                substitution.emplace_back(result->enterNameConstant(substitution[nm.cnst.original.id()]));
+                break;
+            case NameKind::UNIQUE:
+                substitution.emplace_back(result->freshNameUnique(
+                    nm.unique.uniqueNameKind, substitution[nm.unique.original.id()], nm.unique.num));
+                break;
+            default:
+                ENFORCE(false, "NameKind missing");
+        }
+        ENFORCE(id >= firstCollectable || substitution.back().id() == id, "name kept below firstCollectable moved");
+    }
+    result->sanityCheck();
+    return result;
+}
+
 string_view GlobalState::getPrintablePath(string_view path) const {
     // Only strip the path prefix if the path has it.
     if (path.substr(0, pathPrefix.length()) == pathPrefix) {
@@ -1201,7 +1375,11 @@ void GlobalState::_error(unique_ptr<Error> error) const {
     auto loc = error->loc;
     if (loc.file().exists() && error->what != errors::Infer::SuggestTyped &&
         error->what != core::errors::Resolver::SigInFileWithoutSigil) {
-        loc.file().data(*this).minErrorLevel_ = min(loc.file().data(*this).minErrorLevel_, error->what.minLevel);
+        auto &minErrorLevel = loc.file().data(*this).minErrorLevel_;
+        auto current = minErrorLevel.load();
+        while (error->what.minLevel < current && !minErrorLevel.compare_exchange_weak(current, error->what.minLevel)) {
+            // `current` is now what another thread stored.
+        }
     }
 
     errorQueue->pushError(*this, move(error));
@@ -1290,6 +1468,10 @@ bool GlobalState::shouldReportErrorOn(Loc loc, ErrorClass what) const {
     return level >= what.minLevel;
 }
 
+bool GlobalState::wasTypecheckingCanceled() const {
+    return typecheckCanceled->load(std::memory_order_relaxed);
+}
+
 bool GlobalState::wasModified() const {
     return wasModified_;
 }
@@ -1318,7 +1500,7 @@ unique_ptr<GlobalState> GlobalState::replaceFile(unique_ptr<GlobalState> inWhat,
     return inWhat;
 }
 
-FileRef GlobalState::findFileByPath(string_view path) {
+FileRef GlobalState::findFileByPath(string_view path) const {
     auto fnd = fileRefByPath.find(string(path));
     if (fnd != fileRefByPath.end()) {
         return fnd->second;
@@ -2,6 +2,7 @@
 #define SORBET_GLOBAL_STATE_H
 #include "absl/synchronization/mutex.h"
 
+#include "common/PagedVector.h"
 #include "core/Error.h"
 #include "core/ErrorQueue.h"
 #include "core/Files.h"
@@ -9,6 +10,7 @@
 #include "core/Names.h"
 #include "core/Symbols.h"
 #include "core/lsp/Query.h"
+#include <atomic>
 #include <memory>
 
 namespace sorbet::core {
@@ -27,6 +29,13 @@ class Serializer;
 class SerializerImpl;
 } // namespace serialize
 
+// How much memory one of GlobalState's tables takes, as reported by `--print=memory-report`.
+struct TableMemory {
+    std::string table;
+    u8 entries;
+    u8 bytes;
+};
+
 class GlobalState final {
     friend Name;
     friend NameRef;
@@ -54,6 +63,10 @@ public:
     // operation to avoid table resizes.
     void reserveMemory(u4 kb);
 
+    // Expand tables to hold at least `nameCount` names, `symbolCount` symbols and `fileCount` files without
+    // resizing. Returns how many times the name table would have been doubled otherwise.
+    int reserveTables(u4 nameCount, u4 symbolCount, u4 fileCount);
+
     GlobalState(const GlobalState &) = delete;
     GlobalState(GlobalState &&) = delete;
 
@@ -90,7 +103,7 @@ public:
     static std::unique_ptr<GlobalState> replaceFile(std::unique_ptr<GlobalState> inWhat, FileRef whatFile,
                                                     const std::shared_ptr<File> &withWhat);
     static std::unique_ptr<GlobalState> markFileAsTombStone(std::unique_ptr<GlobalState>, FileRef fref);
-    FileRef findFileByPath(std::string_view path);
+    FileRef findFileByPath(std::string_view path) const;
 
     void mangleRenameSymbol(SymbolRef what, NameRef origName);
     spdlog::logger &tracer() const;
@@ -98,6 +111,8 @@ public:
 
     unsigned int symbolsUsed() const;
     unsigned int filesUsed() const;
+    // Estimates the memory taken by the name, symbol and file tables, and by the types the symbols refer to.
+    std::vector<TableMemory> memoryUsage() const;
 
     void sanityCheck() const;
     void markAsPayload();
@@ -145,6 +160,11 @@ public:
     bool runningUnderAutogen = false;
 
     std::unique_ptr<GlobalState> deepCopy(bool keepId = false) const;
+    // Copies this GlobalState, leaving out every name from `firstCollectable` on that isn't marked in `live` and that
+    // no live name is built from. Names before `firstCollectable` keep their ids; symbols must only refer to those.
+    // Fills `substitution` with the new NameRef of every name, and NameRef() for the ones that were left out.
+    std::unique_ptr<GlobalState> compactNames(u4 firstCollectable, std::vector<bool> live,
+                                              std::vector<NameRef> &substitution) const;
     mutable std::shared_ptr<ErrorQueue> errorQueue;
 
     // Contains a path prefix that should be stripped from all printed paths.
@@ -162,6 +182,12 @@ public:
     // Used to ensure GlobalState is in the correct state to process requests.
     unsigned int lspTypecheckCount = 0;
 
+    // Can be set from any thread to ask the naming, resolving and typechecking passes running on this GlobalState to
+    // stop at the next file or phase boundary. Not copied by `deepCopy`; a caller that wants to cancel a typecheck
+    // running on a copy shares the flag with it explicitly.
+    std::shared_ptr<std::atomic<bool>> typecheckCanceled;
+    bool wasTypecheckingCanceled() const;
+
     void trace(std::string_view msg) const;
 
     std::unique_ptr<GlobalStateHash> hash() const;
@@ -174,6 +200,10 @@ public:
     void onlyShowErrorClass(int code);
 
     std::vector<std::string> dslRubyExtraArgs;
+    // Plugin commands that speak the persistent server protocol (see plugin/PluginServer.h).
+    std::vector<std::string> dslPersistentPlugins;
+    // Hashes of the plugin scripts by command, taken once per run. Cached plugin output is keyed by them.
+    UnorderedMap<std::string, std::string> dslPluginScriptHashes;
     void addDslPlugin(std::string_view method, std::string_view command);
     std::optional<std::string_view> findDslPlugin(NameRef method) const;
     bool hasAnyDslPlugin() const;
@@ -190,10 +220,12 @@ private:
     std::vector<std::shared_ptr<std::vector<char>>> strings;
     std::string_view enterString(std::string_view nm);
     u2 stringsLastPageUsed = STRINGS_PAGE_SIZE + 1;
-    std::vector<Name> names;
+    // `names`, `symbols` and `namesByHash` are copy-on-write: deepCopy shares their pages with the copy, and a page
+    // is only duplicated when one of the two GlobalStates mutates it.
+    PagedVector<Name> names;
     UnorderedMap<std::string, FileRef> fileRefByPath;
-    std::vector<Symbol> symbols;
-    std::vector<std::pair<unsigned int, unsigned int>> namesByHash;
+    PagedVector<Symbol, 10> symbols;
+    PagedVector<std::pair<unsigned int, unsigned int>> namesByHash;
     std::vector<std::shared_ptr<File>> files;
     UnorderedSet<int> suppressedErrorClasses;
     UnorderedSet<int> onlyErrorClasses;
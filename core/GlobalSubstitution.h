@@ -12,6 +12,8 @@ class GlobalState;
 class GlobalSubstitution {
 public:
     GlobalSubstitution(const GlobalState &from, GlobalState &to, const GlobalState *optionalCommonParent = nullptr);
+    // Substitutes `nameSubstitution[name.id()]` for `name`, e.g. after GlobalState::compactNames.
+    GlobalSubstitution(std::vector<NameRef> nameSubstitution, const GlobalState &to);
 
     NameRef substitute(NameRef from, bool allowSameFromTo = false) const {
         if (!allowSameFromTo) {
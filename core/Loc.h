@@ -4,25 +4,17 @@
 #include "Files.h"
 
 namespace sorbet::core {
-namespace serialize {
-class SerializerImpl;
-}
 class GlobalState;
 
 class Loc final {
     struct {
-        unsigned int beginLoc : 24;
-        unsigned int endLoc : 24;
-        unsigned int fileRef : 16;
-    } __attribute__((packed, aligned(8))) storage;
+        u4 beginLoc;
+        u4 endLoc;
+        u4 fileRef;
+    } storage;
     template <typename H> friend H AbslHashValue(H h, const Loc &m);
-    friend class sorbet::core::serialize::SerializerImpl;
-
-    static constexpr int INVALID_POS_LOC = 0xffffff;
 
-    void setFile(core::FileRef file) {
-        storage.fileRef = file.id();
-    }
+    static constexpr u4 INVALID_POS_LOC = 0xffffffff;
 
 public:
     static Loc none(FileRef file = FileRef()) {
@@ -57,8 +49,6 @@ public:
     }
 
     inline Loc(FileRef file, u4 begin, u4 end) : storage{begin, end, file.id()} {
-        ENFORCE(begin <= INVALID_POS_LOC);
-        ENFORCE(end <= INVALID_POS_LOC);
         ENFORCE(begin <= end);
     }
 
@@ -89,19 +79,6 @@ public:
     static u4 pos2Offset(const File &file, Detail pos);
     static Detail offset2Pos(const File &file, u4 off);
     static Loc fromDetails(const GlobalState &gs, FileRef fileRef, Detail begin, Detail end);
-    std::pair<u4, u4> getAs2u4() const {
-        auto low = (((u4)storage.beginLoc) << 8) + ((((u4)storage.fileRef) >> 8) & ((1 << 8) - 1));
-        auto high = (((u4)storage.endLoc) << 8) + ((((u4)storage.fileRef)) & ((1 << 8) - 1));
-        return {low, high};
-    };
-
-    // Intentionally not a constructor because we don't want to ever be able to call it unintentionally
-    void setFrom2u4(u4 low, u4 high) {
-        storage.fileRef = (high & ((1 << 8) - 1)) + ((low & ((1 << 8) - 1)) << 8);
-        storage.endLoc = high >> 8;
-        storage.beginLoc = low >> 8;
-    }
-
     // For a given Loc, returns
     //
     // - the Loc corresponding to the first non-whitespace character on this line, and
@@ -114,7 +91,7 @@ public:
         return Loc(file(), beginPos(), beginPos());
     }
 };
-CheckSize(Loc, 8, 8);
+CheckSize(Loc, 12, 4);
 
 template <typename H> H AbslHashValue(H h, const Loc &m) {
     return H::combine(std::move(h), m.storage.beginLoc, m.storage.endLoc, m.storage.fileRef);
@@ -53,6 +53,29 @@ struct FileHash {
     UsageHash usages;
 };
 
+// The errors typechecking a file produced, and what they depended on besides the file's own contents. A later run
+// replays the errors instead of typechecking the file again if none of that changed.
+struct TypecheckRecord {
+    struct CachedError {
+        u2 code;
+        u1 minLevel;
+        // The file the error points into, if not the typechecked file.
+        std::string path;
+        u4 beginPos;
+        u4 endPos;
+        std::string header;
+        // As printed, including the sections that point into other files.
+        std::string text;
+    };
+
+    u4 hierarchyHash = GlobalStateHash::HASH_STATE_NOT_COMPUTED;
+    // The hash of every method name the file uses or defines. Names without methods have hash 0.
+    std::vector<std::pair<NameHash, u4>> methodHashes;
+    // Other files the errors point into, with a hash of their contents, since their lines are baked into `text`.
+    std::vector<std::pair<std::string, std::string>> referencedFiles;
+    std::vector<CachedError> errors;
+};
+
 }; // namespace sorbet::core
 
 #endif // RUBY_TYPER_NAME_HASH_H
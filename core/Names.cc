@@ -156,8 +156,7 @@ void Name::sanityCheck(const GlobalState &gs) const {
 }
 
 NameRef Name::ref(const GlobalState &gs) const {
-    auto distance = this - gs.names.data();
-    return NameRef(gs, distance);
+    return NameRef(gs, gs.names.indexOf(this));
 }
 
 bool Name::isClassName(const GlobalState &gs) const {
@@ -212,7 +211,8 @@ NameData NameRef::data(GlobalState &gs) const {
     ENFORCE(_id < gs.names.size(), "name id out of bounds");
     ENFORCE(exists(), "non existing name");
     enforceCorrectGlobalState(gs);
-    return NameData(gs.names[_id], gs);
+    // Names are never modified after they are entered, so this doesn't need to unshare the page holding the name.
+    return NameData(const_cast<Name &>(gs.names[_id]), gs);
 }
 
 const NameData NameRef::data(const GlobalState &gs) const {
@@ -252,7 +252,7 @@ NameRef NameRef::prepend(GlobalState &gs, string_view s) const {
     return gs.enterNameUTF8(nameEq);
 }
 
-Name Name::deepCopy(const GlobalState &to) const {
+Name Name::deepCopy() const {
     Name out;
     out.kind = this->kind;
 
@@ -264,11 +264,11 @@ Name Name::deepCopy(const GlobalState &to) const {
         case UNIQUE:
             out.unique.uniqueNameKind = this->unique.uniqueNameKind;
             out.unique.num = this->unique.num;
-            out.unique.original = NameRef(to, this->unique.original.id());
+            out.unique.original = this->unique.original;
             break;
 
         case CONSTANT:
-            out.cnst.original = NameRef(to, this->cnst.original.id());
+            out.cnst.original = this->cnst.original;
             break;
 
         default:
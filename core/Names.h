@@ -101,7 +101,7 @@ public:
     void sanityCheck(const GlobalState &gs) const;
     NameRef ref(const GlobalState &gs) const;
 
-    Name deepCopy(const GlobalState &to) const;
+    Name deepCopy() const;
 
 private:
     unsigned int hash(const GlobalState &gs) const;
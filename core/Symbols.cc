@@ -100,8 +100,7 @@ bool Symbol::derivesFrom(const GlobalState &gs, SymbolRef sym) const {
 }
 
 SymbolRef Symbol::ref(const GlobalState &gs) const {
-    auto distance = this - gs.symbols.data();
-    return SymbolRef(gs, distance);
+    return SymbolRef(gs, id);
 }
 
 SymbolData SymbolRef::data(GlobalState &gs) const {
@@ -111,7 +110,7 @@ SymbolData SymbolRef::data(GlobalState &gs) const {
 
 SymbolData SymbolRef::dataAllowingNone(GlobalState &gs) const {
     ENFORCE(_id < gs.symbols.size());
-    return SymbolData(gs.symbols[this->_id], gs);
+    return SymbolData(gs.symbols.mutableAt(this->_id), gs);
 }
 
 const SymbolData SymbolRef::data(const GlobalState &gs) const {
@@ -838,31 +837,24 @@ void ArgInfo::ArgFlags::setFromU1(u1 flags) {
     isBlock = flags & 16;
 }
 
-Symbol Symbol::deepCopy(const GlobalState &to, bool keepGsId) const {
+Symbol Symbol::deepCopy() const {
     Symbol result;
     result.owner = this->owner;
     result.flags = this->flags;
     result.mixins_ = this->mixins_;
     result.resultType = this->resultType;
-    result.name = NameRef(to, this->name.id());
+    result.name = this->name;
     result.locs_ = this->locs_;
     result.typeParams = this->typeParams;
-    if (keepGsId) {
-        result.members_ = this->members_;
-    } else {
-        result.members_.reserve(this->members().size());
-        for (auto &mem : this->members_) {
-            result.members_[NameRef(to, mem.first.id())] = mem.second;
-        }
-    }
+    result.members_ = this->members_;
     result.arguments_.reserve(this->arguments_.size());
     for (auto &mem : this->arguments_) {
-        auto &store = result.arguments_.emplace_back(mem.deepCopy());
-        store.name = NameRef(to, mem.name.id());
+        result.arguments_.emplace_back(mem.deepCopy());
     }
     result.superClassOrRebind = this->superClassOrRebind;
     result.uniqueCounter = this->uniqueCounter;
     result.intrinsic = this->intrinsic;
+    result.id = this->id;
     return result;
 }
 
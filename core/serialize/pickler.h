@@ -8,12 +8,17 @@ class Pickler {
     std::vector<u1> data;
     u1 zeroCounter = 0;
 
+    void flushZeros();
+
 public:
     void putU4(u4 u);
     void putU1(const u1 u);
     void putS8(const int64_t i);
     void putStr(std::string_view s);
-    std::vector<u1> result(int compressionDegree);
+    // With a `dictionary`, the result can only be read by an UnPickler with the same dictionary.
+    std::vector<u1> result(int compressionDegree, std::string_view dictionary = std::string_view());
+    // What `result` compresses.
+    std::vector<u1> uncompressedResult();
     Pickler() = default;
 };
 
@@ -27,7 +32,7 @@ public:
     u1 getU1();
     int64_t getS8();
     std::string_view getStr();
-    explicit UnPickler(const u1 *const compressed);
+    explicit UnPickler(const u1 *const compressed, std::string_view dictionary = std::string_view());
 };
 
 } // namespace sorbet::core::serialize
@@ -33,6 +33,8 @@ public:
     static void pickle(Pickler &p, const Symbol &what);
     static void pickle(Pickler &p, FileRef file, const unique_ptr<ast::Expression> &what);
     static void pickle(Pickler &p, core::Loc loc);
+    static void pickle(Pickler &p, const FileHash &what);
+    static void pickle(Pickler &p, const TypecheckRecord &what);
 
     template <class T> static void pickleTree(Pickler &p, FileRef file, unique_ptr<T> &t);
 
@@ -42,9 +44,12 @@ public:
     static ArgInfo unpickleArgInfo(UnPickler &p, GlobalState *gs);
     static Symbol unpickleSymbol(UnPickler &p, GlobalState *gs);
     static void unpickleGS(UnPickler &p, GlobalState &result);
+    static Loc unpickleLoc(UnPickler &p);
     static Loc unpickleLoc(UnPickler &p, FileRef file);
     static unique_ptr<ast::Expression> unpickleExpr(UnPickler &p, GlobalState &, FileRef file);
     static NameRef unpickleNameRef(UnPickler &p, GlobalState &);
+    static FileHash unpickleFileHash(UnPickler &p);
+    static TypecheckRecord unpickleTypecheckRecord(UnPickler &p);
 
     SerializerImpl() = delete;
 
@@ -62,11 +67,20 @@ void Pickler::putStr(string_view s) {
 
 constexpr size_t SIZE_BYTES = sizeof(int) / sizeof(u1);
 
-vector<u1> Pickler::result(int compressionDegree) {
+void Pickler::flushZeros() {
     if (zeroCounter != 0) {
         data.emplace_back(zeroCounter);
         zeroCounter = 0;
     }
+}
+
+vector<u1> Pickler::uncompressedResult() {
+    flushZeros();
+    return data;
+}
+
+vector<u1> Pickler::result(int compressionDegree, string_view dictionary) {
+    flushZeros();
     const size_t maxDstSize = Lizard_compressBound(data.size());
     vector<u1> compressedData;
     compressedData.resize(2048 + maxDstSize); // give extra room for compression
@@ -74,8 +88,20 @@ vector<u1> Pickler::result(int compressionDegree) {
                                               // succeeds. It seems to be written for big inputs
                                               // and returns too small sizes for small inputs,
                                               // where compressed size is bigger than original size
-    int resultCode = Lizard_compress((const char *)data.data(), (char *)(compressedData.data() + SIZE_BYTES * 2),
+    int resultCode;
+    if (dictionary.empty()) {
+        resultCode = Lizard_compress((const char *)data.data(), (char *)(compressedData.data() + SIZE_BYTES * 2),
                                      data.size(), (compressedData.size() - SIZE_BYTES * 2), compressionDegree);
+    } else {
+        // Compresses the data as if it followed the dictionary, so that it can refer back into it.
+        auto *stream = Lizard_createStream(compressionDegree);
+        ENFORCE(stream != nullptr);
+        Lizard_loadDict(stream, dictionary.data(), dictionary.size());
+        resultCode = Lizard_compress_continue(stream, (const char *)data.data(),
+                                              (char *)(compressedData.data() + SIZE_BYTES * 2), data.size(),
+                                              (compressedData.size() - SIZE_BYTES * 2));
+        Lizard_freeStream(stream);
+    }
     if (resultCode == 0) {
         // did not compress!
         Exception::raise("incompressible pickler?");
@@ -90,7 +116,7 @@ vector<u1> Pickler::result(int compressionDegree) {
     return compressedData;
 }
 
-UnPickler::UnPickler(const u1 *const compressed) : pos(0) {
+UnPickler::UnPickler(const u1 *const compressed, string_view dictionary) : pos(0) {
     int compressedSize;
     memcpy(&compressedSize, compressed, SIZE_BYTES);
     int uncompressedSize;
@@ -98,8 +124,15 @@ UnPickler::UnPickler(const u1 *const compressed) : pos(0) {
 
     data.resize(uncompressedSize);
 
-    int resultCode = Lizard_decompress_safe((const char *)(compressed + 2 * SIZE_BYTES), (char *)this->data.data(),
+    int resultCode;
+    if (dictionary.empty()) {
+        resultCode = Lizard_decompress_safe((const char *)(compressed + 2 * SIZE_BYTES), (char *)this->data.data(),
                                             compressedSize, uncompressedSize);
+    } else {
+        resultCode = Lizard_decompress_safe_usingDict((const char *)(compressed + 2 * SIZE_BYTES),
+                                                      (char *)this->data.data(), compressedSize, uncompressedSize,
+                                                      dictionary.data(), dictionary.size());
+    }
     if (resultCode != uncompressedSize) {
         Exception::raise("incomplete decompression");
     }
@@ -114,10 +147,7 @@ string_view UnPickler::getStr() {
 }
 
 void Pickler::putU1(u1 u) {
-    if (zeroCounter != 0) {
-        data.emplace_back(zeroCounter);
-        zeroCounter = 0;
-    }
+    flushZeros();
     data.emplace_back(u);
 }
 
@@ -429,13 +459,7 @@ ArgInfo SerializerImpl::unpickleArgInfo(UnPickler &p, GlobalState *gs) {
     ArgInfo result;
     result.name = core::NameRef(*gs, p.getU4());
     result.rebind = core::SymbolRef(gs, p.getU4());
-    {
-        core::Loc loc;
-        auto low = p.getU4();
-        auto high = p.getU4();
-        loc.setFrom2u4(low, high);
-        result.loc = loc;
-    }
+    result.loc = unpickleLoc(p);
     {
         u1 flags = p.getU1();
         result.flags.setFromU1(flags);
@@ -527,11 +551,7 @@ Symbol SerializerImpl::unpickleSymbol(UnPickler &p, GlobalState *gs) {
     result.resultType = unpickleType(p, gs);
     auto locCount = p.getU4();
     for (int i = 0; i < locCount; i++) {
-        core::Loc loc;
-        auto low = p.getU4();
-        auto high = p.getU4();
-        loc.setFrom2u4(low, high);
-        result.locs_.emplace_back(loc);
+        result.locs_.emplace_back(unpickleLoc(p));
     }
     return result;
 }
@@ -599,12 +619,9 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
 
     vector<shared_ptr<File>> files(std::move(result.files));
     files.clear();
-    vector<Name> names(std::move(result.names));
-    names.clear();
-    vector<Symbol> symbols(std::move(result.symbols));
-    symbols.clear();
-    vector<pair<unsigned int, unsigned int>> namesByHash(std::move(result.namesByHash));
-    namesByHash.clear();
+    decltype(result.names) names;
+    decltype(result.symbols) symbols;
+    decltype(result.namesByHash) namesByHash;
 
     result.trace("Reading files");
 
@@ -639,7 +656,7 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
     ENFORCE(symbolSize > 0);
     symbols.reserve(symbolSize);
     for (int i = 0; i < symbolSize; i++) {
-        symbols.emplace_back(unpickleSymbol(p, &result));
+        symbols.emplace_back(unpickleSymbol(p, &result)).id = i;
     }
 
     result.trace("Reading name table");
@@ -671,18 +688,25 @@ void SerializerImpl::unpickleGS(UnPickler &p, GlobalState &result) {
 }
 
 void SerializerImpl::pickle(Pickler &p, Loc loc) {
-    auto [low, high] = loc.getAs2u4();
-    p.putU4(low);
-    p.putU4(high);
+    // Locs that don't fit inline refer to a table that only exists in this process, so always store them unpacked.
+    p.putU4(loc.file().id());
+    p.putU4(loc.beginPos());
+    p.putU4(loc.endPos());
+}
+
+Loc SerializerImpl::unpickleLoc(UnPickler &p) {
+    FileRef file(p.getU4());
+    auto begin = p.getU4();
+    auto end = p.getU4();
+    return Loc(file, begin, end);
 }
 
 Loc SerializerImpl::unpickleLoc(UnPickler &p, FileRef file) {
-    Loc loc;
-    auto low = p.getU4();
-    auto high = p.getU4();
-    loc.setFrom2u4(low, high);
-    loc.setFile(file);
-    return loc;
+    // Trees can be loaded under a different FileRef than the one they were stored with.
+    p.getU4();
+    auto begin = p.getU4();
+    auto end = p.getU4();
+    return Loc(file, begin, end);
 }
 
 vector<u1> Serializer::store(GlobalState &gs) {
@@ -1149,18 +1173,221 @@ unique_ptr<ast::Expression> SerializerImpl::unpickleExpr(serialize::UnPickler &p
     Exception::raise("Not handled {}", kind);
 }
 
-unique_ptr<ast::Expression> Serializer::loadExpression(GlobalState &gs, const u1 *const p, u4 forceId) {
-    serialize::UnPickler up(p);
+unique_ptr<ast::Expression> Serializer::loadExpression(GlobalState &gs, const u1 *const p, u4 forceId,
+                                                       string_view dictionary) {
+    serialize::UnPickler up(p, dictionary);
     u4 loaded = up.getU4();
     FileRef fileId(forceId > 0 ? forceId : loaded);
     return SerializerImpl::unpickleExpr(up, gs, fileId);
 }
 
-vector<u1> Serializer::storeExpression(GlobalState &gs, unique_ptr<ast::Expression> &e) {
+namespace {
+serialize::Pickler pickleExpression(const unique_ptr<ast::Expression> &e) {
     serialize::Pickler pickler;
     pickler.putU4(e->loc.file().id());
     SerializerImpl::pickle(pickler, e->loc.file(), e);
-    return pickler.result(FILE_COMPRESSION_DEGREE);
+    return pickler;
+}
+
+// Picks the segments of `samples` made of the k-mers that occur in the most samples, until they fill `size` bytes. This
+// is a simplified version of the cover algorithm that zstd trains its dictionaries with.
+string buildDictionary(const vector<vector<u1>> &samples, size_t size) {
+    // Segments are scored by the k-mers that they contain.
+    constexpr size_t K = sizeof(u8);
+    constexpr size_t SEGMENT_SIZE = 64;
+    auto kmerAt = [](const u1 *p) {
+        u8 kmer;
+        memcpy(&kmer, p, K);
+        return kmer;
+    };
+
+    // In how many samples every k-mer occurs. A k-mer that is in the dictionary already is worth nothing more.
+    UnorderedMap<u8, u4> frequency;
+    for (auto &sample : samples) {
+        UnorderedSet<u8> seen;
+        for (size_t i = 0; i + K <= sample.size(); i++) {
+            auto kmer = kmerAt(&sample[i]);
+            if (seen.insert(kmer).second) {
+                frequency[kmer]++;
+            }
+        }
+    }
+    auto score = [&](const u1 *segment) {
+        u8 total = 0;
+        for (size_t i = 0; i + K <= SEGMENT_SIZE; i++) {
+            auto fnd = frequency.find(kmerAt(segment + i));
+            // K-mers that only occur in one sample don't help compressing any other.
+            if (fnd != frequency.end() && fnd->second > 1) {
+                total += fnd->second;
+            }
+        }
+        return total;
+    };
+
+    // Scores only ever go down as segments are picked, so a segment whose score is still the highest after
+    // rescoring it is the best one left.
+    vector<pair<u8, const u1 *>> candidates;
+    for (auto &sample : samples) {
+        for (size_t i = 0; i + SEGMENT_SIZE <= sample.size(); i += SEGMENT_SIZE) {
+            candidates.emplace_back(score(&sample[i]), &sample[i]);
+        }
+    }
+    std::make_heap(candidates.begin(), candidates.end());
+    vector<const u1 *> picked;
+    while (picked.size() * SEGMENT_SIZE + SEGMENT_SIZE <= size && !candidates.empty()) {
+        std::pop_heap(candidates.begin(), candidates.end());
+        auto segment = candidates.back().second;
+        candidates.pop_back();
+        auto current = score(segment);
+        if (current == 0) {
+            break;
+        }
+        if (!candidates.empty() && current < candidates.front().first) {
+            candidates.emplace_back(current, segment);
+            std::push_heap(candidates.begin(), candidates.end());
+            continue;
+        }
+        picked.emplace_back(segment);
+        for (size_t i = 0; i + K <= SEGMENT_SIZE; i++) {
+            frequency.erase(kmerAt(segment + i));
+        }
+    }
+
+    // Matches are cheaper to encode the closer they are, and the end of the dictionary is the closest to the data, so
+    // the best segments go last.
+    string dictionary;
+    dictionary.reserve(picked.size() * SEGMENT_SIZE);
+    for (auto it = picked.rbegin(); it != picked.rend(); ++it) {
+        dictionary.append((const char *)*it, SEGMENT_SIZE);
+    }
+    return dictionary;
+}
+} // namespace
+
+vector<u1> Serializer::storeExpression(GlobalState &gs, unique_ptr<ast::Expression> &e, string_view dictionary) {
+    return pickleExpression(e).result(FILE_COMPRESSION_DEGREE, dictionary);
+}
+
+string Serializer::trainExpressionDictionary(const vector<ast::ParsedFile> &trees, size_t size) {
+    vector<vector<u1>> samples;
+    samples.reserve(trees.size());
+    for (auto &tree : trees) {
+        samples.emplace_back(pickleExpression(tree.tree).uncompressedResult());
+    }
+    return buildDictionary(samples, size);
+}
+
+void SerializerImpl::pickle(Pickler &p, const FileHash &what) {
+    p.putU4(what.definitions.hierarchyHash);
+    p.putU4(what.definitions.methodHashes.size());
+    for (const auto &e : what.definitions.methodHashes) {
+        p.putU4(e.first._hashValue);
+        p.putU4(e.second);
+    }
+    p.putU4(what.usages.usages.size());
+    for (const auto &e : what.usages.usages) {
+        p.putU4(e._hashValue);
+    }
+}
+
+FileHash SerializerImpl::unpickleFileHash(UnPickler &p) {
+    FileHash ret;
+    ret.definitions.hierarchyHash = p.getU4();
+    int methodHashSize = p.getU4();
+    ret.definitions.methodHashes.reserve(methodHashSize);
+    for (int i = 0; i < methodHashSize; i++) {
+        NameHash key;
+        key._hashValue = p.getU4();
+        ret.definitions.methodHashes[key] = p.getU4();
+    }
+    int usageSize = p.getU4();
+    ret.usages.usages.reserve(usageSize);
+    for (int i = 0; i < usageSize; i++) {
+        NameHash key;
+        key._hashValue = p.getU4();
+        ret.usages.usages.emplace_back(key);
+    }
+    return ret;
+}
+
+vector<u1> Serializer::storeFileHash(const FileHash &fh) {
+    Pickler p;
+    SerializerImpl::pickle(p, fh);
+    return p.result(FILE_COMPRESSION_DEGREE);
+}
+
+FileHash Serializer::loadFileHash(const u1 *const p) {
+    UnPickler up(p);
+    return SerializerImpl::unpickleFileHash(up);
+}
+
+void SerializerImpl::pickle(Pickler &p, const TypecheckRecord &what) {
+    p.putU4(what.hierarchyHash);
+    p.putU4(what.methodHashes.size());
+    for (const auto &[name, hash] : what.methodHashes) {
+        p.putU4(name._hashValue);
+        p.putU4(hash);
+    }
+    p.putU4(what.referencedFiles.size());
+    for (const auto &[path, hash] : what.referencedFiles) {
+        p.putStr(path);
+        p.putStr(hash);
+    }
+    p.putU4(what.errors.size());
+    for (const auto &error : what.errors) {
+        p.putU4(error.code);
+        p.putU1(error.minLevel);
+        p.putStr(error.path);
+        p.putU4(error.beginPos);
+        p.putU4(error.endPos);
+        p.putStr(error.header);
+        p.putStr(error.text);
+    }
+}
+
+TypecheckRecord SerializerImpl::unpickleTypecheckRecord(UnPickler &p) {
+    TypecheckRecord ret;
+    ret.hierarchyHash = p.getU4();
+    int methodHashSize = p.getU4();
+    ret.methodHashes.reserve(methodHashSize);
+    for (int i = 0; i < methodHashSize; i++) {
+        NameHash name;
+        name._hashValue = p.getU4();
+        auto hash = p.getU4();
+        ret.methodHashes.emplace_back(name, hash);
+    }
+    int referencedFileSize = p.getU4();
+    ret.referencedFiles.reserve(referencedFileSize);
+    for (int i = 0; i < referencedFileSize; i++) {
+        auto path = string(p.getStr());
+        auto hash = string(p.getStr());
+        ret.referencedFiles.emplace_back(move(path), move(hash));
+    }
+    int errorSize = p.getU4();
+    ret.errors.reserve(errorSize);
+    for (int i = 0; i < errorSize; i++) {
+        TypecheckRecord::CachedError error;
+        error.code = p.getU4();
+        error.minLevel = p.getU1();
+        error.path = string(p.getStr());
+        error.beginPos = p.getU4();
+        error.endPos = p.getU4();
+        error.header = string(p.getStr());
+        error.text = string(p.getStr());
+        ret.errors.emplace_back(move(error));
+    }
+    return ret;
+}
+
+vector<u1> Serializer::storeTypecheckRecord(const TypecheckRecord &record) {
+    Pickler p;
+    SerializerImpl::pickle(p, record);
+    return p.result(FILE_COMPRESSION_DEGREE);
+}
+
+TypecheckRecord Serializer::loadTypecheckRecord(const u1 *const p) {
+    UnPickler up(p);
+    return SerializerImpl::unpickleTypecheckRecord(up);
 }
 
 NameRef SerializerImpl::unpickleNameRef(UnPickler &p, GlobalState &gs) {
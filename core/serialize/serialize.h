@@ -1,12 +1,13 @@
 #ifndef SORBET_SERIALIZE_H
 #define SORBET_SERIALIZE_H
 #include "ast/ast.h"
+#include "core/NameHash.h"
 #include "core/core.h"
 
 namespace sorbet::core::serialize {
 class Serializer {
 public:
-    static const u4 VERSION = 4;
+    static const u4 VERSION = 6;
     static const u1 GLOBAL_STATE_COMPRESSION_DEGREE =
         10; // >20 introduce decompression slowdown, >10 introduces compression slowdown
     static const u1 FILE_COMPRESSION_DEGREE =
@@ -20,12 +21,29 @@ public:
     // a global state containing a name table along side a large number of
     // individual cached files, which can be loaded independently.
     static std::vector<u1> storePayloadAndNameTable(GlobalState &gs);
-    static std::vector<u1> storeExpression(GlobalState &gs, std::unique_ptr<ast::Expression> &e);
+    //
+    // Most trees are small, and compress poorly on their own. Compressing them against a `dictionary` of what trees
+    // have in common does better, but they can then only be loaded with the same dictionary.
+    static std::vector<u1> storeExpression(GlobalState &gs, std::unique_ptr<ast::Expression> &e,
+                                           std::string_view dictionary = std::string_view());
 
     // Loads an ast::Expression saved by storeExpression. Optionally overrides
     // the saved file ID to the caller-specified ID.
-    static std::unique_ptr<ast::Expression> loadExpression(GlobalState &gs, const u1 *const p, u4 forceId = 0);
+    static std::unique_ptr<ast::Expression> loadExpression(GlobalState &gs, const u1 *const p, u4 forceId = 0,
+                                                           std::string_view dictionary = std::string_view());
+
+    // Trains a dictionary of at most `size` bytes for storeExpression, out of what `trees` have in common.
+    static std::string trainExpressionDictionary(const std::vector<ast::ParsedFile> &trees, size_t size);
     static void loadGlobalState(GlobalState &gs, const u1 *const data);
+
+    // Stores the hashes LSP computes for a file. They only depend on the file's contents, so unlike expressions they
+    // can be loaded into any GlobalState.
+    static std::vector<u1> storeFileHash(const FileHash &fh);
+    static FileHash loadFileHash(const u1 *const p);
+
+    // Stores what typechecking a file produced, for `--incremental`.
+    static std::vector<u1> storeTypecheckRecord(const TypecheckRecord &record);
+    static TypecheckRecord loadTypecheckRecord(const u1 *const p);
 };
 }; // namespace sorbet::core::serialize
 
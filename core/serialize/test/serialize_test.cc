@@ -1,7 +1,14 @@
 #include "gtest/gtest.h"
 // has to go first as it violates are requirements
+#include "absl/strings/str_cat.h"
+#include "ast/desugar/Desugar.h"
+#include "core/Error.h"
+#include "core/Unfreeze.h"
 #include "core/serialize/pickler.h"
 #include "core/serialize/serialize.h"
+#include "parser/parser.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
 
 using namespace std;
 
@@ -73,4 +80,71 @@ TEST(SerializeTest, Strings) { // NOLINT
     EXPECT_EQ(u.getStr(), "\0\0\0\t\n\f\rНЯЯЯЯЯ");
 }
 
+TEST(SerializeTest, Dictionary) { // NOLINT
+    string dictionary = "shared between all blobs, and only stored once";
+    Pickler p;
+    p.putStr("shared between all blobs");
+    p.putU4(42);
+    auto withDictionary = p.result(Serializer::FILE_COMPRESSION_DEGREE, dictionary);
+    UnPickler u(withDictionary.data(), dictionary);
+    EXPECT_EQ(u.getStr(), "shared between all blobs");
+    EXPECT_EQ(u.getU4(), 42);
+}
+
+TEST(SerializeTest, TrainedDictionary) { // NOLINT
+    auto logger = spdlog::stderr_color_mt("TrainedDictionary");
+    auto errorQueue = make_shared<ErrorQueue>(*logger, *logger);
+    GlobalState gs(errorQueue);
+    gs.initEmpty();
+    UnfreezeNameTable nameTableAccess(gs);
+    UnfreezeFileTable fileTableAccess(gs);
+
+    vector<ast::ParsedFile> trees;
+    for (int i = 0; i < 30; i++) {
+        string source;
+        absl::StrAppend(&source, "class Foo", i, "\n");
+        for (int j = 0; j < 5; j++) {
+            absl::StrAppend(&source, "  def bar", j, "(x, y = ", i, ")\n    x.baz(y + ", j, ") if y\n  end\n");
+        }
+        absl::StrAppend(&source, "end\n");
+        auto file = gs.enterFile(absl::StrCat("foo", i, ".rb"), source);
+        MutableContext ctx(gs, Symbols::root());
+        trees.emplace_back(ast::ParsedFile{ast::desugar::node2Tree(ctx, parser::Parser::run(gs, file)), file});
+    }
+    errorQueue->drainAllErrors();
+
+    constexpr size_t size = 4096;
+    auto dictionary = Serializer::trainExpressionDictionary(trees, size);
+    EXPECT_FALSE(dictionary.empty());
+    EXPECT_LE(dictionary.size(), size);
+    EXPECT_EQ(dictionary, Serializer::trainExpressionDictionary(trees, size));
+
+    size_t withDictionary = 0;
+    size_t withoutDictionary = 0;
+    for (auto &tree : trees) {
+        auto stored = Serializer::storeExpression(gs, tree.tree, dictionary);
+        withDictionary += stored.size();
+        withoutDictionary += Serializer::storeExpression(gs, tree.tree).size();
+        auto loaded = Serializer::loadExpression(gs, stored.data(), 0, dictionary);
+        EXPECT_EQ(tree.tree->showRaw(gs), loaded->showRaw(gs));
+    }
+    EXPECT_LT(withDictionary, withoutDictionary);
+}
+
+TEST(SerializeTest, FileHash) { // NOLINT
+    FileHash fh;
+    fh.definitions.hierarchyHash = 42;
+    NameHash foo, bar;
+    foo._hashValue = 7;
+    bar._hashValue = 4294967295;
+    fh.definitions.methodHashes[foo] = 1;
+    fh.definitions.methodHashes[bar] = 0;
+    fh.usages.usages = {bar, foo, foo};
+
+    auto loaded = Serializer::loadFileHash(Serializer::storeFileHash(fh).data());
+    EXPECT_EQ(loaded.definitions.hierarchyHash, 42);
+    EXPECT_EQ(loaded.definitions.methodHashes, fh.definitions.methodHashes);
+    EXPECT_EQ(loaded.usages.usages, fh.usages.usages);
+}
+
 } // namespace sorbet::core::serialize
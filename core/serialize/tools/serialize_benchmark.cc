@@ -0,0 +1,88 @@
+// Compares how large cached trees are, and how fast they load, with and without a trained dictionary. By default it
+// runs on the payload RBIs:
+//
+//   bazel run -c opt //core/serialize:serialize_benchmark [-- <rounds> <file>...]
+//
+// The dictionary is trained on every other file and measured on the rest, as it would be on files that were added
+// after the cache was first filled. Load speeds are in MB of source per second, and the best of all rounds.
+#include "ast/desugar/Desugar.h"
+#include "common/FileOps.h"
+#include "core/Error.h"
+#include "core/Unfreeze.h"
+#include "core/core.h"
+#include "core/serialize/serialize.h"
+#include "parser/parser.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+constexpr size_t DICTIONARY_BYTES = 64 * 1024;
+
+void measure(sorbet::core::GlobalState &gs, vector<sorbet::ast::ParsedFile> &trees, size_t sourceBytes, int rounds,
+             string_view scheme, string_view dictionary) {
+    vector<vector<sorbet::u1>> stored;
+    size_t storedBytes = 0;
+    for (auto &tree : trees) {
+        stored.emplace_back(sorbet::core::serialize::Serializer::storeExpression(gs, tree.tree, dictionary));
+        storedBytes += stored.back().size();
+    }
+
+    chrono::duration<double> best = chrono::duration<double>::max();
+    for (int round = 0; round < rounds; round++) {
+        auto start = chrono::steady_clock::now();
+        for (auto &blob : stored) {
+            sorbet::core::serialize::Serializer::loadExpression(gs, blob.data(), 0, dictionary);
+        }
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start));
+    }
+
+    auto megabytes = sourceBytes / (1024.0 * 1024.0);
+    cout << fmt::format("{}: stored {} trees in {:.1f} KB, loaded them in {:.1f} ms: {:.1f} MB/s\n", scheme,
+                        stored.size(), storedBytes / 1024.0, best.count() * 1000, megabytes / best.count());
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        cerr << "usage: " << argv[0] << " <rounds> <file> <file>...\n";
+        return 1;
+    }
+    int rounds = max(atoi(argv[1]), 1);
+
+    auto logger = spdlog::stderr_color_mt("serialize_benchmark");
+    auto errorQueue = make_shared<sorbet::core::ErrorQueue>(*logger, *logger);
+    sorbet::core::GlobalState gs(errorQueue);
+    gs.initEmpty();
+    sorbet::core::UnfreezeNameTable nameTableAccess(gs);
+    sorbet::core::UnfreezeFileTable fileTableAccess(gs);
+
+    vector<sorbet::ast::ParsedFile> training;
+    vector<sorbet::ast::ParsedFile> measured;
+    size_t measuredBytes = 0;
+    for (int i = 2; i < argc; i++) {
+        auto file = gs.enterFile(argv[i], sorbet::FileOps::read(argv[i]));
+        sorbet::core::MutableContext ctx(gs, sorbet::core::Symbols::root());
+        auto tree = sorbet::ast::desugar::node2Tree(ctx, sorbet::parser::Parser::run(gs, file));
+        if (i % 2 == 0) {
+            training.emplace_back(sorbet::ast::ParsedFile{move(tree), file});
+        } else {
+            measuredBytes += file.data(gs).source().size();
+            measured.emplace_back(sorbet::ast::ParsedFile{move(tree), file});
+        }
+    }
+    errorQueue->drainAllErrors();
+
+    auto start = chrono::steady_clock::now();
+    auto dictionary = sorbet::core::serialize::Serializer::trainExpressionDictionary(training, DICTIONARY_BYTES);
+    chrono::duration<double> trainingTime = chrono::steady_clock::now() - start;
+    cout << fmt::format("trained a {:.1f} KB dictionary on {} trees in {:.1f} ms\n", dictionary.size() / 1024.0,
+                        training.size(), trainingTime.count() * 1000);
+
+    measure(gs, measured, measuredBytes, rounds, "no dictionary", "");
+    measure(gs, measured, measuredBytes, rounds, "dictionary", dictionary);
+    return 0;
+}
@@ -62,6 +62,40 @@ TEST(ASTTest, Errors) { // NOLINT
     ASSERT_EQ(1, errors.size());
 }
 
+TEST(ASTTest, StreamFlushes) { // NOLINT
+    auto streamingQueue = make_shared<ErrorQueue>(*logger, *logger);
+    streamingQueue->ignoreFlushes = true;
+    GlobalState gs(streamingQueue);
+    gs.initEmpty();
+    UnfreezeFileTable fileTableAccess(gs);
+    FileRef f = gs.enterFile(string("a/foo.rb"), string("def foo\n  hi\nend\n"));
+    {
+        // Flushed before streaming starts, so not reported.
+        ErrorRegion errs(gs, f);
+    }
+
+    vector<FileRef> flushed;
+    int errorCount = 0;
+    streamingQueue->streamFlushes([&](FileRef file, const vector<ErrorQueueMessage> &errors) -> void {
+        flushed.emplace_back(file);
+        errorCount = errors.size();
+    });
+    {
+        ErrorRegion errs(gs, f);
+        if (auto e = gs.beginError(Loc{f, 0, 3}, errors::Internal::InternalError)) {
+            e.setHeader("Use of metavariable: `{}`", "foo");
+        }
+    }
+    streamingQueue->flushErrors();
+    streamingQueue->streamFlushes(nullptr);
+    ASSERT_EQ(1, flushed.size());
+    EXPECT_EQ(f, flushed[0]);
+    EXPECT_EQ(1, errorCount);
+
+    // Streamed errors stay in the queue.
+    EXPECT_EQ(1, streamingQueue->drainAllErrors().size());
+}
+
 TEST(ASTTest, SymbolRef) { // NOLINT
     GlobalState gs(errorQueue);
     gs.initEmpty();
@@ -99,6 +133,19 @@ TEST(CoreTest, FileIsTyped) { // NOLINT
     }
 }
 
+TEST(CoreTest, FileSigilFromPrefix) { // NOLINT
+    EXPECT_EQ(StrictLevel::Ignore, File::fileSigilFromPrefix("# typed: ignore\nclass A", false));
+    EXPECT_EQ(StrictLevel::True, File::fileSigilFromPrefix("\n# typed: true\n", false));
+    EXPECT_EQ(StrictLevel::True, File::fileSigilFromPrefix("# typed: true", true));
+    EXPECT_EQ(StrictLevel::None, File::fileSigilFromPrefix("class A\n", true));
+
+    // The sigil may be cut short, or come after the prefix.
+    EXPECT_EQ(nullopt, File::fileSigilFromPrefix("# typed: ignore", false));
+    EXPECT_EQ(nullopt, File::fileSigilFromPrefix("# typed: ign", false));
+    EXPECT_EQ(nullopt, File::fileSigilFromPrefix("class A\n", false));
+    EXPECT_EQ(nullopt, File::fileSigilFromPrefix("# typed: nonsense\n# typed: ", false));
+}
+
 TEST(CoreTest, Substitute) { // NOLINT
     GlobalState gs1(errorQueue);
     gs1.initEmpty();
@@ -133,8 +180,8 @@ TEST(CoreTest, Substitute) { // NOLINT
 }
 
 TEST(CoreTest, LocTest) { // NOLINT
-    constexpr auto maxFileId = 0xffff - 1;
-    constexpr auto maxOffset = 0xffffff - 1;
+    constexpr auto maxFileId = (1 << 25) - 1;
+    constexpr auto maxOffset = (1 << 27) - 1;
     for (auto fileRef = 0; fileRef < maxFileId; fileRef = fileRef * 2 + 1) {
         for (auto beginPos = 0; beginPos < maxOffset; beginPos = beginPos * 2 + 1) {
             for (auto endPos = beginPos; endPos < maxOffset; endPos = endPos * 2 + 1) {
@@ -142,22 +189,23 @@ TEST(CoreTest, LocTest) { // NOLINT
                 EXPECT_EQ(loc.file().id(), fileRef);
                 EXPECT_EQ(loc.beginPos(), beginPos);
                 EXPECT_EQ(loc.endPos(), endPos);
+                EXPECT_EQ(loc.exists(), fileRef != 0);
+
+                Loc loc2(core::FileRef(fileRef), beginPos, endPos);
+                EXPECT_EQ(loc, loc2);
+                EXPECT_EQ(absl::Hash<Loc>()(loc), absl::Hash<Loc>()(loc2));
             }
         }
     }
-    for (auto fileRef = 0; fileRef < maxFileId; fileRef = fileRef * 2 + 1) {
-        for (auto beginPos = 0; beginPos < maxOffset; beginPos = beginPos * 2 + 1) {
-            for (auto endPos = beginPos; endPos < maxOffset; endPos = endPos * 2 + 1) {
-                Loc loc(core::FileRef(fileRef), beginPos, endPos);
-                auto [low, high] = loc.getAs2u4();
-                Loc loc2;
-                loc2.setFrom2u4(low, high);
-                EXPECT_EQ(loc.file().id(), loc2.file().id());
-                EXPECT_EQ(loc.beginPos(), loc2.beginPos());
-                EXPECT_EQ(loc.endPos(), loc2.endPos());
-            }
-        }
+}
+
+TEST(CoreTest, LocNoneTest) { // NOLINT
+    for (auto fileRef : {0, 1, 0xffff, 1 << 24}) {
+        auto loc = Loc::none(core::FileRef(fileRef));
+        EXPECT_FALSE(loc.exists());
+        EXPECT_EQ(loc.file().id(), fileRef);
     }
+    EXPECT_FALSE(Loc().exists());
 }
 
 } // namespace sorbet::core
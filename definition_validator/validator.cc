@@ -1,3 +1,4 @@
+#include "definition_validator/validator.h"
 #include "ast/ast.h"
 #include "ast/treemap/treemap.h"
 #include "core/core.h"
@@ -161,108 +162,107 @@ void validateOverriding(const core::GlobalState &gs, core::SymbolRef method) {
     }
 }
 
-class ValidateWalk {
-private:
-    UnorderedMap<core::SymbolRef, vector<core::SymbolRef>> abstractCache;
-
-    const vector<core::SymbolRef> &getAbstractMethods(const core::GlobalState &gs, core::SymbolRef klass) {
-        vector<core::SymbolRef> abstract;
-        auto ent = abstractCache.find(klass);
-        if (ent != abstractCache.end()) {
-            return ent->second;
-        }
+const vector<core::SymbolRef> &ValidateWalk::getAbstractMethods(const core::GlobalState &gs, core::SymbolRef klass) {
+    vector<core::SymbolRef> abstract;
+    auto ent = abstractCache.find(klass);
+    if (ent != abstractCache.end()) {
+        return ent->second;
+    }
 
-        auto superclass = klass.data(gs)->superClass();
-        if (superclass.exists()) {
-            auto &superclassMethods = getAbstractMethods(gs, superclass);
-            // TODO(nelhage): This code coud go quadratic or even exponential given
-            // pathological arrangments of interfaces and abstract methods. Switch
-            // to a better data structure if that is ever a problem.
-            abstract.insert(abstract.end(), superclassMethods.begin(), superclassMethods.end());
-        }
+    auto superclass = klass.data(gs)->superClass();
+    if (superclass.exists()) {
+        auto &superclassMethods = getAbstractMethods(gs, superclass);
+        // TODO(nelhage): This code coud go quadratic or even exponential given
+        // pathological arrangments of interfaces and abstract methods. Switch
+        // to a better data structure if that is ever a problem.
+        abstract.insert(abstract.end(), superclassMethods.begin(), superclassMethods.end());
+    }
 
-        for (auto ancst : klass.data(gs)->mixins()) {
-            auto fromMixin = getAbstractMethods(gs, ancst);
-            abstract.insert(abstract.end(), fromMixin.begin(), fromMixin.end());
-        }
+    for (auto ancst : klass.data(gs)->mixins()) {
+        auto fromMixin = getAbstractMethods(gs, ancst);
+        abstract.insert(abstract.end(), fromMixin.begin(), fromMixin.end());
+    }
 
-        auto isAbstract = klass.data(gs)->isClassAbstract();
-        if (isAbstract) {
-            for (auto mem : klass.data(gs)->members()) {
-                if (mem.second.data(gs)->isMethod() && mem.second.data(gs)->isAbstract()) {
-                    abstract.emplace_back(mem.second);
-                }
+    auto isAbstract = klass.data(gs)->isClassAbstract();
+    if (isAbstract) {
+        for (auto mem : klass.data(gs)->members()) {
+            if (mem.second.data(gs)->isMethod() && mem.second.data(gs)->isAbstract()) {
+                abstract.emplace_back(mem.second);
             }
         }
+    }
 
-        auto &entry = abstractCache[klass];
-        entry = std::move(abstract);
-        return entry;
+    auto &entry = abstractCache[klass];
+    entry = std::move(abstract);
+    return entry;
+}
+
+// if/when we get final classes, we can just mark subclasses of `T::Struct` as final and essentially subsume the
+// logic here.
+void ValidateWalk::validateTStructNotGrandparent(const core::GlobalState &gs, core::SymbolRef sym) {
+    auto parent = sym.data(gs)->superClass();
+    if (!parent.exists()) {
+        return;
+    }
+    auto grandparent = parent.data(gs)->superClass();
+    if (!grandparent.exists() || grandparent != core::Symbols::T_Struct()) {
+        return;
     }
+    if (auto e = gs.beginError(sym.data(gs)->loc(), core::errors::Resolver::SubclassingNotAllowed)) {
+        auto parentName = parent.data(gs)->show(gs);
+        e.setHeader("Subclassing `{}` is not allowed", parentName);
+        e.addErrorLine(parent.data(gs)->loc(), "`{}` is a subclass of `T::Struct`", parentName);
+    }
+}
 
-    // if/when we get final classes, we can just mark subclasses of `T::Struct` as final and essentially subsume the
-    // logic here.
-    void validateTStructNotGrandparent(const core::GlobalState &gs, core::SymbolRef sym) {
-        auto parent = sym.data(gs)->superClass();
-        if (!parent.exists()) {
-            return;
-        }
-        auto grandparent = parent.data(gs)->superClass();
-        if (!grandparent.exists() || grandparent != core::Symbols::T_Struct()) {
-            return;
-        }
-        if (auto e = gs.beginError(sym.data(gs)->loc(), core::errors::Resolver::SubclassingNotAllowed)) {
-            auto parentName = parent.data(gs)->show(gs);
-            e.setHeader("Subclassing `{}` is not allowed", parentName);
-            e.addErrorLine(parent.data(gs)->loc(), "`{}` is a subclass of `T::Struct`", parentName);
-        }
+void ValidateWalk::validateAbstract(const core::GlobalState &gs, core::SymbolRef sym) {
+    if (sym.data(gs)->isClassAbstract()) {
+        return;
+    }
+    auto loc = sym.data(gs)->loc();
+    if (loc.exists() && loc.file().data(gs).isRBI()) {
+        return;
     }
 
-    void validateAbstract(const core::GlobalState &gs, core::SymbolRef sym) {
-        if (sym.data(gs)->isClassAbstract()) {
-            return;
-        }
-        auto loc = sym.data(gs)->loc();
-        if (loc.exists() && loc.file().data(gs).isRBI()) {
-            return;
-        }
+    auto &abstract = getAbstractMethods(gs, sym);
 
-        auto &abstract = getAbstractMethods(gs, sym);
+    if (abstract.empty()) {
+        return;
+    }
 
-        if (abstract.empty()) {
-            return;
+    for (auto proto : abstract) {
+        if (proto.data(gs)->owner == sym) {
+            continue;
         }
 
-        for (auto proto : abstract) {
-            if (proto.data(gs)->owner == sym) {
-                continue;
-            }
-
-            auto mem = sym.data(gs)->findConcreteMethodTransitive(gs, proto.data(gs)->name);
-            if (!mem.exists()) {
-                if (auto e = gs.beginError(loc, core::errors::Resolver::BadAbstractMethod)) {
-                    e.setHeader("Missing definition for abstract method `{}`", proto.data(gs)->show(gs));
-                    e.addErrorLine(proto.data(gs)->loc(), "defined here");
-                }
+        auto mem = sym.data(gs)->findConcreteMethodTransitive(gs, proto.data(gs)->name);
+        if (!mem.exists()) {
+            if (auto e = gs.beginError(loc, core::errors::Resolver::BadAbstractMethod)) {
+                e.setHeader("Missing definition for abstract method `{}`", proto.data(gs)->show(gs));
+                e.addErrorLine(proto.data(gs)->loc(), "defined here");
             }
         }
     }
+}
 
-public:
-    unique_ptr<ast::ClassDef> preTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> classDef) {
-        auto sym = classDef->symbol;
-        validateAbstract(ctx.state, sym);
-        validateTStructNotGrandparent(ctx.state, sym);
-        auto singleton = sym.data(ctx)->lookupSingletonClass(ctx);
-        validateAbstract(ctx.state, singleton);
-        return classDef;
-    }
+unique_ptr<ast::ClassDef> ValidateWalk::preTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> classDef) {
+    auto sym = classDef->symbol;
+    validateAbstract(ctx.state, sym);
+    validateTStructNotGrandparent(ctx.state, sym);
+    auto singleton = sym.data(ctx)->lookupSingletonClass(ctx);
+    validateAbstract(ctx.state, singleton);
+    return classDef;
+}
 
-    unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> methodDef) {
-        validateOverriding(ctx.state, methodDef->symbol);
+unique_ptr<ast::MethodDef> ValidateWalk::preTransformMethodDef(core::Context ctx,
+                                                               unique_ptr<ast::MethodDef> methodDef) {
+    if (methodDef->name == core::Names::staticInit()) {
+        // Only flatten makes these, and it may run fused with this walk. They were never validated.
         return methodDef;
     }
-};
+    validateOverriding(ctx.state, methodDef->symbol);
+    return methodDef;
+}
 
 ast::ParsedFile runOne(core::Context ctx, ast::ParsedFile tree) {
     Timer timeit(ctx.state.tracer(), "validateSymbols");
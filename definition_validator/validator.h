@@ -8,6 +8,21 @@
 
 namespace sorbet::definition_validator {
 
+// The tree walk behind runOne. Exposed so that it can run fused with other passes; it never changes the tree.
+class ValidateWalk {
+public:
+    std::unique_ptr<ast::ClassDef> preTransformClassDef(core::Context ctx, std::unique_ptr<ast::ClassDef> classDef);
+    std::unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx,
+                                                          std::unique_ptr<ast::MethodDef> methodDef);
+
+private:
+    UnorderedMap<core::SymbolRef, std::vector<core::SymbolRef>> abstractCache;
+
+    const std::vector<core::SymbolRef> &getAbstractMethods(const core::GlobalState &gs, core::SymbolRef klass);
+    void validateTStructNotGrandparent(const core::GlobalState &gs, core::SymbolRef sym);
+    void validateAbstract(const core::GlobalState &gs, core::SymbolRef sym);
+};
+
 ast::ParsedFile runOne(core::Context ctx, ast::ParsedFile tree);
 
 } // namespace sorbet::definition_validator
@@ -1,7 +1,7 @@
 #include "dsl/dsl.h"
 #include "ast/treemap/treemap.h"
 #include "ast/verifier/verifier.h"
-#include "common/typecase.h"
+#include "common/Counters.h"
 #include "dsl/ChalkODMProp.h"
 #include "dsl/ClassNew.h"
 #include "dsl/Command.h"
@@ -16,91 +16,158 @@
 #include "dsl/Rails.h"
 #include "dsl/Struct.h"
 #include "dsl/attr_reader.h"
+#include <chrono>
 
 using namespace std;
 
 namespace sorbet::dsl {
 
-class DSLReplacer {
-    friend class DSL;
+namespace {
 
-public:
-    unique_ptr<ast::ClassDef> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> classDef) {
-        Command::patchDSL(ctx, classDef.get());
-        Rails::patchDSL(ctx, classDef.get());
-        OpusEnum::patchDSL(ctx, classDef.get());
+using Replacement = vector<unique_ptr<ast::Expression>>;
 
-        ast::Expression *prevStat = nullptr;
-        UnorderedMap<ast::Expression *, vector<unique_ptr<ast::Expression>>> replaceNodes;
-        for (auto &stat : classDef->rhs) {
-            typecase(
-                stat.get(),
-                [&](ast::Assign *assign) {
-                    auto nodes = Struct::replaceDSL(ctx, assign);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+// Rewrites one statement of a class body. `prevStat` is the statement before it, or nullptr.
+struct StatRewriter {
+    ConstExprStr name;
+    Replacement (*replaceDSL)(core::MutableContext ctx, ast::Expression *stat, const ast::Expression *prevStat);
+};
 
-                    nodes = ClassNew::replaceDSL(ctx, assign);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+// The statement rewriters, keyed on the method that a statement sends, or that the right-hand side of an assignment
+// sends. A rewriter must be listed under every method name that it could rewrite a send of; the ones listed under the
+// same name are tried in order, until one of them rewrites the statement.
+struct StatRewriters {
+    UnorderedMap<core::NameRef, vector<StatRewriter>> sends;
+    UnorderedMap<core::NameRef, vector<StatRewriter>> assigns;
 
-                    nodes = ProtobufDescriptorPool::replaceDSL(ctx, assign);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
-                },
+    static const StatRewriters &get() {
+        static const StatRewriters rewriters;
+        return rewriters;
+    }
 
-                [&](ast::Send *send) {
-                    auto nodes = ChalkODMProp::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+    const vector<StatRewriter> *forStat(ast::Expression *stat) const {
+        const UnorderedMap<core::NameRef, vector<StatRewriter>> *table;
+        ast::Send *send;
+        if (auto *assign = ast::cast_tree<ast::Assign>(stat)) {
+            table = &assigns;
+            send = ast::cast_tree<ast::Send>(assign->rhs.get());
+        } else {
+            table = &sends;
+            send = ast::cast_tree<ast::Send>(stat);
+        }
+        if (send == nullptr) {
+            return nullptr;
+        }
+        auto it = table->find(send->fun);
+        if (it == table->end()) {
+            return nullptr;
+        }
+        return &it->second;
+    }
 
-                    nodes = MixinEncryptedProp::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+private:
+    StatRewriters() {
+        add(assigns, {core::Names::new_()}, {"Struct", [](auto ctx, auto *stat, auto *prevStat) {
+                return Struct::replaceDSL(ctx, ast::cast_tree<ast::Assign>(stat));
+            }});
+        add(assigns, {core::Names::new_()}, {"ClassNew", [](auto ctx, auto *stat, auto *prevStat) {
+                return ClassNew::replaceDSL(ctx, ast::cast_tree<ast::Assign>(stat));
+            }});
+        add(assigns, {core::Names::msgclass(), core::Names::enummodule()},
+            {"ProtobufDescriptorPool", [](auto ctx, auto *stat, auto *prevStat) {
+                 return ProtobufDescriptorPool::replaceDSL(ctx, ast::cast_tree<ast::Assign>(stat));
+             }});
+
+        add(sends,
+            {core::Names::prop(), core::Names::const_(), core::Names::token_prop(),
+             core::Names::timestamped_token_prop(), core::Names::created_prop(), core::Names::merchant_prop()},
+            {"ChalkODMProp", [](auto ctx, auto *stat, auto *prevStat) {
+                 return ChalkODMProp::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat));
+             }});
+        add(sends, {core::Names::encrypted_prop()}, {"MixinEncryptedProp", [](auto ctx, auto *stat, auto *prevStat) {
+                return MixinEncryptedProp::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat));
+            }});
+        add(sends, {core::Names::before(), core::Names::describe(), core::Names::it()},
+            {"Minitest", [](auto ctx, auto *stat, auto *prevStat) {
+                 return Minitest::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat));
+             }});
+        add(sends, {core::Names::dslOptional(), core::Names::dslRequired()},
+            {"DSLBuilder", [](auto ctx, auto *stat, auto *prevStat) {
+                 return DSLBuilder::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat));
+             }});
+        add(sends, {core::Names::private_(), core::Names::privateClassMethod()},
+            {"Private", [](auto ctx, auto *stat, auto *prevStat) {
+                 return Private::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat));
+             }});
+        add(sends, {core::Names::delegate()}, {"Delegate", [](auto ctx, auto *stat, auto *prevStat) {
+                return Delegate::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat));
+            }});
+        // This one is different: it gets an extra prevStat argument.
+        add(sends,
+            {core::Names::attr(), core::Names::attrReader(), core::Names::attrWriter(), core::Names::attrAccessor()},
+            {"AttrReader", [](auto ctx, auto *stat, auto *prevStat) {
+                 return AttrReader::replaceDSL(ctx, ast::cast_tree<ast::Send>(stat), prevStat);
+             }});
+    }
 
-                    nodes = Minitest::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = move(nodes);
-                        return;
-                    }
+    static void add(UnorderedMap<core::NameRef, vector<StatRewriter>> &table, initializer_list<core::NameRef> funs,
+                    StatRewriter rewriter) {
+        for (auto fun : funs) {
+            table[fun].emplace_back(rewriter);
+        }
+    }
+};
 
-                    nodes = DSLBuilder::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+// Adds the time until it is destroyed to a rewriter's counter, to show where DSL time goes.
+class RewriterTimer {
+public:
+    RewriterTimer(ConstExprStr name) : name(name), start(chrono::steady_clock::now()) {}
+    ~RewriterTimer() {
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+        prodCategoryCounterAdd("dsl.rewriter_ns", name, elapsed.count());
+    }
 
-                    nodes = Private::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+private:
+    ConstExprStr name;
+    chrono::time_point<chrono::steady_clock> start;
+};
 
-                    nodes = Delegate::replaceDSL(ctx, send);
-                    if (!nodes.empty()) {
-                        replaceNodes[stat.get()] = std::move(nodes);
-                        return;
-                    }
+} // namespace
 
-                    // This one is different: it gets an extra prevStat argument.
-                    nodes = AttrReader::replaceDSL(ctx, send, prevStat);
+class DSLReplacer {
+    friend class DSL;
+
+public:
+    unique_ptr<ast::ClassDef> postTransformClassDef(core::MutableContext ctx, unique_ptr<ast::ClassDef> classDef) {
+        {
+            RewriterTimer timer("Command");
+            Command::patchDSL(ctx, classDef.get());
+        }
+        {
+            RewriterTimer timer("Rails");
+            Rails::patchDSL(ctx, classDef.get());
+        }
+        {
+            RewriterTimer timer("OpusEnum");
+            OpusEnum::patchDSL(ctx, classDef.get());
+        }
+
+        auto &rewriters = StatRewriters::get();
+        ast::Expression *prevStat = nullptr;
+        UnorderedMap<ast::Expression *, Replacement> replaceNodes;
+        for (auto &stat : classDef->rhs) {
+            if (auto *candidates = rewriters.forStat(stat.get())) {
+                for (auto &rewriter : *candidates) {
+                    Replacement nodes;
+                    {
+                        RewriterTimer timer(rewriter.name);
+                        nodes = rewriter.replaceDSL(ctx, stat.get(), prevStat);
+                    }
                     if (!nodes.empty()) {
                         replaceNodes[stat.get()] = std::move(nodes);
-                        return;
+                        break;
                     }
-                },
-
-                [&](ast::Expression *e) {});
+                }
+            }
 
             prevStat = stat.get();
         }
@@ -5,6 +5,58 @@
 
 namespace sorbet::flatten {
 
+/**
+ * The tree walk behind runOne, exposed so that it can run fused with other passes. After TreeMap applied it, the
+ * tree must be passed to addClasses and then to addMethods.
+ */
+class FlattenWalk {
+public:
+    FlattenWalk();
+    ~FlattenWalk();
+
+    std::unique_ptr<ast::ClassDef> preTransformClassDef(core::Context ctx, std::unique_ptr<ast::ClassDef> classDef);
+    std::unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx,
+                                                          std::unique_ptr<ast::MethodDef> methodDef);
+    std::unique_ptr<ast::Expression> postTransformClassDef(core::Context ctx,
+                                                           std::unique_ptr<ast::ClassDef> classDef);
+    std::unique_ptr<ast::Expression> postTransformMethodDef(core::Context ctx,
+                                                            std::unique_ptr<ast::MethodDef> methodDef);
+
+    std::unique_ptr<ast::Expression> addClasses(core::Context ctx, std::unique_ptr<ast::Expression> tree);
+    std::unique_ptr<ast::Expression> addMethods(core::Context ctx, std::unique_ptr<ast::Expression> tree);
+
+private:
+    std::vector<std::unique_ptr<ast::ClassDef>> sortedClasses();
+    ast::ClassDef::RHS_store addMethods(core::Context ctx, ast::ClassDef::RHS_store rhs);
+    std::vector<std::unique_ptr<ast::MethodDef>> popCurMethodDefs();
+
+    struct Methods {
+        std::vector<std::unique_ptr<ast::MethodDef>> methods;
+        std::vector<int> stack;
+        Methods() = default;
+    };
+    void newMethodSet();
+    Methods &curMethodSet();
+    void popCurMethodSet();
+
+    // We flatten nested classes and methods into a flat list. We want to sort
+    // them by their starts, so that `class A; class B; end; end` --> `class A;
+    // end; class B; end`.
+    //
+    // In order to make TreeMap work out, we can't remove them from the AST
+    // until the `postTransform*` hook. Appending them to a list at that point
+    // would result in an "bottom-up" ordering, so instead we store a stack of
+    // "where does the next definition belong" into `classStack` and
+    // `methodScopes.stack`, which we push onto in the `preTransform* hook, and
+    // pop from in the `postTransform` hook.
+
+    std::vector<Methods> methodScopes;
+    std::vector<std::unique_ptr<ast::ClassDef>> classes;
+    std::vector<int> classStack;
+};
+
+// Afterwards, every class and method definition is either at the top level of the tree, possibly in an InsSeq, or
+// directly in the body of a class.
 ast::ParsedFile runOne(core::Context ctx, ast::ParsedFile trees);
 
 } // namespace sorbet::flatten
@@ -6,7 +6,6 @@ namespace sorbet::realmain::lsp {
 
 class DefLocSaver {
 public:
-    std::unique_ptr<ast::MethodDef> postTransformMethodDef(core::Context ctx,
-                                                           std::unique_ptr<ast::MethodDef> methodDef);
+    void postWalkMethodDef(core::Context ctx, const ast::MethodDef &methodDef);
 };
 }; // namespace sorbet::realmain::lsp
@@ -55,14 +55,7 @@ unique_ptr<LSPMessage> makeSorbetError(LSPErrorCodes code, string_view message,
     }
 }
 
-unique_ptr<LSPMessage> LSPMessage::fromClient(const string &json) {
-    rapidjson::MemoryPoolAllocator<> alloc;
-    rapidjson::Document d(&alloc);
-    if (d.Parse(json.c_str()).HasParseError()) {
-        return makeSorbetError(LSPErrorCodes::ParseError,
-                               fmt::format("Last LSP request: `{}` is not a valid json object", json));
-    }
-
+unique_ptr<LSPMessage> fromParsedClientJSON(rapidjson::Document &d) {
     // Grab ID before parsing, as the value may get moved out.
     optional<int> id;
     if (d.HasMember("id") && d["id"].IsInt()) {
@@ -87,6 +80,31 @@ unique_ptr<LSPMessage> LSPMessage::fromClient(const string &json) {
     }
 }
 
+unique_ptr<LSPMessage> LSPMessage::fromClient(const string &json) {
+    rapidjson::MemoryPoolAllocator<> alloc;
+    rapidjson::Document d(&alloc);
+    if (d.Parse(json.c_str()).HasParseError()) {
+        return makeSorbetError(LSPErrorCodes::ParseError,
+                               fmt::format("Last LSP request: `{}` is not a valid json object", json));
+    }
+    return fromParsedClientJSON(d);
+}
+
+unique_ptr<LSPMessage> LSPMessage::fromClientInsitu(char *json, size_t length) {
+    ENFORCE(json[length] == '\0');
+    rapidjson::MemoryPoolAllocator<> alloc;
+    rapidjson::Document d(&alloc);
+    if (d.ParseInsitu(json).HasParseError()) {
+        // Parsing in place rewrites the string literals that precede the error (their closing quotes and escapes), so
+        // those may not match what the client sent. Everything from the error onwards is untouched.
+        return makeSorbetError(LSPErrorCodes::ParseError,
+                               fmt::format("Last LSP request: `{}` is not a valid json object",
+                                           string_view(json, length)));
+    }
+    // The message copies every string it keeps, so `json` may be reused as soon as this returns.
+    return fromParsedClientJSON(d);
+}
+
 LSPMessage::RawLSPMessage fromJSONValue(rapidjson::Document &d) {
     if (d.HasMember("id")) {
         // Method is required on requests, but responses lack it.
@@ -51,6 +51,12 @@ public:
      */
     static std::unique_ptr<LSPMessage> fromClient(const std::string &json);
 
+    /**
+     * Like `fromClient`, but parses `json` in place, without copying it. `json` must be NUL-terminated at `length`,
+     * and its contents are clobbered.
+     */
+    static std::unique_ptr<LSPMessage> fromClientInsitu(char *json, size_t length);
+
     LSPMessage(RawLSPMessage msg);
     LSPMessage(rapidjson::Document &d);
     LSPMessage(const std::string &json);
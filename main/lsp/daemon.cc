@@ -0,0 +1,399 @@
+#include "main/lsp/daemon.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "common/FileOps.h"
+#include "common/Timer.h"
+#include "core/ErrorFlusher.h"
+#include "main/lsp/lsp.h"
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace sorbet::realmain::lsp {
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+/**
+ * Prepares a new or accepted socket: it must not leak into plugin subprocesses, and writing to it after the other side
+ * went away must not kill us with SIGPIPE. Returns `fd`.
+ */
+int prepareSocket(int fd) {
+    if (fd >= 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    }
+    return fd;
+}
+
+// Clients send their config key right after connecting, and read the errors as fast as they arrive. One that stalls
+// for longer than this is dropped, rather than holding up every client queued behind it.
+constexpr int CLIENT_TIMEOUT_SECONDS = 10;
+
+void setClientTimeouts(int fd) {
+    struct timeval timeout = {CLIENT_TIMEOUT_SECONDS, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+/**
+ * One end of a connection between the daemon and a client. Both sides exchange lines, and strings that may contain
+ * newlines as `<length>\n<bytes>`.
+ *
+ * The client sends its config key as a string. The daemon either replies `fallback`, or with `error` followed by the
+ * error's text for every error, and then `exit <error count> <exit code>`.
+ */
+class Connection final {
+    int fd;
+    string buffered;
+
+    bool fill() {
+        array<char, 4096> chunk;
+        while (true) {
+            const ssize_t bytesRead = ::recv(fd, chunk.data(), chunk.size(), 0);
+            if (bytesRead > 0) {
+                buffered.append(chunk.data(), bytesRead);
+                return true;
+            } else if (bytesRead == 0 || errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+public:
+    explicit Connection(int fd) : fd(fd) {}
+    Connection(const Connection &) = delete;
+    ~Connection() {
+        close(fd);
+    }
+
+    bool write(string_view data) {
+        while (!data.empty()) {
+            const ssize_t written = ::send(fd, data.data(), data.size(), SEND_FLAGS);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data.remove_prefix(written);
+        }
+        return true;
+    }
+
+    bool writeString(string_view data) {
+        return write(absl::StrCat(data.size(), "\n", data));
+    }
+
+    optional<string> readLine() {
+        size_t searchFrom = 0;
+        while (true) {
+            auto newline = buffered.find('\n', searchFrom);
+            if (newline != string::npos) {
+                string line = buffered.substr(0, newline);
+                buffered.erase(0, newline + 1);
+                return line;
+            }
+            searchFrom = buffered.size();
+            if (!fill()) {
+                return nullopt;
+            }
+        }
+    }
+
+    optional<string> readString() {
+        auto header = readLine();
+        size_t length;
+        if (!header || !absl::SimpleAtoi(*header, &length)) {
+            return nullopt;
+        }
+        while (buffered.size() < length) {
+            if (!fill()) {
+                return nullopt;
+            }
+        }
+        string result = buffered.substr(0, length);
+        buffered.erase(0, length);
+        return result;
+    }
+};
+
+bool toSocketAddress(string_view path, sockaddr_un &addr) {
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+/** Returns a socket that listens on `path`, or -1 with `errno` set. Replaces whatever is at `path`. */
+int listenOn(string_view path) {
+    sockaddr_un addr;
+    if (!toSocketAddress(path, addr)) {
+        return -1;
+    }
+    int fd = prepareSocket(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (fd < 0) {
+        return -1;
+    }
+    // A daemon that went away leaves its socket behind.
+    unlink(addr.sun_path);
+    if (::bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        auto error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Returns the input files whose contents on disk differ from what `gs` has. Input files that no longer exist are
+ * returned as empty files, which is how the language server handles deleted files, too.
+ */
+vector<shared_ptr<core::File>> changedOnDisk(const core::GlobalState &gs, const options::Options &opts) {
+    // Directories are listed again, since files may have been added to them.
+    vector<string> inputFileNames = opts.rawInputFileNames;
+    for (auto &dir : opts.rawInputDirNames) {
+        try {
+            auto containedFiles = opts.fs->listFilesInDir(dir, {".rb", ".rbi"}, true, opts.absoluteIgnorePatterns,
+                                                          opts.relativeIgnorePatterns);
+            inputFileNames.insert(inputFileNames.end(), make_move_iterator(containedFiles.begin()),
+                                  make_move_iterator(containedFiles.end()));
+        } catch (FileNotFoundException e) {
+            // Every file in it was deleted. They are picked up below.
+        }
+    }
+    fast_sort(inputFileNames);
+    inputFileNames.erase(unique(inputFileNames.begin(), inputFileNames.end()), inputFileNames.end());
+
+    vector<shared_ptr<core::File>> changed;
+    for (auto &path : inputFileNames) {
+        string contents;
+        try {
+            contents = opts.fs->readFile(path);
+        } catch (FileNotFoundException e) {
+            // Deleted while we were listing.
+        }
+        auto fref = gs.findFileByPath(path);
+        if (!fref.exists() || fref.data(gs).source() != contents) {
+            changed.emplace_back(make_shared<core::File>(string(path), move(contents), core::File::Type::Normal));
+        }
+    }
+    for (auto &file : gs.getFiles()) {
+        if (file && file->sourceType == core::File::Type::Normal && !file->source().empty() &&
+            !absl::c_binary_search(inputFileNames, file->path())) {
+            changed.emplace_back(make_shared<core::File>(string(file->path()), "", core::File::Type::Normal));
+        }
+    }
+    return changed;
+}
+} // namespace
+
+string daemonConfigKey(const vector<string> &args) {
+    string key = core::ErrorColors::enabled() ? "color" : "nocolor";
+    array<char, PATH_MAX> cwd;
+    if (getcwd(cwd.data(), cwd.size()) != nullptr) {
+        absl::StrAppend(&key, "\n", cwd.data());
+    }
+    // Options also come from `sorbet/config` and `@file` arguments. A daemon started before they changed can't serve
+    // them.
+    auto appendContents = [&](string_view path) {
+        if (FileOps::exists(path)) {
+            absl::StrAppend(&key, "\n", FileOps::read(path));
+        }
+    };
+    appendContents("sorbet/config");
+    for (auto &arg : args) {
+        absl::StrAppend(&key, "\n", arg);
+        if (absl::StartsWith(arg, "@")) {
+            appendContents(string_view(arg).substr(1));
+        }
+    }
+    return absl::StrCat(absl::Hex(std::hash<string>()(key), absl::kZeroPad16));
+}
+
+optional<int> forwardToDaemon(const options::Options &opts, spdlog::logger &logger, spdlog::logger &errorsLogger,
+                              string_view configKey) {
+    sockaddr_un addr;
+    if (!toSocketAddress(opts.daemonSocket, addr)) {
+        logger.debug("Can't connect to a typecheck daemon at `{}`: {}", opts.daemonSocket, strerror(errno));
+        return nullopt;
+    }
+    int fd = prepareSocket(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (fd < 0) {
+        return nullopt;
+    }
+    Connection daemon(fd);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        logger.debug("No typecheck daemon is listening on `{}`", opts.daemonSocket);
+        return nullopt;
+    }
+    if (!daemon.writeString(configKey)) {
+        return nullopt;
+    }
+
+    // Nothing is printed until the daemon is done, so that we can still typecheck on our own if it goes away.
+    fmt::memory_buffer errors;
+    while (auto line = daemon.readLine()) {
+        if (*line == "fallback") {
+            logger.debug("The typecheck daemon on `{}` was started with other options", opts.daemonSocket);
+            return nullopt;
+        }
+        if (*line == "error") {
+            auto text = daemon.readString();
+            if (!text) {
+                break;
+            }
+            if (errors.size() != 0) {
+                fmt::format_to(errors, "\n\n");
+            }
+            fmt::format_to(errors, "{}", *text);
+            continue;
+        }
+        vector<string_view> exit = absl::StrSplit(*line, ' ');
+        int errorCount, exitCode;
+        if (exit.size() != 3 || exit[0] != "exit" || !absl::SimpleAtoi(exit[1], &errorCount) ||
+            !absl::SimpleAtoi(exit[2], &exitCode)) {
+            break;
+        }
+        if (errors.size() != 0) {
+            errorsLogger.log(spdlog::level::err, "{}", to_string(errors));
+        }
+        if (!opts.noErrorCount) {
+            core::ErrorFlusher().flushErrorCount(errorsLogger, errorCount);
+        }
+        return exitCode;
+    }
+    logger.warn("Lost the connection to the typecheck daemon on `{}`. Typechecking without it.", opts.daemonSocket);
+    return nullopt;
+}
+
+unique_ptr<core::GlobalState> LSPLoop::runDaemon(string_view socketPath, string_view configKey) {
+    mainThreadId = this_thread::get_id();
+    // Errors that are currently reported for every file, like `publishedDiagnosticsHashes` but as command line text.
+    UnorderedMap<core::FileRef, vector<string>> errorsByFile;
+    auto recordErrors = [&](const TypecheckRun &run) {
+        UnorderedMap<core::FileRef, vector<string>> reported;
+        for (auto &error : run.errors) {
+            if (!error->isSilenced) {
+                reported[error->loc.file()].emplace_back(error->toString(*run.gs));
+            }
+        }
+        for (auto file : run.filesTypechecked) {
+            errorsByFile.erase(file);
+        }
+        for (auto &[file, errors] : reported) {
+            errorsByFile[file] = move(errors);
+        }
+    };
+
+    unique_ptr<core::GlobalState> gs;
+    {
+        Timer timeit(logger, "initial_index");
+        reIndexFromFileSystem();
+        vector<shared_ptr<core::File>> changedFiles;
+        auto run = runSlowPath(changedFiles);
+        recordErrors(run);
+        gs = move(run.gs);
+        if (!disableFastPath) {
+            globalStateHashes = computeStateHashes(gs->getFiles());
+        }
+        commitKvstore();
+    }
+
+    // Only listen once the state is warm, so that clients that come earlier don't wait for it.
+    int listener = listenOn(socketPath);
+    if (listener < 0) {
+        logger->error("Can't listen on `{}`: {}", socketPath, strerror(errno));
+        throw options::EarlyReturnWithCode(1);
+    }
+    logger->info("Listening for command line typechecks on `{}`", socketPath);
+    while (true) {
+        int fd = prepareSocket(accept(listener, nullptr, nullptr));
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            logger->error("Can't accept connections on `{}`: {}", socketPath, strerror(errno));
+            break;
+        }
+        setClientTimeouts(fd);
+        Connection client(fd);
+        auto clientKey = client.readString();
+        if (!clientKey) {
+            continue;
+        }
+        if (*clientKey != configKey) {
+            prodCategoryCounterInc("daemon.requests", "fallback");
+            client.write("fallback\n");
+            continue;
+        }
+        prodCategoryCounterInc("daemon.requests", "typecheck");
+        Timer timeit(logger, "daemon_typecheck");
+
+        auto changedFiles = changedOnDisk(*initialGS, opts);
+        logger->info("Typechecking {} changed files for a client", changedFiles.size());
+        if (!changedFiles.empty()) {
+            auto run = tryFastPath(move(gs), changedFiles);
+            recordErrors(run);
+            gs = move(run.gs);
+        }
+
+        vector<core::FileRef> files;
+        for (auto &entry : errorsByFile) {
+            files.emplace_back(entry.first);
+        }
+        fast_sort(files, [&](core::FileRef left, core::FileRef right) -> bool {
+            string_view leftPath = left.exists() ? left.data(*gs).path() : "";
+            string_view rightPath = right.exists() ? right.data(*gs).path() : "";
+            return leftPath < rightPath;
+        });
+        int errorCount = 0;
+        bool sent = true;
+        for (auto file : files) {
+            for (auto &text : errorsByFile[file]) {
+                errorCount++;
+                sent = sent && client.write("error\n") && client.writeString(text);
+            }
+        }
+        int exitCode = 0;
+        if (gs->hadCriticalError()) {
+            exitCode = 10;
+        } else if (errorCount > 0 && !opts.supressNonCriticalErrors) {
+            exitCode = 1;
+        }
+        if (!sent || !client.write(fmt::format("exit {} {}\n", errorCount, exitCode))) {
+            logger->debug("The client went away before it got all errors");
+        }
+
+        auto currentTime = chrono::steady_clock::now();
+        if (shouldSendCountersToStatsd(currentTime)) {
+            sendCountersToStatsd(currentTime);
+        }
+    }
+    close(listener);
+    return gs;
+}
+
+} // namespace sorbet::realmain::lsp
@@ -0,0 +1,28 @@
+#ifndef RUBY_TYPER_LSP_DAEMON_H
+#define RUBY_TYPER_LSP_DAEMON_H
+
+#include "main/options/options.h"
+#include "spdlog/spdlog.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sorbet::realmain::lsp {
+
+/**
+ * Identifies what a typecheck daemon can serve: the command line (without `argv[0]` and `--daemon`), the files it
+ * pulls options from, the working directory and whether errors are colored. A daemon only serves clients with the same
+ * key, since its GlobalState was built with its own options.
+ */
+std::string daemonConfigKey(const std::vector<std::string> &args);
+
+/**
+ * Asks the daemon listening on `opts.daemonSocket` to typecheck, and prints the errors it reports like a command line
+ * run would. Returns the exit code, or nullopt if there is no daemon or it can't serve `configKey`; the caller then
+ * typechecks on its own.
+ */
+std::optional<int> forwardToDaemon(const options::Options &opts, spdlog::logger &logger,
+                                   spdlog::logger &errorsLogger, std::string_view configKey);
+
+} // namespace sorbet::realmain::lsp
+#endif // RUBY_TYPER_LSP_DAEMON_H
@@ -1,7 +1,6 @@
 #include "main/lsp/lsp.h"
 #include "common/Timer.h"
 #include "common/statsd/statsd.h"
-#include "common/typecase.h"
 #include "common/web_tracer_framework/tracing.h"
 #include "core/errors/internal.h"
 #include "core/errors/namer.h"
@@ -13,15 +12,19 @@ namespace sorbet::realmain::lsp {
 
 LSPLoop::LSPLoop(unique_ptr<core::GlobalState> gs, const options::Options &opts, const shared_ptr<spd::logger> &logger,
                  WorkerPool &workers, int inputFd, std::ostream &outputStream, bool skipConfigatron,
-                 bool disableFastPath)
-    : initialGS(std::move(gs)), opts(opts), logger(logger), workers(workers), inputFd(inputFd),
-      outputStream(outputStream), skipConfigatron(skipConfigatron), disableFastPath(disableFastPath),
-      lastMetricUpdateTime(chrono::steady_clock::now()) {
+                 bool disableFastPath, unique_ptr<KeyValueStore> kvstore)
+    : initialGS(std::move(gs)), opts(opts), kvstore(std::move(kvstore)), logger(logger), workers(workers),
+      inputFd(inputFd), outputStream(outputStream), skipConfigatron(skipConfigatron), disableFastPath(disableFastPath),
+      lastMetricUpdateTime(chrono::steady_clock::now()), firstCollectableName(initialGS->namesUsed()) {
     errorQueue = dynamic_pointer_cast<core::ErrorQueue>(initialGS->errorQueue);
     ENFORCE(errorQueue, "LSPLoop got an unexpected error queue");
     ENFORCE(errorQueue->ignoreFlushes,
             "LSPLoop's error queue is not ignoring flushes, which will prevent LSP from sending diagnostics");
 
+    if (opts.runDaemon) {
+        // The typecheck daemon takes the same inputs as a command line run, and has no client workspace.
+        return;
+    }
     if (opts.rawInputDirNames.size() != 1) {
         logger->error("Sorbet's language server requires a single input directory.");
         throw options::EarlyReturnWithCode(1);
@@ -43,11 +46,19 @@ LSPLoop::TypecheckRun LSPLoop::runLSPQuery(unique_ptr<core::GlobalState> gs, con
     return rv;
 }
 
+LSPLoop::QueryContext LSPLoop::mainThreadQueryContext() {
+    return QueryContext{clientSettings, false,
+                        [this](unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
+                               vector<shared_ptr<core::File>> &changedFiles) {
+                            return runLSPQuery(move(gs), q, changedFiles);
+                        }};
+}
+
 variant<LSPLoop::TypecheckRun, pair<unique_ptr<ResponseError>, unique_ptr<core::GlobalState>>>
-LSPLoop::setupLSPQueryByLoc(unique_ptr<core::GlobalState> gs, string_view uri, const Position &pos,
-                            const LSPMethod forMethod, bool errorIfFileIsUntyped) {
+LSPLoop::setupLSPQueryByLoc(unique_ptr<core::GlobalState> gs, const QueryContext &query, string_view uri,
+                            const Position &pos, const LSPMethod forMethod, bool errorIfFileIsUntyped) const {
     Timer timeit(logger, "setupLSPQueryByLoc");
-    auto fref = uri2FileRef(uri);
+    auto fref = uri2FileRef(*gs, query.client, uri);
     if (!fref.exists()) {
         return make_pair(make_unique<ResponseError>((int)LSPErrorCodes::InvalidParams,
                                                     fmt::format("Did not find file at uri {} in {}", uri,
@@ -70,7 +81,7 @@ LSPLoop::setupLSPQueryByLoc(unique_ptr<core::GlobalState> gs, string_view uri, c
 
     vector<shared_ptr<core::File>> files;
     files.emplace_back(fref.data(*gs).deepCopy(*gs));
-    return runLSPQuery(move(gs), core::lsp::Query::createLocQuery(*loc.get()), files);
+    return query.runQuery(move(gs), core::lsp::Query::createLocQuery(*loc.get()), files);
 }
 LSPLoop::TypecheckRun LSPLoop::setupLSPQueryBySymbol(unique_ptr<core::GlobalState> gs, core::SymbolRef sym) {
     Timer timeit(logger, "setupLSPQueryBySymbol");
@@ -88,11 +99,79 @@ bool LSPLoop::ensureInitialized(LSPMethod forMethod, const LSPMessage &msg,
     return false;
 }
 
+unique_ptr<LSPMessage> LSPLoop::diagnosticsIfChanged(const core::GlobalState &gs, core::FileRef file,
+                                                     const vector<const core::Error *> &errors) {
+    auto published = publishedDiagnosticsHashes.find(file);
+    if (errors.empty() && published == publishedDiagnosticsHashes.end()) {
+        // The client has no diagnostics for this file, and there are none to add.
+        return nullptr;
+    }
+
+    string uri;
+    { // uri
+        if (file.data(gs).sourceType == core::File::Type::Payload) {
+            uri = string(file.data(gs).path());
+        } else {
+            uri = localName2Remote(clientSettings, file.data(gs).path());
+        }
+    }
+
+    vector<unique_ptr<Diagnostic>> diagnostics;
+    {
+        // diagnostics
+        for (auto e : errors) {
+            auto diagnostic = make_unique<Diagnostic>(loc2Range(gs, e->loc), e->header);
+            diagnostic->code = e->what.code;
+            diagnostic->severity = DiagnosticSeverity::Error;
+
+            vector<unique_ptr<DiagnosticRelatedInformation>> relatedInformation;
+            for (auto &section : e->sections) {
+                string sectionHeader = section.header;
+
+                for (auto &errorLine : section.messages) {
+                    string message;
+                    if (errorLine.formattedMessage.length() > 0) {
+                        message = errorLine.formattedMessage;
+                    } else {
+                        message = sectionHeader;
+                    }
+                    relatedInformation.push_back(make_unique<DiagnosticRelatedInformation>(
+                        loc2Location(gs, clientSettings, errorLine.loc), message));
+                }
+            }
+            // Add link to error documentation.
+            relatedInformation.push_back(make_unique<DiagnosticRelatedInformation>(
+                make_unique<Location>(absl::StrCat(opts.errorUrlBase, e->what.code),
+                                      make_unique<Range>(make_unique<Position>(0, 0), make_unique<Position>(0, 0))),
+                "Click for more information on this error."));
+            diagnostic->relatedInformation = move(relatedInformation);
+            diagnostics.push_back(move(diagnostic));
+        }
+    }
+
+    auto params = make_unique<PublishDiagnosticsParams>(uri, move(diagnostics));
+    if (errors.empty()) {
+        publishedDiagnosticsHashes.erase(published);
+    } else {
+        // Hash what the client sees, since the same errors can map to different ranges after an edit.
+        auto hash = std::hash<string>()(params->toJSON());
+        if (published != publishedDiagnosticsHashes.end() && published->second == hash) {
+            return nullptr;
+        }
+        publishedDiagnosticsHashes[file] = hash;
+    }
+    return make_unique<LSPMessage>(
+        make_unique<NotificationMessage>("2.0", LSPMethod::TextDocumentPublishDiagnostics, move(params)));
+}
+
 LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
+    if (run.canceled) {
+        // The newer updates that canceled this run are next in the queue, and their run will publish diagnostics.
+        return LSPResult{move(run.gs), {}};
+    }
     const core::GlobalState &gs = *run.gs;
     const auto &filesTypechecked = run.filesTypechecked;
-    vector<core::FileRef> errorFilesInNewRun;
-    UnorderedMap<core::FileRef, vector<std::unique_ptr<core::Error>>> errorsAccumulated;
+    UnorderedMap<core::FileRef, vector<const core::Error *>> errorsAccumulated;
     vector<unique_ptr<LSPMessage>> responses;
 
     if (enableTypecheckInfo) {
@@ -110,95 +189,69 @@ LSPResult LSPLoop::pushDiagnostics(TypecheckRun run) {
             continue;
         }
         auto file = e->loc.file();
-        errorsAccumulated[file].emplace_back(std::move(e));
+        errorsAccumulated[file].emplace_back(e.get());
     }
 
+    // Diagnostics of typechecked files are replaced, even if they have no errors anymore. Errors can also show up in
+    // files that weren't typechecked. Every other file keeps the diagnostics it has.
+    vector<core::FileRef> filesToUpdateErrorListFor = filesTypechecked;
     for (auto &accumulated : errorsAccumulated) {
-        errorFilesInNewRun.push_back(accumulated.first);
-    }
-
-    vector<core::FileRef> filesToUpdateErrorListFor = errorFilesInNewRun;
-
-    UnorderedSet<core::FileRef> filesTypecheckedAsSet;
-    filesTypecheckedAsSet.insert(filesTypechecked.begin(), filesTypechecked.end());
-
-    for (auto f : this->filesThatHaveErrors) {
-        if (filesTypecheckedAsSet.find(f) != filesTypecheckedAsSet.end()) {
-            // we've retypechecked this file. We can override the fact it has an error
-            // thus, we will update the error list for this file on client
-            filesToUpdateErrorListFor.push_back(f);
-        } else {
-            // we're not typecking this file, we need to remember that it had error
-            errorFilesInNewRun.push_back(f);
-        }
+        filesToUpdateErrorListFor.push_back(accumulated.first);
     }
 
     fast_sort(filesToUpdateErrorListFor);
     filesToUpdateErrorListFor.erase(unique(filesToUpdateErrorListFor.begin(), filesToUpdateErrorListFor.end()),
                                     filesToUpdateErrorListFor.end());
 
-    fast_sort(errorFilesInNewRun);
-    errorFilesInNewRun.erase(unique(errorFilesInNewRun.begin(), errorFilesInNewRun.end()), errorFilesInNewRun.end());
-
-    this->filesThatHaveErrors = errorFilesInNewRun;
-
+    const vector<const core::Error *> noErrors;
     for (auto file : filesToUpdateErrorListFor) {
         if (file.exists()) {
-            string uri;
-            { // uri
-                if (file.data(gs).sourceType == core::File::Type::Payload) {
-                    uri = string(file.data(gs).path());
-                } else {
-                    uri = localName2Remote(file.data(gs).path());
-                }
-            }
-
-            vector<unique_ptr<Diagnostic>> diagnostics;
-            {
-                // diagnostics
-                if (errorsAccumulated.find(file) != errorsAccumulated.end()) {
-                    for (auto &e : errorsAccumulated[file]) {
-                        auto diagnostic = make_unique<Diagnostic>(loc2Range(gs, e->loc), e->header);
-                        diagnostic->code = e->what.code;
-                        diagnostic->severity = DiagnosticSeverity::Error;
-
-                        typecase(e.get(), [&](core::Error *ce) {
-                            vector<unique_ptr<DiagnosticRelatedInformation>> relatedInformation;
-                            for (auto &section : ce->sections) {
-                                string sectionHeader = section.header;
-
-                                for (auto &errorLine : section.messages) {
-                                    string message;
-                                    if (errorLine.formattedMessage.length() > 0) {
-                                        message = errorLine.formattedMessage;
-                                    } else {
-                                        message = sectionHeader;
-                                    }
-                                    relatedInformation.push_back(make_unique<DiagnosticRelatedInformation>(
-                                        loc2Location(gs, errorLine.loc), message));
-                                }
-                            }
-                            // Add link to error documentation.
-                            relatedInformation.push_back(make_unique<DiagnosticRelatedInformation>(
-                                make_unique<Location>(
-                                    absl::StrCat(opts.errorUrlBase, e->what.code),
-                                    make_unique<Range>(make_unique<Position>(0, 0), make_unique<Position>(0, 0))),
-                                "Click for more information on this error."));
-                            diagnostic->relatedInformation = move(relatedInformation);
-                        });
-                        diagnostics.push_back(move(diagnostic));
-                    }
-                }
+            auto accumulated = errorsAccumulated.find(file);
+            auto msg = diagnosticsIfChanged(gs, file,
+                                            accumulated == errorsAccumulated.end() ? noErrors : accumulated->second);
+            if (msg) {
+                responses.push_back(move(msg));
+            } else {
+                prodCounterInc("lsp.diagnostics.unchanged");
             }
-
-            responses.push_back(make_unique<LSPMessage>(
-                make_unique<NotificationMessage>("2.0", LSPMethod::TextDocumentPublishDiagnostics,
-                                                 make_unique<PublishDiagnosticsParams>(uri, move(diagnostics)))));
         }
     }
+    publishSnapshot(gs);
     return LSPResult{move(run.gs), move(responses)};
 }
 
+void LSPLoop::publishSnapshot(const core::GlobalState &gs) {
+    if (queueMutex == nullptr) {
+        // No snapshot query thread outside of runLSP.
+        return;
+    }
+    Timer timeit(logger, "publish_snapshot");
+    // Files are shared with the snapshot. Compute their lazily-initialized line breaks here, so that the snapshot
+    // query thread never writes to them.
+    for (auto &file : gs.getFiles()) {
+        if (file) {
+            file->lineBreaks();
+        }
+    }
+    shared_ptr<const core::GlobalState> snapshot = gs.deepCopy(true);
+    absl::MutexLock lck(queueMutex);
+    queueState->snapshot = move(snapshot);
+    queueState->snapshotClientSettings = clientSettings;
+    queueState->changedSinceSnapshot.clear();
+}
+
+void LSPLoop::invalidateSnapshotFiles(const UnorderedMap<string, string> &updates) {
+    if (queueMutex == nullptr) {
+        return;
+    }
+    vector<string> uris;
+    for (auto &update : updates) {
+        uris.emplace_back(localName2Remote(clientSettings, update.first));
+    }
+    absl::MutexLock lck(queueMutex);
+    queueState->changedSinceSnapshot.insert(make_move_iterator(uris.begin()), make_move_iterator(uris.end()));
+}
+
 constexpr chrono::minutes STATSD_INTERVAL = chrono::minutes(5);
 
 bool LSPLoop::shouldSendCountersToStatsd(chrono::time_point<chrono::steady_clock> currentTime) {
@@ -1,6 +1,7 @@
 #ifndef RUBY_TYPER_LSPLOOP_H
 #define RUBY_TYPER_LSPLOOP_H
 
+#include "absl/synchronization/mutex.h"
 #include "ast/ast.h"
 #include "common/concurrency/WorkerPool.h"
 #include "common/kvstore/KeyValueStore.h"
@@ -11,6 +12,7 @@
 #include "main/options/options.h"
 #include <chrono>
 #include <deque>
+#include <functional>
 #include <optional>
 
 //  _     ____  ____
@@ -49,6 +51,23 @@ struct LSPResult {
     static LSPResult make(std::unique_ptr<core::GlobalState> gs, std::unique_ptr<ResponseMessage> response);
 };
 
+/**
+ * What the client told us in `initialize`. The main thread only writes it while handling `initialize`; the snapshot
+ * query thread answers queries with a copy that was published along with the snapshot.
+ */
+struct LSPClientSettings {
+    /** Root of LSP client workspace */
+    std::string rootUri;
+    /**
+     * Whether or not the active client has support for snippets in CompletionItems.
+     * Note: There is a generated ClientCapabilities class, but it is cumbersome to work with as most fields are
+     * optional.
+     */
+    bool completionItemSnippetSupport = false;
+    /** What hover markup should we send to the client? */
+    MarkupKind hoverMarkupKind = MarkupKind::Plaintext;
+};
+
 class LSPLoop {
     friend class LSPWrapper;
 
@@ -61,6 +80,48 @@ class LSPLoop {
         int errorCode;
         // Counters collected from worker threads.
         CounterState counters;
+        // If set, enqueueing a file update cancels the slow path that is currently running (if it is cancelable).
+        std::shared_ptr<std::atomic<bool>> typecheckCanceled;
+        // True while the main thread runs a slow path. Meanwhile, the snapshot query thread answers read-only
+        // queries at the front of the queue from `snapshot`.
+        bool slowPathRunning = false;
+        // Copy of the GlobalState of the last completed typecheck. Never mutated once published.
+        std::shared_ptr<const core::GlobalState> snapshot;
+        // Copy of the client settings, taken when `snapshot` was published.
+        LSPClientSettings snapshotClientSettings;
+        // URIs of the files changed by the file updates that the main thread picked up since `snapshot` was
+        // published. Queries into them are left to the main thread; see `findSnapshotQuery`.
+        UnorderedSet<std::string> changedSinceSnapshot;
+    };
+
+    /**
+     * Object that uses the RAII pattern to mark the duration of a slow path in the QueueState, which lets the
+     * snapshot query thread pick up queries in the meantime.
+     */
+    class SlowPathInProgress final {
+    private:
+        LSPLoop &loop;
+
+    public:
+        SlowPathInProgress(LSPLoop &loop);
+        ~SlowPathInProgress();
+    };
+
+    /**
+     * Object that uses the RAII pattern to publish diagnostics for files that are open in the client as soon as they
+     * are typechecked, instead of at the end of the run. Only active in runLSP; everywhere else, callers send
+     * responses once the request is done.
+     */
+    class StreamOpenFileDiagnostics final {
+    private:
+        LSPLoop &loop;
+        const core::GlobalState &gs;
+        UnorderedSet<core::FileRef> openFileRefs;
+
+    public:
+        StreamOpenFileDiagnostics(LSPLoop &loop, const core::GlobalState &gs);
+        ~StreamOpenFileDiagnostics();
+        bool isOpen(core::FileRef file) const;
     };
 
     /**
@@ -82,10 +143,13 @@ class LSPLoop {
     std::vector<ast::ParsedFile> indexed;
     /** Hashes of global states obtained by resolving every file in isolation. Used for fastpath. */
     std::vector<core::FileHash> globalStateHashes;
-    /** List of files that have had errors in last run*/
-    std::vector<core::FileRef> filesThatHaveErrors;
-    /** Root of LSP client workspace */
-    std::string rootUri;
+    /**
+     * Hash of the diagnostics last published for every file that has diagnostics on the client. Diagnostics are only
+     * published again when they change.
+     */
+    UnorderedMap<core::FileRef, size_t> publishedDiagnosticsHashes;
+    /** Only read on the main thread. See `LSPClientSettings`. */
+    LSPClientSettings clientSettings;
     /** File system root of LSP client workspace. May be empty if it is the current working directory. */
     std::string rootPath;
 
@@ -100,17 +164,14 @@ class LSPLoop {
      */
     std::unique_ptr<core::GlobalState> initialGS;
     const options::Options &opts;
-    std::unique_ptr<KeyValueStore> kvstore; // always null for now.
-    std::shared_ptr<spdlog::logger> logger;
-    WorkerPool &workers;
     /**
-     * Whether or not the active client has support for snippets in CompletionItems.
-     * Note: There is a generated ClientCapabilities class, but it is cumbersome to work with as most fields are
-     * optional.
+     * The on-disk cache shared with command line runs. It holds parsed trees and the file hashes behind
+     * `globalStateHashes`. It is only open until the initial typecheck, because it locks the cache for writing; see
+     * `commitKvstore`.
      */
-    bool clientCompletionItemSnippetSupport = false;
-    /** What hover markup should we send to the client? */
-    MarkupKind clientHoverMarkupKind = MarkupKind::Plaintext;
+    std::unique_ptr<KeyValueStore> kvstore;
+    std::shared_ptr<spdlog::logger> logger;
+    WorkerPool &workers;
     /** Input file descriptor; used by runLSP to receive LSP messages */
     int inputFd;
     /** Output stream; used by LSP to output messages */
@@ -141,17 +202,50 @@ class LSPLoop {
     std::chrono::time_point<std::chrono::steady_clock> lastMetricUpdateTime;
     /** ID of the main thread, which actually processes LSP requests and performs typechecking. */
     std::thread::id mainThreadId;
+    /** The queue that runLSP shares with the reader and snapshot query threads, and its mutex. Null otherwise. */
+    QueueState *queueState = nullptr;
+    absl::Mutex *queueMutex = nullptr;
+    /** Serializes writes to `outputStream`, which both the main and the snapshot query thread send messages to. */
+    absl::Mutex outputMutex;
+    /**
+     * True if the last slow path was canceled by a newer file update. `initialGS` and `indexed` already contain the
+     * canceled update, but no GlobalState has been resolved with it, so the next typecheck must be a slow path.
+     */
+    bool lastSlowPathWasCanceled = false;
+    /**
+     * Files that canceled slow paths indexed since the last completed one. The errors that indexing reported for them
+     * were dropped along with the canceled run, so the next slow path indexes them again.
+     */
+    std::vector<core::FileRef> filesIndexedByCanceledSlowPaths;
+    /**
+     * Names before this one were entered before indexing, e.g. by the payload or a cached name table, and are never
+     * collected. See `compactNames`.
+     */
+    u4 firstCollectableName = 0;
+    /** Size of `initialGS`'s name table after indexing or after it was last compacted. 0 before indexing. */
+    u4 namesAfterLastCompaction = 0;
 
     /* Send the given message to client */
     void sendMessage(const LSPMessage &msg);
 
-    std::unique_ptr<Location> loc2Location(const core::GlobalState &gs, core::Loc loc);
-    void addLocIfExists(const core::GlobalState &gs, std::vector<std::unique_ptr<Location>> &locs, core::Loc loc);
+    std::unique_ptr<Location> loc2Location(const core::GlobalState &gs, const LSPClientSettings &client,
+                                           core::Loc loc) const;
+    void addLocIfExists(const core::GlobalState &gs, const LSPClientSettings &client,
+                        std::vector<std::unique_ptr<Location>> &locs, core::Loc loc) const;
 
     core::FileRef updateFile(const std::shared_ptr<core::File> &file);
     /** Invalidate all currently cached trees and re-index them from file system.
      * This runs code that is not considered performance critical and this is expected to be slow */
     void reIndexFromFileSystem();
+    /** Writes what the initial index added to the cache and closes it. */
+    void commitKvstore();
+    /**
+     * Edits keep adding names to `initialGS`, and the names of deleted code are never removed. Once the name table
+     * doubled since indexing or the last compaction, this replaces `initialGS` with a copy that only has the names
+     * that `indexed` still uses, and remaps `indexed` to it. Must only be called before a slow path, since every
+     * GlobalState copied from the old `initialGS` uses the old name ids.
+     */
+    void compactNames();
     struct TypecheckRun {
         std::vector<std::unique_ptr<core::Error>> errors;
         std::vector<core::FileRef> filesTypechecked;
@@ -159,27 +253,78 @@ class LSPLoop {
         // The global state, post-typechecking.
         std::unique_ptr<core::GlobalState> gs;
         bool tookFastPath;
+        // If true, the run was abandoned because newer file updates arrived. `errors` and `responses` are empty and
+        // `gs` is the GlobalState from the last completed run.
+        bool canceled = false;
     };
-    /** Conservatively rerun entire pipeline without caching any trees */
-    TypecheckRun runSlowPath(const std::vector<std::shared_ptr<core::File>> &changedFiles);
+    /**
+     * What the query handlers that take it need besides the GlobalState they answer from. Those handlers are `const`,
+     * so that the snapshot query thread can run them.
+     */
+    struct QueryContext {
+        const LSPClientSettings &client;
+        // True if queries are answered from a snapshot, which may miss recent edits.
+        bool fromSnapshot;
+        // Runs a query against `changedFiles`: `runLSPQuery` on the main thread, `runQueryOnSnapshot` otherwise.
+        std::function<TypecheckRun(std::unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
+                                   std::vector<std::shared_ptr<core::File>> &changedFiles)>
+            runQuery;
+    };
+    /** The QueryContext of requests that the main thread answers. */
+    QueryContext mainThreadQueryContext();
+    /**
+     * Conservatively rerun entire pipeline without caching any trees. If `isCancelable` is true, the run stops early
+     * once `initialGS->typecheckCanceled` is set, and the returned run is marked as canceled.
+     */
+    TypecheckRun runSlowPath(const std::vector<std::shared_ptr<core::File>> &changedFiles, bool isCancelable = false);
     /** Returns `true` if the given changes can run on the fast path. */
     bool canTakeFastPath(const std::vector<std::shared_ptr<core::File>> &changedFiles,
                          const std::vector<core::FileHash> &hashes) const;
     /** Apply conservative heuristics to see if we can run a fast path, if not, bail out and run slowPath */
     TypecheckRun tryFastPath(std::unique_ptr<core::GlobalState> gs,
-                             std::vector<std::shared_ptr<core::File>> &changedFiles, bool allFiles = false);
+                             std::vector<std::shared_ptr<core::File>> &changedFiles, bool allFiles = false,
+                             bool isCancelable = false);
 
     LSPResult pushDiagnostics(TypecheckRun run);
+    /**
+     * Returns a publishDiagnostics notification that replaces the diagnostics of `file` with `errors`, or nullptr if the
+     * client already has exactly these. Updates `publishedDiagnosticsHashes`.
+     */
+    std::unique_ptr<LSPMessage> diagnosticsIfChanged(const core::GlobalState &gs, core::FileRef file,
+                                                     const std::vector<const core::Error *> &errors);
+    /** Publishes a copy of `gs` as the snapshot that queries are answered from while a slow path runs. */
+    void publishSnapshot(const core::GlobalState &gs);
+    /** Records that `updates` change files that the current snapshot has older contents of. */
+    void invalidateSnapshotFiles(const UnorderedMap<std::string, std::string> &updates);
+    /**
+     * Returns the position of the first query in `state.pendingRequests` that can be answered from the snapshot, or
+     * -1. Queries behind a file update are left alone, since the update may change their answer. So are queries into
+     * files that changed since the snapshot, since their positions refer to text that the snapshot doesn't have.
+     */
+    static int findSnapshotQuery(const QueueState &state);
+    /**
+     * Runs `q` against `changedFiles` on the calling thread, without touching `initialGS`, `indexed` or any other state
+     * that the main thread updates. `gs` must be a private copy of the snapshot.
+     */
+    TypecheckRun runQueryOnSnapshot(std::unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
+                                    std::vector<std::shared_ptr<core::File>> &changedFiles) const;
+    /**
+     * Answers a query that `findSnapshotQuery` picked on the snapshot query thread. `gs` must be a private copy of the
+     * snapshot, and `client` the settings published with it.
+     */
+    LSPResult processSnapshotQuery(std::unique_ptr<core::GlobalState> gs, const LSPClientSettings &client,
+                                   const LSPMessage &msg) const;
 
     std::vector<core::FileHash> computeStateHashes(const std::vector<std::shared_ptr<core::File>> &files);
     bool ensureInitialized(const LSPMethod forMethod, const LSPMessage &msg,
                            const std::unique_ptr<core::GlobalState> &currentGs);
 
-    core::FileRef uri2FileRef(std::string_view uri);
-    std::string fileRef2Uri(const core::GlobalState &gs, core::FileRef);
-    std::string remoteName2Local(std::string_view uri);
-    std::string localName2Remote(std::string_view uri);
-    std::unique_ptr<core::Loc> lspPos2Loc(core::FileRef fref, const Position &pos, const core::GlobalState &gs);
+    core::FileRef uri2FileRef(const core::GlobalState &gs, const LSPClientSettings &client,
+                              std::string_view uri) const;
+    std::string fileRef2Uri(const core::GlobalState &gs, const LSPClientSettings &client, core::FileRef) const;
+    std::string remoteName2Local(const LSPClientSettings &client, std::string_view uri) const;
+    std::string localName2Remote(const LSPClientSettings &client, std::string_view uri) const;
+    std::unique_ptr<core::Loc> lspPos2Loc(core::FileRef fref, const Position &pos, const core::GlobalState &gs) const;
 
     /** Used to implement textDocument/documentSymbol
      * Returns `nullptr` if symbol kind is not supported by LSP
@@ -188,29 +333,30 @@ class LSPLoop {
     TypecheckRun runLSPQuery(std::unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
                              std::vector<std::shared_ptr<core::File>> &changedFiles, bool allFiles = false);
     std::variant<LSPLoop::TypecheckRun, std::pair<std::unique_ptr<ResponseError>, std::unique_ptr<core::GlobalState>>>
-    setupLSPQueryByLoc(std::unique_ptr<core::GlobalState> gs, std::string_view uri, const Position &pos,
-                       const LSPMethod forMethod, bool errorIfFileIsUntyped);
+    setupLSPQueryByLoc(std::unique_ptr<core::GlobalState> gs, const QueryContext &query, std::string_view uri,
+                       const Position &pos, const LSPMethod forMethod, bool errorIfFileIsUntyped) const;
     TypecheckRun setupLSPQueryBySymbol(std::unique_ptr<core::GlobalState> gs, core::SymbolRef symbol);
-    LSPResult handleTextDocumentHover(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                      const TextDocumentPositionParams &params);
+    LSPResult handleTextDocumentHover(std::unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                      const MessageId &id, const TextDocumentPositionParams &params) const;
     LSPResult handleTextDocumentDocumentSymbol(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
                                                const DocumentSymbolParams &params);
     LSPResult handleWorkspaceSymbols(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
                                      const WorkspaceSymbolParams &params);
     LSPResult handleTextDocumentReferences(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
                                            const ReferenceParams &params);
-    LSPResult handleTextDocumentDefinition(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                           const TextDocumentPositionParams &params);
-    LSPResult handleTextDocumentCompletion(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                           const CompletionParams &params);
-    std::unique_ptr<CompletionItem> getCompletionItem(const core::GlobalState &gs, core::SymbolRef what,
-                                                      core::TypePtr receiverType,
-                                                      const std::shared_ptr<core::TypeConstraint> &constraint);
-    void findSimilarConstantOrIdent(const core::GlobalState &gs, const core::TypePtr receiverType,
-                                    std::vector<std::unique_ptr<CompletionItem>> &items);
+    LSPResult handleTextDocumentDefinition(std::unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                           const MessageId &id, const TextDocumentPositionParams &params) const;
+    LSPResult handleTextDocumentCompletion(std::unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                           const MessageId &id, const CompletionParams &params) const;
+    std::unique_ptr<CompletionItem> getCompletionItem(const core::GlobalState &gs, const LSPClientSettings &client,
+                                                      core::SymbolRef what, core::TypePtr receiverType,
+                                                      const std::shared_ptr<core::TypeConstraint> &constraint) const;
+    void findSimilarConstantOrIdent(const core::GlobalState &gs, const LSPClientSettings &client,
+                                    const core::TypePtr receiverType,
+                                    std::vector<std::unique_ptr<CompletionItem>> &items) const;
     void sendShowMessageNotification(MessageType messageType, std::string_view message);
-    LSPResult handleTextSignatureHelp(std::unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                      const TextDocumentPositionParams &params);
+    LSPResult handleTextSignatureHelp(std::unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                      const MessageId &id, const TextDocumentPositionParams &params) const;
     /**
      * Performs pre-processing on the incoming LSP request and appends it to the queue.
      * Merges changes to the same document + Watchman filesystem updates, and processes pause/ignore requests.
@@ -250,8 +396,15 @@ class LSPLoop {
 public:
     LSPLoop(std::unique_ptr<core::GlobalState> gs, const options::Options &opts,
             const std::shared_ptr<spd::logger> &logger, WorkerPool &workers, int inputFd, std::ostream &output,
-            bool skipConfigatron = false, bool disableFastPath = false);
+            bool skipConfigatron = false, bool disableFastPath = false,
+            std::unique_ptr<KeyValueStore> kvstore = nullptr);
     std::unique_ptr<core::GlobalState> runLSP();
+    /**
+     * Typechecks the input files once, and then serves command line typechecks (see `forwardToDaemon`) that send
+     * `configKey` on the Unix socket at `socketPath`. Every typecheck picks up the files that changed on disk since the
+     * last one, on the fast path if it can. Only returns if the socket breaks.
+     */
+    std::unique_ptr<core::GlobalState> runDaemon(std::string_view socketPath, std::string_view configKey);
     LSPResult processRequest(std::unique_ptr<core::GlobalState> gs, const LSPMessage &msg);
     LSPResult processRequest(std::unique_ptr<core::GlobalState> gs, const std::string &json);
     /**
@@ -6,9 +6,9 @@ using namespace std;
 
 namespace sorbet::realmain::lsp {
 
-string LSPLoop::remoteName2Local(string_view uri) {
-    ENFORCE(absl::StartsWith(uri, rootUri));
-    const char *start = uri.data() + rootUri.length();
+string LSPLoop::remoteName2Local(const LSPClientSettings &client, string_view uri) const {
+    ENFORCE(absl::StartsWith(uri, client.rootUri));
+    const char *start = uri.data() + client.rootUri.length();
     if (*start == '/') {
         ++start;
     }
@@ -20,7 +20,7 @@ string LSPLoop::remoteName2Local(string_view uri) {
     }
 }
 
-string LSPLoop::localName2Remote(string_view uri) {
+string LSPLoop::localName2Remote(const LSPClientSettings &client, string_view uri) const {
     ENFORCE(absl::StartsWith(uri, rootPath));
     string_view relativeUri = uri.substr(rootPath.length());
     if (relativeUri.at(0) == '/') {
@@ -28,26 +28,27 @@ string LSPLoop::localName2Remote(string_view uri) {
     }
 
     // Special case: Root uri is '' (happens in Monaco)
-    if (rootUri.length() == 0) {
+    if (client.rootUri.length() == 0) {
         return string(relativeUri);
     }
 
-    return absl::StrCat(rootUri, "/", relativeUri);
+    return absl::StrCat(client.rootUri, "/", relativeUri);
 }
 
-core::FileRef LSPLoop::uri2FileRef(string_view uri) {
-    if (!absl::StartsWith(uri, rootUri)) {
+core::FileRef LSPLoop::uri2FileRef(const core::GlobalState &gs, const LSPClientSettings &client,
+                                   string_view uri) const {
+    if (!absl::StartsWith(uri, client.rootUri)) {
         return core::FileRef();
     }
-    auto needle = remoteName2Local(uri);
-    return initialGS->findFileByPath(needle);
+    auto needle = remoteName2Local(client, uri);
+    return gs.findFileByPath(needle);
 }
 
-string LSPLoop::fileRef2Uri(const core::GlobalState &gs, core::FileRef file) {
+string LSPLoop::fileRef2Uri(const core::GlobalState &gs, const LSPClientSettings &client, core::FileRef file) const {
     if (file.data(gs).sourceType == core::File::Type::Payload) {
         return string(file.data(gs).path());
     } else {
-        return localName2Remote(string(file.data(gs).path()));
+        return localName2Remote(client, string(file.data(gs).path()));
     }
 }
 unique_ptr<Range> loc2Range(const core::GlobalState &gs, core::Loc loc) {
@@ -65,10 +66,11 @@ unique_ptr<Range> loc2Range(const core::GlobalState &gs, core::Loc loc) {
     return make_unique<Range>(move(start), move(end));
 }
 
-unique_ptr<Location> LSPLoop::loc2Location(const core::GlobalState &gs, core::Loc loc) {
+unique_ptr<Location> LSPLoop::loc2Location(const core::GlobalState &gs, const LSPClientSettings &client,
+                                            core::Loc loc) const {
     string uri;
     if (!loc.file().exists()) {
-        uri = localName2Remote("???");
+        uri = localName2Remote(client, "???");
     } else {
         auto &messageFile = loc.file().data(gs);
         if (messageFile.sourceType == core::File::Type::Payload) {
@@ -87,7 +89,7 @@ unique_ptr<Location> LSPLoop::loc2Location(const core::GlobalState &gs, core::Lo
             // https://git.corp.stripe.com/stripe-internal/ruby-typer/tree/master/rbi/core/string.rbi#L18
             uri = fmt::format("{}#L{}", messageFile.path(), loc.position(gs).first.line);
         } else {
-            uri = fileRef2Uri(gs, loc.file());
+            uri = fileRef2Uri(gs, client, loc.file());
         }
     }
     return make_unique<Location>(uri, loc2Range(gs, loc));
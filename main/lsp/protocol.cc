@@ -1,3 +1,6 @@
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "common/FileOps.h"
@@ -12,68 +15,193 @@ using namespace std;
 
 namespace sorbet::realmain::lsp {
 
+/**
+ * Bytes read from the client that have not been consumed yet. Messages are consumed from the front, and reads append at
+ * the back. Instead of wrapping around, the unconsumed tail slides back to the front when a read needs room, so a
+ * message body is always contiguous and can be parsed in place. Only a partially read message is ever moved.
+ */
+class LSPInputBuffer final {
+    static constexpr size_t MIN_READ_SIZE = 64 * 1024;
+    vector<char> data;
+    size_t begin = 0;
+    size_t end = 0;
+
+public:
+    LSPInputBuffer() : data(MIN_READ_SIZE) {}
+
+    string_view contents() const {
+        return string_view(data.data() + begin, end - begin);
+    }
+
+    /** Pointer to the unconsumed byte at `offset`. There is always room to write one byte past the end of `contents`. */
+    char *at(size_t offset) {
+        ENFORCE(begin + offset <= end);
+        return data.data() + begin + offset;
+    }
+
+    /**
+     * Reads whatever is available from `fd`, making room for at least `wanted` bytes first. Returns the number of bytes
+     * read, or 0 on timeout. Invalidates pointers returned by `at`.
+     *
+     * Throws FileReadException on EOF or error.
+     */
+    int readFrom(int fd, size_t wanted) {
+        // + 1 to keep a spare byte past the end; see `at`.
+        const size_t needed = max(wanted, MIN_READ_SIZE) + 1;
+        if (data.size() - end < needed) {
+            copy(data.begin() + begin, data.begin() + end, data.begin());
+            end -= begin;
+            begin = 0;
+            if (data.size() - end < needed) {
+                data.resize(max(data.size() * 2, end + needed));
+            }
+        }
+        int read = FileOps::readFd(fd, data.data() + end, data.size() - end - 1);
+        end += read;
+        return read;
+    }
+
+    void consume(size_t length) {
+        ENFORCE(begin + length <= end);
+        begin += length;
+        if (begin == end) {
+            begin = end = 0;
+        }
+    }
+};
+
+/** Headers are a couple of short lines; anything longer than this without a blank line is not an LSP header. */
+constexpr size_t MAX_HEADER_SIZE = 4 * 1024;
+
+/** Returns the value of the Content-Length header, or -1 if there is none. */
+int parseContentLength(string_view header) {
+    constexpr string_view CONTENT_LENGTH = "Content-Length:";
+    for (auto line : absl::StrSplit(header, "\r\n")) {
+        int length;
+        if (absl::StartsWith(line, CONTENT_LENGTH) &&
+            absl::SimpleAtoi(line.substr(CONTENT_LENGTH.size()), &length) && length >= 0) {
+            return length;
+        }
+    }
+    return -1;
+}
+
+void recordDecodeThroughput(size_t length, chrono::time_point<chrono::steady_clock> start) {
+    auto nanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    double bytesPerSec = length * 1'000'000'000.0 / max<decltype(nanos)>(nanos, 1);
+    // Power-of-two buckets, so that the histogram stays small.
+    int bucket = 1;
+    while (bucket < (1 << 30) && bucket * 2 <= bytesPerSec) {
+        bucket *= 2;
+    }
+    prodHistogramInc("lsp.input.decode_bytes_per_sec", bucket);
+}
+
 /**
  * Attempts to read an LSP message from the file descriptor. Returns a nullptr if it fails.
  *
- * Extra bits read are stored into `buffer`.
+ * Extra bits read are kept in `buffer`. The message is decoded straight out of `buffer`, without copying its body.
  *
  * Throws an exception on read error or EOF.
  */
-unique_ptr<LSPMessage> getNewRequest(const shared_ptr<spd::logger> &logger, int inputFd, string &buffer) {
-    int length = -1;
-    string allRead;
-    {
-        // Break and return if a timeout occurs. Bound loop to prevent infinite looping here. There's typically only two
-        // lines in a header.
-        for (int i = 0; i < 10; i += 1) {
-            auto maybeLine = FileOps::readLineFromFd(inputFd, buffer);
-            if (!maybeLine) {
-                // Line not read. Abort. Store what was read thus far back into buffer
-                // for use in next call to function.
-                buffer = absl::StrCat(allRead, buffer);
-                return nullptr;
-            }
-            const string &line = *maybeLine;
-            absl::StrAppend(&allRead, line, "\n");
-            if (line == "\r") {
-                // End of headers.
-                break;
-            }
-            sscanf(line.c_str(), "Content-Length: %i\r", &length);
+unique_ptr<LSPMessage> getNewRequest(const shared_ptr<spd::logger> &logger, int inputFd, LSPInputBuffer &buffer) {
+    size_t headerEnd;
+    while ((headerEnd = buffer.contents().find("\r\n\r\n")) == string_view::npos) {
+        if (buffer.contents().size() > MAX_HEADER_SIZE) {
+            logger->trace("No end of header found in: {}", buffer.contents());
+            // Throw away what we've read and start over. Keep enough to match a header end split across reads.
+            buffer.consume(buffer.contents().size() - 3);
+            return nullptr;
+        }
+        if (buffer.readFrom(inputFd, 0) == 0) {
+            // Timeout. Whatever was read stays in `buffer` for the next call.
+            return nullptr;
         }
-        logger->trace("final raw read: {}, length: {}", allRead, length);
     }
 
+    const size_t bodyStart = headerEnd + 4;
+    int length = parseContentLength(buffer.contents().substr(0, headerEnd));
+    logger->trace("final raw read: {}, length: {}", buffer.contents().substr(0, bodyStart), length);
     if (length < 0) {
         logger->trace("No \"Content-Length: %i\" header found.");
         // Throw away what we've read and start over.
+        buffer.consume(bodyStart);
         return nullptr;
     }
 
-    if (buffer.length() < length) {
-        // Need to read more.
-        int moreNeeded = length - buffer.length();
-        vector<char> buf(moreNeeded);
-        int result = FileOps::readFd(inputFd, buf);
-        if (result > 0) {
-            buffer.append(buf.begin(), buf.begin() + result);
-        }
-        if (result == -1) {
-            Exception::raise("Error reading file or EOF.");
-        }
-        if (result != moreNeeded) {
-            // Didn't get enough data. Return read data to `buffer`.
-            buffer = absl::StrCat(allRead, buffer);
+    const size_t messageEnd = bodyStart + length;
+    while (buffer.contents().size() < messageEnd) {
+        if (buffer.readFrom(inputFd, messageEnd - buffer.contents().size()) == 0) {
+            // Didn't get enough data. Keep what was read for the next call.
             return nullptr;
         }
     }
 
-    ENFORCE(buffer.length() >= length);
+    prodCounterAdd("lsp.input.bytes", messageEnd);
+    auto decodeStart = chrono::steady_clock::now();
+    char *json = buffer.at(bodyStart);
+    logger->debug("Read: {}\n", string_view(json, length));
+    // The byte after the body may belong to the next message, so only terminate the body while parsing it.
+    const char next = json[length];
+    json[length] = '\0';
+    auto msg = LSPMessage::fromClientInsitu(json, length);
+    json[length] = next;
+    buffer.consume(messageEnd);
+    recordDecodeThroughput(length, decodeStart);
+    return msg;
+}
+
+bool isFileUpdate(const LSPMethod method) {
+    switch (method) {
+        case LSPMethod::TextDocumentDidOpen:
+        case LSPMethod::TextDocumentDidChange:
+        case LSPMethod::TextDocumentDidClose:
+        case LSPMethod::SorbetWatchmanFileChange:
+        case LSPMethod::SorbetWorkspaceEdit:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Read-only queries that only look at the file they point into, which makes them safe to answer from a snapshot. */
+bool canAnswerFromSnapshot(const LSPMessage &msg) {
+    if (!msg.isRequest()) {
+        return false;
+    }
+    switch (msg.method()) {
+        case LSPMethod::TextDocumentHover:
+        case LSPMethod::TextDocumentDefinition:
+        case LSPMethod::TextDocumentCompletion:
+        case LSPMethod::TextDocumentSignatureHelp:
+            return true;
+        default:
+            return false;
+    }
+}
 
-    string json = buffer.substr(0, length);
-    buffer.erase(0, length);
-    logger->debug("Read: {}\n", json);
-    return LSPMessage::fromClient(json);
+/** The URI of the file that a query accepted by `canAnswerFromSnapshot` points into. */
+string_view snapshotQueryUri(const LSPMessage &msg) {
+    auto &params = msg.asRequest().params;
+    if (msg.method() == LSPMethod::TextDocumentCompletion) {
+        return get<unique_ptr<CompletionParams>>(params)->textDocument->uri;
+    }
+    return get<unique_ptr<TextDocumentPositionParams>>(params)->textDocument->uri;
+}
+
+int LSPLoop::findSnapshotQuery(const QueueState &state) {
+    int i = 0;
+    for (auto &msg : state.pendingRequests) {
+        if (canAnswerFromSnapshot(*msg) &&
+            state.changedSinceSnapshot.find(snapshotQueryUri(*msg)) == state.changedSinceSnapshot.end()) {
+            return i;
+        }
+        if (isFileUpdate(msg->method())) {
+            break;
+        }
+        i++;
+    }
+    return -1;
 }
 
 class NotifyOnDestruction {
@@ -103,6 +231,7 @@ public:
 unique_ptr<core::GlobalState> LSPLoop::runLSP() {
     // Naming convention: thread that executes this function is called coordinator thread
     LSPLoop::QueueState guardedState{{}, false, false, 0};
+    guardedState.typecheckCanceled = initialGS->typecheckCanceled;
     absl::Mutex mtx;
     absl::Notification initializedNotification;
 
@@ -146,7 +275,7 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
             // Thread that executes this lambda is called reader thread.
             // This thread _intentionally_ does not capture `this`.
             NotifyOnDestruction notify(mtx, guardedState.terminate);
-            string buffer;
+            LSPInputBuffer buffer;
             try {
                 auto timeit = make_unique<Timer>(logger, "getNewRequest");
                 while (true) {
@@ -170,6 +299,59 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
             }
         });
 
+    queueState = &guardedState;
+    queueMutex = &mtx;
+    auto snapshotQueryThread = runInAThread("lspSnapshot", [&guardedState, &mtx, this] {
+        // Thread that executes this lambda is called snapshot query thread. While the main thread is stuck in a slow
+        // path, it answers read-only queries from the snapshot of the last completed typecheck.
+        while (true) {
+            unique_ptr<LSPMessage> msg;
+            shared_ptr<const core::GlobalState> snapshot;
+            // Not `this->clientSettings`, which the main thread owns.
+            LSPClientSettings client;
+            {
+                absl::MutexLock lck(&mtx);
+                mtx.Await(absl::Condition(
+                    +[](LSPLoop::QueueState *guardedState) -> bool {
+                        return guardedState->terminate ||
+                               (!guardedState->paused && guardedState->slowPathRunning && guardedState->snapshot &&
+                                findSnapshotQuery(*guardedState) != -1);
+                    },
+                    &guardedState));
+                if (guardedState.terminate) {
+                    // The main thread answers whatever is left in the queue.
+                    break;
+                }
+                auto it = guardedState.pendingRequests.begin() + findSnapshotQuery(guardedState);
+                msg = move(*it);
+                guardedState.pendingRequests.erase(it);
+                snapshot = guardedState.snapshot;
+                client = guardedState.snapshotClientSettings;
+            }
+            prodCounterInc("lsp.messages.received");
+            prodCounterInc("lsp.messages.served_from_snapshot");
+            logger->debug("Answering {} from snapshot", convertLSPMethodToString(msg->method()));
+            // Queries write to the GlobalState they run on, so they run on a private copy with a private error queue.
+            auto gs = snapshot->deepCopy(true);
+            auto snapshotErrorQueue = make_shared<core::ErrorQueue>(*logger, *logger);
+            snapshotErrorQueue->ignoreFlushes = true;
+            gs->errorQueue = move(snapshotErrorQueue);
+            auto result = processSnapshotQuery(move(gs), client, *msg);
+            for (auto &response : result.responses) {
+                sendMessage(*response);
+            }
+            {
+                absl::MutexLock lck(&mtx);
+                if (!guardedState.counters.hasNullCounters()) {
+                    counterConsume(move(guardedState.counters));
+                }
+                guardedState.counters = getAndClearThreadCounters();
+            }
+        }
+    });
+    // Make sure that the snapshot query thread exits even if the main thread throws.
+    NotifyOnDestruction stopSnapshotQueryThread(mtx, guardedState.terminate);
+
     mainThreadId = this_thread::get_id();
     unique_ptr<core::GlobalState> gs;
     {
@@ -198,6 +380,8 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
                 }
                 msg = move(guardedState.pendingRequests.front());
                 guardedState.pendingRequests.pop_front();
+                // File updates that arrive from now on are newer than `msg`.
+                guardedState.typecheckCanceled->store(false);
             }
             prodCounterInc("lsp.messages.received");
             auto result = processRequest(move(gs), *msg);
@@ -224,6 +408,8 @@ unique_ptr<core::GlobalState> LSPLoop::runLSP() {
         }
     }
 
+    queueState = nullptr;
+    queueMutex = nullptr;
     if (gs) {
         return gs;
     } else {
@@ -405,6 +591,11 @@ void LSPLoop::enqueueRequest(const shared_ptr<spd::logger> &logger, LSPLoop::Que
         }
         state.pendingRequests.push_back(move(msg));
     } else {
+        if (state.typecheckCanceled && isFileUpdate(method)) {
+            // The slow path that is running right now (if any) is stale. The main thread resets this flag whenever it
+            // picks up a new message.
+            state.typecheckCanceled->store(true);
+        }
         state.pendingRequests.push_back(move(msg));
         mergeFileChanges(state.pendingRequests);
     }
@@ -436,7 +627,8 @@ bool isServerNotification(const LSPMethod method) {
     }
 }
 
-unique_ptr<core::Loc> LSPLoop::lspPos2Loc(core::FileRef fref, const Position &pos, const core::GlobalState &gs) {
+unique_ptr<core::Loc> LSPLoop::lspPos2Loc(core::FileRef fref, const Position &pos,
+                                          const core::GlobalState &gs) const {
     core::Loc::Detail reqPos;
     reqPos.line = pos.line + 1;
     reqPos.column = pos.character + 1;
@@ -454,6 +646,7 @@ void LSPLoop::sendMessage(const LSPMessage &msg) {
     auto json = msg.toJSON();
     string outResult = fmt::format("Content-Length: {}\r\n\r\n{}", json.length(), json);
     logger->debug("Write: {}\n", json);
+    absl::MutexLock lck(&outputMutex);
     outputStream << outResult << flush;
 }
 
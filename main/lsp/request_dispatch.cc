@@ -95,6 +95,7 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
             if (!disableFastPath) {
                 this->globalStateHashes = computeStateHashes(result.gs->getFiles());
             }
+            commitKvstore();
             initialized = true;
             return result;
         }
@@ -130,16 +131,16 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
             prodCategoryCounterInc("lsp.messages.processed", "initialize");
             auto &params = get<unique_ptr<InitializeParams>>(rawParams);
             if (auto rootUriString = get_if<string>(&params->rootUri)) {
-                rootUri = *rootUriString;
+                clientSettings.rootUri = *rootUriString;
             }
-            clientCompletionItemSnippetSupport = false;
-            clientHoverMarkupKind = MarkupKind::Plaintext;
+            clientSettings.completionItemSnippetSupport = false;
+            clientSettings.hoverMarkupKind = MarkupKind::Plaintext;
             if (params->capabilities->textDocument) {
                 auto &textDocument = *params->capabilities->textDocument;
                 if (textDocument->completion) {
                     auto &completion = *textDocument->completion;
                     if (completion->completionItem) {
-                        clientCompletionItemSnippetSupport =
+                        clientSettings.completionItemSnippetSupport =
                             (*completion->completionItem)->snippetSupport.value_or(false);
                     }
                 }
@@ -147,10 +148,10 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
                     auto &hover = *textDocument->hover;
                     if (hover->contentFormat) {
                         auto &contentFormat = *hover->contentFormat;
-                        clientHoverMarkupKind = find(contentFormat.begin(), contentFormat.end(),
-                                                     MarkupKind::Markdown) != contentFormat.end()
-                                                    ? MarkupKind::Markdown
-                                                    : MarkupKind::Plaintext;
+                        clientSettings.hoverMarkupKind = find(contentFormat.begin(), contentFormat.end(),
+                                                              MarkupKind::Markdown) != contentFormat.end()
+                                                             ? MarkupKind::Markdown
+                                                             : MarkupKind::Plaintext;
                     }
                 }
             }
@@ -191,16 +192,16 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
             return handleWorkspaceSymbols(move(gs), id, *params);
         } else if (method == LSPMethod::TextDocumentDefinition) {
             auto &params = get<unique_ptr<TextDocumentPositionParams>>(rawParams);
-            return handleTextDocumentDefinition(move(gs), id, *params);
+            return handleTextDocumentDefinition(move(gs), mainThreadQueryContext(), id, *params);
         } else if (method == LSPMethod::TextDocumentHover) {
             auto &params = get<unique_ptr<TextDocumentPositionParams>>(rawParams);
-            return handleTextDocumentHover(move(gs), id, *params);
+            return handleTextDocumentHover(move(gs), mainThreadQueryContext(), id, *params);
         } else if (method == LSPMethod::TextDocumentCompletion) {
             auto &params = get<unique_ptr<CompletionParams>>(rawParams);
-            return handleTextDocumentCompletion(move(gs), id, *params);
+            return handleTextDocumentCompletion(move(gs), mainThreadQueryContext(), id, *params);
         } else if (method == LSPMethod::TextDocumentSignatureHelp) {
             auto &params = get<unique_ptr<TextDocumentPositionParams>>(rawParams);
-            return handleTextSignatureHelp(move(gs), id, *params);
+            return handleTextSignatureHelp(move(gs), mainThreadQueryContext(), id, *params);
         } else if (method == LSPMethod::TextDocumentReferences) {
             auto &params = get<unique_ptr<ReferenceParams>>(rawParams);
             return handleTextDocumentReferences(move(gs), id, *params);
@@ -224,4 +225,42 @@ LSPResult LSPLoop::processRequestInternal(unique_ptr<core::GlobalState> gs, cons
     }
     return LSPResult{move(gs), {}};
 }
+
+LSPResult LSPLoop::processSnapshotQuery(unique_ptr<core::GlobalState> gs, const LSPClientSettings &client,
+                                        const LSPMessage &msg) const {
+    Timer timeit(logger, "process_snapshot_query");
+    // Snapshots are only published once the server is initialized, so there is nothing to check here.
+    const LSPMethod method = msg.method();
+    auto &requestMessage = msg.asRequest();
+    ENFORCE(msg.id());
+    auto id = *msg.id();
+    if (msg.canceled) {
+        prodCounterInc("lsp.messages.canceled");
+        auto response = make_unique<ResponseMessage>("2.0", id, method);
+        response->error = make_unique<ResponseError>((int)LSPErrorCodes::RequestCancelled, "Request was canceled");
+        return LSPResult::make(move(gs), move(response));
+    }
+
+    QueryContext query{client, true,
+                       [this](unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
+                              vector<shared_ptr<core::File>> &changedFiles) {
+                           return runQueryOnSnapshot(move(gs), q, changedFiles);
+                       }};
+    auto &rawParams = requestMessage.params;
+    switch (method) {
+        case LSPMethod::TextDocumentDefinition:
+            return handleTextDocumentDefinition(move(gs), query, id,
+                                                *get<unique_ptr<TextDocumentPositionParams>>(rawParams));
+        case LSPMethod::TextDocumentHover:
+            return handleTextDocumentHover(move(gs), query, id,
+                                           *get<unique_ptr<TextDocumentPositionParams>>(rawParams));
+        case LSPMethod::TextDocumentCompletion:
+            return handleTextDocumentCompletion(move(gs), query, id, *get<unique_ptr<CompletionParams>>(rawParams));
+        case LSPMethod::TextDocumentSignatureHelp:
+            return handleTextSignatureHelp(move(gs), query, id,
+                                           *get<unique_ptr<TextDocumentPositionParams>>(rawParams));
+        default:
+            Exception::raise("{} can't be answered from a snapshot", convertLSPMethodToString(method));
+    }
+}
 } // namespace sorbet::realmain::lsp
@@ -124,9 +124,9 @@ optional<string> findDocumentation(string_view sourceCode, int beginIndex) {
     return documentation;
 }
 
-unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &gs, core::SymbolRef what,
-                                                      core::TypePtr receiverType,
-                                                      const shared_ptr<core::TypeConstraint> &constraint) {
+unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &gs, const LSPClientSettings &client,
+                                                      core::SymbolRef what, core::TypePtr receiverType,
+                                                      const shared_ptr<core::TypeConstraint> &constraint) const {
     ENFORCE(what.exists());
     auto item = make_unique<CompletionItem>(string(what.data(gs)->name.data(gs)->shortName(gs)));
     auto resultType = what.data(gs)->resultType;
@@ -138,7 +138,7 @@ unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &g
         if (what.exists()) {
             item->detail = methodDetail(gs, what, receiverType, nullptr, constraint);
         }
-        if (clientCompletionItemSnippetSupport) {
+        if (client.completionItemSnippetSupport) {
             item->insertTextFormat = InsertTextFormat::Snippet;
             item->insertText = methodSnippet(gs, what);
         } else {
@@ -166,8 +166,9 @@ unique_ptr<CompletionItem> LSPLoop::getCompletionItem(const core::GlobalState &g
     return item;
 }
 
-void LSPLoop::findSimilarConstantOrIdent(const core::GlobalState &gs, const core::TypePtr receiverType,
-                                         vector<unique_ptr<CompletionItem>> &items) {
+void LSPLoop::findSimilarConstantOrIdent(const core::GlobalState &gs, const LSPClientSettings &client,
+                                         const core::TypePtr receiverType,
+                                         vector<unique_ptr<CompletionItem>> &items) const {
     if (auto c = core::cast_type<core::ClassType>(receiverType.get())) {
         auto pattern = c->symbol.data(gs)->name.data(gs)->shortName(gs);
         logger->debug("Looking for constant similar to {}", pattern);
@@ -180,15 +181,15 @@ void LSPLoop::findSimilarConstantOrIdent(const core::GlobalState &gs, const core
                     sym.data(gs)->name.data(gs)->kind == core::NameKind::CONSTANT &&
                     // hide singletons
                     hasSimilarName(gs, sym.data(gs)->name, pattern)) {
-                    items.push_back(getCompletionItem(gs, sym, receiverType, nullptr));
+                    items.push_back(getCompletionItem(gs, client, sym, receiverType, nullptr));
                 }
             }
         } while (owner != core::Symbols::root());
     }
 }
 
-LSPResult LSPLoop::handleTextDocumentCompletion(unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                                const CompletionParams &params) {
+LSPResult LSPLoop::handleTextDocumentCompletion(unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                                const MessageId &id, const CompletionParams &params) const {
     auto response = make_unique<ResponseMessage>("2.0", id, LSPMethod::TextDocumentCompletion);
     if (!opts.lspAutocompleteEnabled) {
         response->error =
@@ -199,7 +200,7 @@ LSPResult LSPLoop::handleTextDocumentCompletion(unique_ptr<core::GlobalState> gs
 
     prodCategoryCounterInc("lsp.messages.processed", "textDocument.completion");
 
-    auto result = setupLSPQueryByLoc(move(gs), params.textDocument->uri, *params.position,
+    auto result = setupLSPQueryByLoc(move(gs), query, params.textDocument->uri, *params.position,
                                      LSPMethod::TextDocumentCompletion, false);
 
     if (auto run = get_if<TypecheckRun>(&result)) {
@@ -229,17 +230,18 @@ LSPResult LSPLoop::handleTextDocumentCompletion(unique_ptr<core::GlobalState> gs
                 for (auto &entry : methodsSorted) {
                     if (entry.second[0].exists()) {
                         fast_sort(entry.second, [&](auto lhs, auto rhs) -> bool { return lhs._id < rhs._id; });
-                        items.push_back(
-                            getCompletionItem(*gs, entry.second[0], sendResp->receiver.type, sendResp->constraint));
+                        items.push_back(getCompletionItem(*gs, query.client, entry.second[0],
+                                                          sendResp->receiver.type, sendResp->constraint));
                     }
                 }
             } else if (auto identResp = resp->isIdent()) {
-                findSimilarConstantOrIdent(*gs, identResp->retType.type, items);
+                findSimilarConstantOrIdent(*gs, query.client, identResp->retType.type, items);
             } else if (auto constantResp = resp->isConstant()) {
-                findSimilarConstantOrIdent(*gs, constantResp->retType.type, items);
+                findSimilarConstantOrIdent(*gs, query.client, constantResp->retType.type, items);
             }
         }
-        response->result = make_unique<CompletionList>(false, move(items));
+        // Results from a snapshot may miss recent edits, so ask the client to query again as the user keeps typing.
+        response->result = make_unique<CompletionList>(query.fromSnapshot, move(items));
     } else if (auto error = get_if<pair<unique_ptr<ResponseError>, unique_ptr<core::GlobalState>>>(&result)) {
         // An error happened while setting up the query.
         response->error = move(error->first);
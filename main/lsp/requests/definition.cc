@@ -4,14 +4,15 @@
 using namespace std;
 
 namespace sorbet::realmain::lsp {
-void LSPLoop::addLocIfExists(const core::GlobalState &gs, vector<unique_ptr<Location>> &locs, core::Loc loc) {
+void LSPLoop::addLocIfExists(const core::GlobalState &gs, const LSPClientSettings &client,
+                             vector<unique_ptr<Location>> &locs, core::Loc loc) const {
     if (loc.file().exists()) {
-        locs.push_back(loc2Location(gs, loc));
+        locs.push_back(loc2Location(gs, client, loc));
     }
 }
 
-LSPResult LSPLoop::handleTextDocumentDefinition(unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                                const TextDocumentPositionParams &params) {
+LSPResult LSPLoop::handleTextDocumentDefinition(unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                                const MessageId &id, const TextDocumentPositionParams &params) const {
     auto response = make_unique<ResponseMessage>("2.0", id, LSPMethod::TextDocumentDefinition);
     if (!opts.lspGoToDefinitionEnabled) {
         response->error =
@@ -21,7 +22,7 @@ LSPResult LSPLoop::handleTextDocumentDefinition(unique_ptr<core::GlobalState> gs
     }
 
     prodCategoryCounterInc("lsp.messages.processed", "textDocument.definition");
-    auto result = setupLSPQueryByLoc(move(gs), params.textDocument->uri, *params.position,
+    auto result = setupLSPQueryByLoc(move(gs), query, params.textDocument->uri, *params.position,
                                      LSPMethod::TextDocumentDefinition, true);
     if (auto run = get_if<TypecheckRun>(&result)) {
         gs = move(run->gs);
@@ -32,14 +33,14 @@ LSPResult LSPLoop::handleTextDocumentDefinition(unique_ptr<core::GlobalState> gs
 
             if (auto identResp = resp->isIdent()) {
                 for (auto &originLoc : identResp->retType.origins) {
-                    addLocIfExists(*gs, result, originLoc);
+                    addLocIfExists(*gs, query.client, result, originLoc);
                 }
             } else if (auto defResp = resp->isDefinition()) {
-                result.push_back(loc2Location(*gs, defResp->termLoc));
+                result.push_back(loc2Location(*gs, query.client, defResp->termLoc));
             } else {
                 for (auto &component : resp->getDispatchComponents()) {
                     if (component.method.exists() && !component.receiver->isUntyped()) {
-                        addLocIfExists(*gs, result, component.method.data(*gs)->loc());
+                        addLocIfExists(*gs, query.client, result, component.method.data(*gs)->loc());
                     }
                 }
             }
@@ -77,7 +77,7 @@ LSPResult LSPLoop::handleTextDocumentDocumentSymbol(unique_ptr<core::GlobalState
     prodCategoryCounterInc("lsp.messages.processed", "textDocument.documentSymbol");
     vector<unique_ptr<DocumentSymbol>> result;
     string_view uri = params.textDocument->uri;
-    auto fref = uri2FileRef(uri);
+    auto fref = uri2FileRef(*gs, clientSettings, uri);
     for (u4 idx = 1; idx < gs->symbolsUsed(); idx++) {
         core::SymbolRef ref(gs.get(), idx);
         if (!hideSymbol(*gs, ref) &&
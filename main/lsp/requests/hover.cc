@@ -27,8 +27,8 @@ unique_ptr<MarkupContent> formatRubyCode(MarkupKind markupKind, string str) {
     return make_unique<MarkupContent>(markupKind, move(str));
 }
 
-LSPResult LSPLoop::handleTextDocumentHover(unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                           const TextDocumentPositionParams &params) {
+LSPResult LSPLoop::handleTextDocumentHover(unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                           const MessageId &id, const TextDocumentPositionParams &params) const {
     auto response = make_unique<ResponseMessage>("2.0", id, LSPMethod::TextDocumentHover);
     if (!opts.lspHoverEnabled) {
         response->error = make_unique<ResponseError>(
@@ -38,8 +38,8 @@ LSPResult LSPLoop::handleTextDocumentHover(unique_ptr<core::GlobalState> gs, con
 
     prodCategoryCounterInc("lsp.messages.processed", "textDocument.hover");
 
-    auto result =
-        setupLSPQueryByLoc(move(gs), params.textDocument->uri, *params.position, LSPMethod::TextDocumentHover, false);
+    auto result = setupLSPQueryByLoc(move(gs), query, params.textDocument->uri, *params.position,
+                                     LSPMethod::TextDocumentHover, false);
     if (auto run = get_if<TypecheckRun>(&result)) {
         gs = move(run->gs);
         auto &queryResponses = run->responses;
@@ -62,15 +62,16 @@ LSPResult LSPLoop::handleTextDocumentHover(unique_ptr<core::GlobalState> gs, con
             if (constraint) {
                 retType = core::Types::instantiate(core::Context(*gs, core::Symbols::root()), retType, *constraint);
             }
-            response->result = make_unique<Hover>(formatRubyCode(
-                clientHoverMarkupKind, methodSignatureString(*gs, retType, sendResp->dispatchComponents, constraint)));
-        } else if (auto defResp = resp->isDefinition()) {
             response->result = make_unique<Hover>(
-                formatRubyCode(clientHoverMarkupKind, methodSignatureString(*gs, defResp->retType.type,
-                                                                            defResp->dispatchComponents, nullptr)));
+                formatRubyCode(query.client.hoverMarkupKind,
+                               methodSignatureString(*gs, retType, sendResp->dispatchComponents, constraint)));
+        } else if (auto defResp = resp->isDefinition()) {
+            response->result = make_unique<Hover>(formatRubyCode(
+                query.client.hoverMarkupKind,
+                methodSignatureString(*gs, defResp->retType.type, defResp->dispatchComponents, nullptr)));
         } else {
-            response->result =
-                make_unique<Hover>(formatRubyCode(clientHoverMarkupKind, resp->getRetType()->showWithMoreInfo(*gs)));
+            response->result = make_unique<Hover>(
+                formatRubyCode(query.client.hoverMarkupKind, resp->getRetType()->showWithMoreInfo(*gs)));
         }
     } else if (auto error = get_if<pair<unique_ptr<ResponseError>, unique_ptr<core::GlobalState>>>(&result)) {
         // An error happened while setting up the query.
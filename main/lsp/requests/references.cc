@@ -19,7 +19,7 @@ LSPResult LSPLoop::handleTextDocumentReferences(unique_ptr<core::GlobalState> gs
     ShowOperation op(*this, "References", "Finding all references...");
     prodCategoryCounterInc("lsp.messages.processed", "textDocument.references");
 
-    auto result = setupLSPQueryByLoc(move(gs), params.textDocument->uri, *params.position,
+    auto result = setupLSPQueryByLoc(move(gs), mainThreadQueryContext(), params.textDocument->uri, *params.position,
                                      LSPMethod::TextDocumentCompletion, false);
     if (auto run1 = get_if<TypecheckRun>(&result)) {
         gs = move(run1->gs);
@@ -35,7 +35,7 @@ LSPResult LSPLoop::handleTextDocumentReferences(unique_ptr<core::GlobalState> gs
                     vector<unique_ptr<Location>> result;
                     auto &queryResponses = run2.responses;
                     for (auto &q : queryResponses) {
-                        result.push_back(loc2Location(*gs, q->getLoc()));
+                        result.push_back(loc2Location(*gs, clientSettings, q->getLoc()));
                     }
                     response->result = move(result);
                 }
@@ -47,7 +47,7 @@ LSPResult LSPLoop::handleTextDocumentReferences(unique_ptr<core::GlobalState> gs
                 vector<unique_ptr<Location>> result;
                 auto &queryResponses = run2.responses;
                 for (auto &q : queryResponses) {
-                    result.push_back(loc2Location(*gs, q->getLoc()));
+                    result.push_back(loc2Location(*gs, clientSettings, q->getLoc()));
                 }
                 response->result = move(result);
             }
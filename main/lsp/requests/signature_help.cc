@@ -45,8 +45,8 @@ void addSignatureHelpItem(const core::GlobalState &gs, core::SymbolRef method,
     sigs.push_back(move(sig));
 }
 
-LSPResult LSPLoop::handleTextSignatureHelp(unique_ptr<core::GlobalState> gs, const MessageId &id,
-                                           const TextDocumentPositionParams &params) {
+LSPResult LSPLoop::handleTextSignatureHelp(unique_ptr<core::GlobalState> gs, const QueryContext &query,
+                                           const MessageId &id, const TextDocumentPositionParams &params) const {
     auto response = make_unique<ResponseMessage>("2.0", id, LSPMethod::TextDocumentSignatureHelp);
     if (!opts.lspSignatureHelpEnabled) {
         response->error =
@@ -56,7 +56,7 @@ LSPResult LSPLoop::handleTextSignatureHelp(unique_ptr<core::GlobalState> gs, con
     }
 
     prodCategoryCounterInc("lsp.messages.processed", "textDocument.signatureHelp");
-    auto result = setupLSPQueryByLoc(move(gs), params.textDocument->uri, *params.position,
+    auto result = setupLSPQueryByLoc(move(gs), query, params.textDocument->uri, *params.position,
                                      LSPMethod::TextDocumentSignatureHelp, false);
     if (auto run = get_if<TypecheckRun>(&result)) {
         gs = move(run->gs);
@@ -69,7 +69,7 @@ LSPResult LSPLoop::handleTextSignatureHelp(unique_ptr<core::GlobalState> gs, con
             if (auto sendResp = resp->isSend()) {
                 auto sendLocIndex = sendResp->termLoc.beginPos();
 
-                auto fref = uri2FileRef(params.textDocument->uri);
+                auto fref = uri2FileRef(*gs, query.client, params.textDocument->uri);
                 if (!fref.exists()) {
                     // TODO(jvilk): This should probably return *something*; it's a request!
                     return LSPResult{move(gs), {}};
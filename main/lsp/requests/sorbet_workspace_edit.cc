@@ -36,8 +36,8 @@ string getFileContents(UnorderedMap<string, string> &updates, unique_ptr<core::G
 void LSPLoop::preprocessSorbetWorkspaceEdit(const DidChangeTextDocumentParams &changeParams,
                                             UnorderedMap<string, string> &updates) {
     string_view uri = changeParams.textDocument->uri;
-    if (absl::StartsWith(uri, rootUri)) {
-        string localPath = remoteName2Local(uri);
+    if (absl::StartsWith(uri, clientSettings.rootUri)) {
+        string localPath = remoteName2Local(clientSettings, uri);
         if (FileOps::isFileIgnored(rootPath, localPath, opts.absoluteIgnorePatterns, opts.relativeIgnorePatterns)) {
             return;
         }
@@ -67,8 +67,8 @@ void LSPLoop::preprocessSorbetWorkspaceEdit(const DidChangeTextDocumentParams &c
 void LSPLoop::preprocessSorbetWorkspaceEdit(const DidOpenTextDocumentParams &openParams,
                                             UnorderedMap<string, string> &updates) {
     string_view uri = openParams.textDocument->uri;
-    if (absl::StartsWith(uri, rootUri)) {
-        string localPath = remoteName2Local(uri);
+    if (absl::StartsWith(uri, clientSettings.rootUri)) {
+        string localPath = remoteName2Local(clientSettings, uri);
         if (!FileOps::isFileIgnored(rootPath, localPath, opts.absoluteIgnorePatterns, opts.relativeIgnorePatterns)) {
             openFiles.insert(localPath);
             updates[localPath] = move(openParams.textDocument->text);
@@ -79,8 +79,8 @@ void LSPLoop::preprocessSorbetWorkspaceEdit(const DidOpenTextDocumentParams &ope
 void LSPLoop::preprocessSorbetWorkspaceEdit(const DidCloseTextDocumentParams &closeParams,
                                             UnorderedMap<string, string> &updates) {
     string_view uri = closeParams.textDocument->uri;
-    if (absl::StartsWith(uri, rootUri)) {
-        string localPath = remoteName2Local(uri);
+    if (absl::StartsWith(uri, clientSettings.rootUri)) {
+        string localPath = remoteName2Local(clientSettings, uri);
         if (!FileOps::isFileIgnored(rootPath, localPath, opts.absoluteIgnorePatterns, opts.relativeIgnorePatterns)) {
             auto it = openFiles.find(localPath);
             if (it != openFiles.end()) {
@@ -105,13 +105,15 @@ void LSPLoop::preprocessSorbetWorkspaceEdit(const WatchmanQueryResponse &queryRe
 
 LSPResult LSPLoop::commitSorbetWorkspaceEdits(unique_ptr<core::GlobalState> gs, UnorderedMap<string, string> &updates) {
     if (!updates.empty()) {
+        invalidateSnapshotFiles(updates);
         vector<shared_ptr<core::File>> files;
         files.reserve(updates.size());
         for (auto &update : updates) {
             files.push_back(
                 make_shared<core::File>(string(update.first), move(update.second), core::File::Type::Normal));
         }
-        return pushDiagnostics(tryFastPath(move(gs), files));
+        // File updates can be preempted by newer file updates; see LSPLoop::enqueueRequest.
+        return pushDiagnostics(tryFastPath(move(gs), files, false, true));
     } else {
         return LSPResult{move(gs), {}};
     }
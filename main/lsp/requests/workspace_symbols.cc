@@ -13,7 +13,7 @@ unique_ptr<SymbolInformation> LSPLoop::symbolRef2SymbolInformation(const core::G
     }
 
     auto result = make_unique<SymbolInformation>(sym->name.show(gs), symbolRef2SymbolKind(gs, symRef),
-                                                 loc2Location(gs, sym->loc()));
+                                                 loc2Location(gs, clientSettings, sym->loc()));
     result->containerName = sym->owner.data(gs)->showFullName(gs);
     return result;
 }
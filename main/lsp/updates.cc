@@ -1,8 +1,12 @@
+#include "absl/strings/escaping.h" // BytesToHexString
+#include "ast/substitute/substitute.h"
 #include "ast/treemap/treemap.h"
 #include "common/Timer.h"
+#include "common/crypto_hashing/crypto_hashing.h"
 #include "core/Error.h"
 #include "core/Files.h"
 #include "core/GlobalState.h"
+#include "core/GlobalSubstitution.h"
 #include "core/Names.h"
 #include "core/Unfreeze.h"
 #include "core/errors/internal.h"
@@ -10,11 +14,13 @@
 #include "core/errors/parser.h"
 #include "core/errors/resolver.h"
 #include "core/lsp/QueryResponse.h"
+#include "core/serialize/serialize.h"
 #include "lsp.h"
 #include "main/lsp/DefLocSaver.h"
 #include "main/lsp/LocalVarSaver.h"
 #include "main/pipeline/pipeline.h"
 #include "namer/namer.h"
+#include "payload/payload.h"
 #include "resolver/resolver.h"
 #include <algorithm> // std::unique, std::distance
 
@@ -40,6 +46,20 @@ LSPLoop::ShowOperation::~ShowOperation() {
     }
 }
 
+LSPLoop::SlowPathInProgress::SlowPathInProgress(LSPLoop &loop) : loop(loop) {
+    if (loop.queueMutex != nullptr) {
+        absl::MutexLock lck(loop.queueMutex);
+        loop.queueState->slowPathRunning = true;
+    }
+}
+
+LSPLoop::SlowPathInProgress::~SlowPathInProgress() {
+    if (loop.queueMutex != nullptr) {
+        absl::MutexLock lck(loop.queueMutex);
+        loop.queueState->slowPathRunning = false;
+    }
+}
+
 core::FileRef LSPLoop::updateFile(const shared_ptr<core::File> &file) {
     Timer timeit(logger, "updateFile");
     core::FileRef fref;
@@ -63,21 +83,43 @@ core::FileRef LSPLoop::updateFile(const shared_ptr<core::File> &file) {
     return fref;
 }
 
+namespace {
+/**
+ * File hashes only depend on where their file is through whether it is an RBI, which changes how its contents are
+ * read. So they are cached by content and RBI-ness, just like trees are.
+ */
+string fileHashKey(const core::File &file) {
+    auto hashBytes = sorbet::crypto_hashing::hash64(file.source());
+    return absl::StrCat("FileHash//", absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)}),
+                        file.isRBI() ? "//rbi" : "");
+}
+} // namespace
+
 vector<core::FileHash> LSPLoop::computeStateHashes(const vector<shared_ptr<core::File>> &files) {
     Timer timeit(logger, "computeStateHashes");
     vector<core::FileHash> res(files.size());
-    shared_ptr<ConcurrentBoundedQueue<int>> fileq = make_shared<ConcurrentBoundedQueue<int>>(files.size());
+    vector<int> toCompute;
     for (int i = 0; i < files.size(); i++) {
-        auto copy = i;
-        fileq->push(move(copy), 1);
+        if (kvstore && files[i]) {
+            if (auto maybeCached = kvstore->read(fileHashKey(*files[i]))) {
+                prodCounterInc("lsp.statehash.kvstore.hit");
+                res[i] = core::serialize::Serializer::loadFileHash(maybeCached);
+                continue;
+            }
+            prodCounterInc("lsp.statehash.kvstore.miss");
+        }
+        toCompute.emplace_back(i);
+    }
+    shared_ptr<ConcurrentBoundedQueue<int>> fileq = make_shared<ConcurrentBoundedQueue<int>>(toCompute.size());
+    for (auto i : toCompute) {
+        fileq->push(move(i), 1);
     }
 
-    logger->debug("Computing state hashes for {} files", files.size());
-
-    res.resize(files.size());
+    logger->debug("Computing state hashes for {} files ({} cached)", toCompute.size(),
+                  files.size() - toCompute.size());
 
     shared_ptr<BlockingBoundedQueue<vector<pair<int, core::FileHash>>>> resultq =
-        make_shared<BlockingBoundedQueue<vector<pair<int, core::FileHash>>>>(files.size());
+        make_shared<BlockingBoundedQueue<vector<pair<int, core::FileHash>>>>(toCompute.size());
     workers.multiplexJob("lspStateHash", [fileq, resultq, files, logger = this->logger]() {
         vector<pair<int, core::FileHash>> threadResult;
         int processedByThread = 0;
@@ -111,6 +153,10 @@ vector<core::FileHash> LSPLoop::computeStateHashes(const vector<shared_ptr<core:
              result = resultq->wait_pop_timed(threadResult, WorkerPool::BLOCK_INTERVAL(), *logger)) {
             if (result.gotItem()) {
                 for (auto &a : threadResult) {
+                    if (kvstore && files[a.first]) {
+                        kvstore->write(fileHashKey(*files[a.first]),
+                                       core::serialize::Serializer::storeFileHash(a.second));
+                    }
                     res[a.first] = move(a.second);
                 }
             }
@@ -131,6 +177,79 @@ void LSPLoop::reIndexFromFileSystem() {
         }
         indexed[id] = move(t);
     }
+    namesAfterLastCompaction = initialGS->namesUsed();
+}
+
+void LSPLoop::commitKvstore() {
+    if (!kvstore) {
+        return;
+    }
+    Timer timeit(logger, "commitKvstore");
+    // Cached trees refer to names by id, so they are only valid along with the name table they were created with.
+    // This writes the name table and commits if indexing added names.
+    payload::retainGlobalState(initialGS, opts, kvstore);
+    if (kvstore && !initialGS->wasModified()) {
+        // No new names, so everything we wrote refers to the name table that is already in the cache.
+        KeyValueStore::commit(move(kvstore));
+    }
+    // Otherwise, indexing had a critical error and nothing gets written. Either way, release the cache so that other
+    // Sorbet processes can use it while the server runs.
+    kvstore = nullptr;
+}
+
+namespace {
+u8 nameTableBytes(const core::GlobalState &gs) {
+    u8 bytes = 0;
+    for (auto &table : gs.memoryUsage()) {
+        if (table.table == "names" || table.table == "namesByHash" || table.table == "strings") {
+            bytes += table.bytes;
+        }
+    }
+    return bytes;
+}
+} // namespace
+
+void LSPLoop::compactNames() {
+    if (kvstore || namesAfterLastCompaction == 0 || initialGS->namesUsed() < 2 * namesAfterLastCompaction) {
+        // While the cache is open, the trees written to it refer to the name table that gets written along with them.
+        return;
+    }
+    Timer timeit(logger, "compact_names");
+    auto namesBefore = initialGS->namesUsed();
+    auto bytesBefore = nameTableBytes(*initialGS);
+
+    vector<bool> live(namesBefore);
+    {
+        core::MutableContext ctx(*initialGS, core::Symbols::root());
+        for (auto &tree : indexed) {
+            if (tree.tree) {
+                tree.tree = ast::Substitute::markNames(ctx, live, move(tree.tree));
+            }
+        }
+    }
+    vector<core::NameRef> substitution;
+    auto compacted = initialGS->compactNames(firstCollectableName, move(live), substitution);
+    {
+        core::GlobalSubstitution subst(move(substitution), *compacted);
+        core::MutableContext ctx(*compacted, core::Symbols::root());
+        for (auto &tree : indexed) {
+            if (tree.tree) {
+                tree.tree = ast::Substitute::run(ctx, subst, move(tree.tree));
+            }
+        }
+    }
+    // runLSP handed this flag to the reader thread.
+    compacted->typecheckCanceled = initialGS->typecheckCanceled;
+    initialGS = move(compacted);
+    namesAfterLastCompaction = initialGS->namesUsed();
+
+    auto bytesAfter = nameTableBytes(*initialGS);
+    auto bytesReclaimed = bytesBefore > bytesAfter ? bytesBefore - bytesAfter : 0;
+    prodCounterInc("lsp.names.compactions");
+    prodCounterAdd("lsp.names.collected", namesBefore - namesAfterLastCompaction);
+    prodCounterAdd("lsp.names.bytes_reclaimed", bytesReclaimed);
+    logger->debug("Compacted the name table from {} to {} names, reclaiming {} bytes", namesBefore,
+                  namesAfterLastCompaction, bytesReclaimed);
 }
 
 void tryApplyLocalVarSaver(const core::GlobalState &gs, vector<ast::ParsedFile> &indexedCopies) {
@@ -140,7 +259,7 @@ void tryApplyLocalVarSaver(const core::GlobalState &gs, vector<ast::ParsedFile>
     for (auto &t : indexedCopies) {
         LocalVarSaver localVarSaver;
         core::Context ctx(gs, core::Symbols::root());
-        t.tree = ast::TreeMap::apply(ctx, localVarSaver, move(t.tree));
+        ast::TreeWalk::apply(ctx, localVarSaver, t.tree.get());
     }
 }
 
@@ -151,22 +270,79 @@ void tryApplyDefLocSaver(const core::GlobalState &gs, vector<ast::ParsedFile> &i
     for (auto &t : indexedCopies) {
         DefLocSaver defLocSaver;
         core::Context ctx(gs, core::Symbols::root());
-        t.tree = ast::TreeMap::apply(ctx, defLocSaver, move(t.tree));
+        ast::TreeWalk::apply(ctx, defLocSaver, t.tree.get());
     }
 }
 
-LSPLoop::TypecheckRun LSPLoop::runSlowPath(const vector<shared_ptr<core::File>> &changedFiles) {
+LSPLoop::StreamOpenFileDiagnostics::StreamOpenFileDiagnostics(LSPLoop &loop, const core::GlobalState &gs)
+    : loop(loop), gs(gs) {
+    if (loop.queueMutex == nullptr) {
+        return;
+    }
+    for (auto &path : loop.openFiles) {
+        auto fref = gs.findFileByPath(path);
+        if (fref.exists()) {
+            openFileRefs.insert(fref);
+        }
+    }
+    if (openFileRefs.empty()) {
+        return;
+    }
+    loop.errorQueue->streamFlushes([this](core::FileRef file, const vector<core::ErrorQueueMessage> &queued) -> void {
+        // Typechecking a file flushes it, and by then everything that was reported for it is in `queued`.
+        if (!isOpen(file)) {
+            return;
+        }
+        vector<const core::Error *> errors;
+        for (auto &msg : queued) {
+            if (msg.kind == core::ErrorQueueMessage::Kind::Error && !msg.error->isSilenced) {
+                errors.emplace_back(msg.error.get());
+            }
+        }
+        if (auto msg = this->loop.diagnosticsIfChanged(this->gs, file, errors)) {
+            prodCounterInc("lsp.diagnostics.streamed");
+            this->loop.sendMessage(*msg);
+        }
+    });
+}
+
+LSPLoop::StreamOpenFileDiagnostics::~StreamOpenFileDiagnostics() {
+    if (!openFileRefs.empty()) {
+        loop.errorQueue->streamFlushes(nullptr);
+    }
+}
+
+bool LSPLoop::StreamOpenFileDiagnostics::isOpen(core::FileRef file) const {
+    return openFileRefs.find(file) != openFileRefs.end();
+}
+
+LSPLoop::TypecheckRun LSPLoop::runSlowPath(const vector<shared_ptr<core::File>> &changedFiles, bool isCancelable) {
     ShowOperation slowPathOp(*this, "SlowPath", "Typechecking...");
+    SlowPathInProgress slowPathInProgress(*this);
     Timer timeit(logger, "slow_path");
     ENFORCE(initialGS->errorQueue->isEmpty());
     prodCategoryCounterInc("lsp.updates", "slowpath");
     logger->debug("Taking slow path");
 
+    // Before the file table is unfrozen, since that holds on to `initialGS`.
+    compactNames();
     core::UnfreezeFileTable fileTableAccess(*initialGS);
     indexed.reserve(indexed.size() + changedFiles.size());
+    vector<core::FileRef> updatedFiles;
     for (auto &t : changedFiles) {
-        updateFile(t);
+        auto fref = updateFile(t);
+        if (fref.exists()) {
+            updatedFiles.emplace_back(fref);
+        }
+    }
+    // Indexing errors are only reported when a file is indexed, and a canceled run dropped them.
+    for (auto fref : filesIndexedByCanceledSlowPaths) {
+        if (absl::c_find(updatedFiles, fref) == updatedFiles.end()) {
+            indexed[fref.id()] = pipeline::indexOne(opts, *initialGS, fref, kvstore);
+            updatedFiles.emplace_back(fref);
+        }
     }
+    filesIndexedByCanceledSlowPaths.clear();
 
     vector<ast::ParsedFile> indexedCopies;
     for (const auto &tree : indexed) {
@@ -176,6 +352,10 @@ LSPLoop::TypecheckRun LSPLoop::runSlowPath(const vector<shared_ptr<core::File>>
     }
 
     auto finalGs = initialGS->deepCopy(true);
+    if (isCancelable) {
+        // runLSP hands this flag to the reader thread, which sets it when a newer file update arrives.
+        finalGs->typecheckCanceled = initialGS->typecheckCanceled;
+    }
     auto resolved = pipeline::resolve(finalGs, move(indexedCopies), opts, workers, skipConfigatron);
     tryApplyDefLocSaver(*finalGs, resolved);
     tryApplyLocalVarSaver(*finalGs, resolved);
@@ -184,18 +364,77 @@ LSPLoop::TypecheckRun LSPLoop::runSlowPath(const vector<shared_ptr<core::File>>
         ENFORCE(tree.file.exists());
         affectedFiles.push_back(tree.file);
     }
-    pipeline::typecheck(finalGs, move(resolved), opts, workers);
+    if (!finalGs->wasTypecheckingCanceled()) {
+        StreamOpenFileDiagnostics streamDiagnostics(*this, *finalGs);
+        // Typecheck open files first, so that their diagnostics go out early.
+        absl::c_stable_partition(resolved,
+                                 [&](const ast::ParsedFile &tree) -> bool { return streamDiagnostics.isOpen(tree.file); });
+        pipeline::typecheck(finalGs, move(resolved), opts, workers);
+    }
     auto out = initialGS->errorQueue->drainWithQueryResponses();
+    if (finalGs->wasTypecheckingCanceled()) {
+        // Everything this run produced lives in `finalGs` and the drained errors, so dropping them leaves
+        // `initialGS` and `indexed` untouched. The next slow path indexes `updatedFiles` again, to report what
+        // indexing them reported this time.
+        logger->debug("Slow path canceled by newer file updates");
+        prodCategoryCounterInc("lsp.updates", "slowpath_canceled");
+        lastSlowPathWasCanceled = true;
+        filesIndexedByCanceledSlowPaths = move(updatedFiles);
+        TypecheckRun canceledRun{{}, {}, {}, nullptr, false};
+        canceledRun.canceled = true;
+        return canceledRun;
+    }
+    lastSlowPathWasCanceled = false;
+    // Fast paths that later run on this GlobalState are not cancelable.
+    finalGs->typecheckCanceled = make_shared<atomic<bool>>(false);
     finalGs->lspTypecheckCount++;
     return TypecheckRun{move(out.first), move(affectedFiles), move(out.second), move(finalGs), false};
 }
 
+LSPLoop::TypecheckRun LSPLoop::runQueryOnSnapshot(unique_ptr<core::GlobalState> gs, const core::lsp::Query &q,
+                                                  vector<shared_ptr<core::File>> &changedFiles) const {
+    Timer timeit(logger, "snapshot_query");
+    ENFORCE(gs->lspQuery.isEmpty());
+    ENFORCE(!q.isEmpty());
+    ENFORCE(gs->errorQueue != errorQueue, "snapshot queries need their own error queue");
+    gs->lspQuery = q;
+    // Equivalent to the fast path for `changedFiles`, except that everything happens on `gs` and the calling thread.
+    unique_ptr<KeyValueStore> noKvstore;
+    vector<core::FileRef> filesTypechecked;
+    vector<ast::ParsedFile> updatedIndexed;
+    for (auto &f : changedFiles) {
+        auto fref = gs->findFileByPath(f->path());
+        if (!fref.exists()) {
+            continue;
+        }
+        // `f` is private to this query, so indexing can mark it up without racing with the main thread.
+        gs = core::GlobalState::replaceFile(move(gs), fref, f);
+        updatedIndexed.emplace_back(pipeline::indexOne(opts, *gs, fref, noKvstore));
+        filesTypechecked.emplace_back(fref);
+    }
+
+    auto resolved = pipeline::incrementalResolve(*gs, move(updatedIndexed), opts);
+    tryApplyDefLocSaver(*gs, resolved);
+    tryApplyLocalVarSaver(*gs, resolved);
+    core::Context ctx(*gs, core::Symbols::root());
+    for (auto &tree : resolved) {
+        pipeline::typecheckOne(ctx, move(tree), opts);
+    }
+    auto out = gs->errorQueue->drainWithQueryResponses();
+    gs->lspQuery = core::lsp::Query::noQuery();
+    return TypecheckRun{{}, move(filesTypechecked), move(out.second), move(gs), true};
+}
+
 bool LSPLoop::canTakeFastPath(const vector<shared_ptr<core::File>> &changedFiles,
                               const vector<core::FileHash> &hashes) const {
     if (disableFastPath) {
         logger->debug("Taking sad path because happy path is disabled.");
         return false;
     }
+    if (lastSlowPathWasCanceled) {
+        logger->debug("Taking sad path because the last slow path was canceled.");
+        return false;
+    }
     logger->debug("Trying to see if happy path is available after {} file changes", changedFiles.size());
 
     ENFORCE(changedFiles.size() == hashes.size());
@@ -223,7 +462,8 @@ bool LSPLoop::canTakeFastPath(const vector<shared_ptr<core::File>> &changedFiles
 }
 
 LSPLoop::TypecheckRun LSPLoop::tryFastPath(unique_ptr<core::GlobalState> gs,
-                                           vector<shared_ptr<core::File>> &changedFiles, bool allFiles) {
+                                           vector<shared_ptr<core::File>> &changedFiles, bool allFiles,
+                                           bool isCancelable) {
     auto finalGs = move(gs);
     // We assume finalGs is a copy of initialGS, which has had the inferencer & resolver run.
     ENFORCE(finalGs->lspTypecheckCount > 0,
@@ -300,10 +540,9 @@ LSPLoop::TypecheckRun LSPLoop::tryFastPath(unique_ptr<core::GlobalState> gs,
         ENFORCE(initialGS->errorQueue->isEmpty());
         vector<ast::ParsedFile> updatedIndexed;
         for (auto &f : subset) {
-            auto t = pipeline::indexOne(opts, *finalGs, f, kvstore);
-            int id = t.file.id();
-            indexed[id] = move(t);
-            updatedIndexed.emplace_back(ast::ParsedFile{indexed[id].tree->deepCopy(), indexed[id].file});
+            // These trees use the names of `finalGs`, which `initialGS` doesn't have. `indexed` keeps the trees that
+            // `updateFile` indexed against `initialGS`, so that slow paths and `compactNames` can use them.
+            updatedIndexed.emplace_back(pipeline::indexOne(opts, *finalGs, f, kvstore));
         }
 
         auto resolved = pipeline::incrementalResolve(*finalGs, move(updatedIndexed), opts);
@@ -314,7 +553,12 @@ LSPLoop::TypecheckRun LSPLoop::tryFastPath(unique_ptr<core::GlobalState> gs,
         finalGs->lspTypecheckCount++;
         return TypecheckRun{move(out.first), move(subset), move(out.second), move(finalGs), true};
     } else {
-        return runSlowPath(changedFiles);
+        auto run = runSlowPath(changedFiles, isCancelable);
+        if (run.canceled) {
+            // Keep answering requests with the last completed typecheck until a slow path finishes.
+            run.gs = move(finalGs);
+        }
+        return run;
     }
 }
 } // namespace sorbet::realmain::lsp
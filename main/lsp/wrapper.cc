@@ -12,6 +12,8 @@ const std::string LSPWrapper::EMPTY_STRING = "";
 vector<unique_ptr<LSPMessage>> LSPWrapper::getLSPResponsesFor(const LSPMessage &message) {
     auto result = lspLoop->processRequest(move(gs), message);
     gs = move(result.gs);
+    // Like runLSP, which resets this for every message it picks up.
+    lspLoop->initialGS->typecheckCanceled->store(false);
 
     // Should always run typechecking at least once for each request post-initialization.
     ENFORCE(!initialized || gs->lspTypecheckCount > 0, "Fatal error: LSPLoop did not typecheck GlobalState.");
@@ -39,6 +41,7 @@ vector<unique_ptr<LSPMessage>> LSPWrapper::getLSPResponsesFor(vector<unique_ptr<
 
     auto result = lspLoop->processRequests(move(gs), move(messages));
     gs = move(result.gs);
+    lspLoop->initialGS->typecheckCanceled->store(false);
 
     // Should always run typechecking at least once for each request post-initialization.
     ENFORCE(!initialized || !foundPostInitializationRequest || gs->lspTypecheckCount > 0,
@@ -91,6 +94,14 @@ int LSPWrapper::getTypecheckCount() const {
     return 0;
 }
 
+void LSPWrapper::cancelSlowPathsOfNextRequest() {
+    lspLoop->initialGS->typecheckCanceled->store(true);
+}
+
+void LSPWrapper::compactNamesOnNextSlowPath() {
+    lspLoop->namesAfterLastCompaction = 1;
+}
+
 void LSPWrapper::enableAllExperimentalFeatures() {
     enableExperimentalFeature(LSPExperimentalFeature::Hover);
     enableExperimentalFeature(LSPExperimentalFeature::GoToDefinition);
@@ -75,6 +75,18 @@ public:
      */
     int getTypecheckCount() const;
 
+    /**
+     * (For tests only) Makes the slow paths of the next request stop as if a newer file update had arrived while they
+     * ran.
+     */
+    void cancelSlowPathsOfNextRequest();
+
+    /**
+     * (For tests only) Makes the next slow path compact the name table, as if it had doubled since it was last
+     * compacted.
+     */
+    void compactNamesOnNextSlowPath();
+
     /**
      * Enable an experimental LSP feature.
      * Note: Use this method *before* the client performs initialization with the server.
@@ -53,6 +53,7 @@ const vector<PrintOptions> print_options({
     {"autogen-msgpack", &Printers::AutogenMsgPack, true},
     {"autogen-classlist", &Printers::AutogenClasslist, true},
     {"plugin-generated-code", &Printers::PluginGeneratedCode, true},
+    {"memory-report", &Printers::MemoryReport, true},
 });
 
 PrinterConfig::PrinterConfig() : state(make_shared<GuardedState>()){};
@@ -105,6 +106,7 @@ vector<reference_wrapper<PrinterConfig>> Printers::printers() {
         AutogenMsgPack,
         AutogenClasslist,
         PluginGeneratedCode,
+        MemoryReport,
     });
 }
 
@@ -207,9 +209,36 @@ static vector<string> extractExtraSubprocessOptions(const YAML::Node &config, co
     }
 }
 
+static vector<string> extractPersistentPlugins(const YAML::Node &config, const UnorderedMap<string, string> &triggers,
+                                               const string &filePath, shared_ptr<spdlog::logger> logger) {
+    auto persistentNode = config["persistent_plugins"];
+    vector<string> persistent;
+    if (!persistentNode) {
+        return persistent;
+    }
+    if (!persistentNode.IsSequence()) {
+        logger->error("{}: `persistent_plugins` must be an array of strings", filePath);
+        throw EarlyReturnWithCode(1);
+    }
+    for (const auto &command : persistentNode) {
+        if (!command.IsScalar()) {
+            logger->error("{}: An element of `persistent_plugins` is not a string", filePath);
+            throw EarlyReturnWithCode(1);
+        }
+        auto value = command.as<string>();
+        if (absl::c_none_of(triggers, [&](const auto &trigger) { return trigger.second == value; })) {
+            logger->error("{}: Persistent plugin \"{}\" is not the command of any trigger", filePath, value);
+            throw EarlyReturnWithCode(1);
+        }
+        persistent.emplace_back(move(value));
+    }
+    return persistent;
+}
+
 struct DslConfiguration {
     UnorderedMap<string, string> triggers;
     vector<string> rubyExtraArgs;
+    vector<string> persistentPlugins;
 };
 
 DslConfiguration extractDslPlugins(string filePath, shared_ptr<spdlog::logger> logger) {
@@ -248,7 +277,8 @@ DslConfiguration extractDslPlugins(string filePath, shared_ptr<spdlog::logger> l
     if (!good) {
         throw EarlyReturnWithCode(1);
     }
-    return {triggers, extractExtraSubprocessOptions(config, filePath, logger)};
+    auto persistentPlugins = extractPersistentPlugins(config, triggers, filePath, logger);
+    return {triggers, extractExtraSubprocessOptions(config, filePath, logger), move(persistentPlugins)};
 }
 
 cxxopts::Options buildOptions() {
@@ -305,6 +335,13 @@ cxxopts::Options buildOptions() {
     options.add_options("advanced")("color", "Use color output", cxxopts::value<string>()->default_value("auto"),
                                     "{always,never,[auto]}");
     options.add_options("advanced")("lsp", "Start in language-server-protocol mode");
+    options.add_options("advanced")("daemon",
+                                    "Keep the typechecked state in memory, and typecheck for command line runs that "
+                                    "pass the same options. Requires --daemon-socket");
+    options.add_options("advanced")("daemon-socket",
+                                    "Unix socket of the typecheck daemon. If a daemon with the same options listens "
+                                    "on it, it typechecks instead of this process",
+                                    cxxopts::value<string>()->default_value(empty.daemonSocket), "path");
     options.add_options("advanced")("no-config", "Do not load the content of the `sorbet/config` file");
     options.add_options("advanced")("disable-watchman",
                                     "When in language-server-protocol mode, disable file watching via Watchman");
@@ -332,6 +369,9 @@ cxxopts::Options buildOptions() {
         "matchs. Matches must be against whole folder and file names, so `foo` matches `/foo/bar.rb` and "
         "`/bar/foo/baz.rb` but not `/foo.rb` or `/foo2/bar.rb`.",
         cxxopts::value<vector<string>>(), "string");
+    options.add_options("advanced")("skip-untyped-method-bodies",
+                                    "Do not desugar or name the bodies of methods in files below `typed: true`, "
+                                    "other than `initialize`. Errors from inside those bodies are not reported.");
     options.add_options("advanced")("no-error-count", "Do not print the error count summary line");
     options.add_options("advanced")("autogen-version", "Autogen version to output", cxxopts::value<int>());
     options.add_options("advanced")("error-url-base",
@@ -367,6 +407,9 @@ cxxopts::Options buildOptions() {
                                cxxopts::value<string>()->default_value(empty.storeState), "file");
     options.add_options("dev")("cache-dir", "Use the specified folder to cache data",
                                cxxopts::value<string>()->default_value(empty.cacheDir), "dir");
+    options.add_options("dev")("incremental",
+                               "Only typecheck files whose contents or dependencies changed since the last run with "
+                               "the same --cache-dir and options");
     options.add_options("dev")("suppress-non-critical", "Exit 0 unless there was a critical error");
     options.add_options("dev")("dsl-plugins", "YAML config that configures external DSL plugins",
                                cxxopts::value<string>()->default_value(""), "filepath.yaml");
@@ -376,6 +419,9 @@ cxxopts::Options buildOptions() {
         defaultThreads = 2;
     }
 
+    options.add_options("dev")("typecheck-processes",
+                               "Typecheck in this many processes forked after resolve, instead of in threads",
+                               cxxopts::value<int>()->default_value(to_string(empty.typecheckProcesses)), "int");
     options.add_options("dev")("max-threads", "Set number of threads",
                                cxxopts::value<int>()->default_value(to_string(defaultThreads)), "int");
     options.add_options("dev")("counter", "Print internal counter", cxxopts::value<vector<string>>(), "counter");
@@ -595,6 +641,25 @@ void readOptions(Options &opts, int argc, char *argv[],
             logger->error("lsp mode does not yet support caching.");
             throw EarlyReturnWithCode(1);
         }
+        opts.runDaemon = raw["daemon"].as<bool>();
+        opts.daemonSocket = raw["daemon-socket"].as<string>();
+        if (opts.runDaemon) {
+            if (opts.daemonSocket.empty()) {
+                logger->error("--daemon requires --daemon-socket");
+                throw EarlyReturnWithCode(1);
+            }
+            if (opts.runLSP || !opts.inlineInput.empty() || opts.autocorrect) {
+                logger->error("You may not use --daemon with --lsp, -e or --autocorrect.");
+                throw EarlyReturnWithCode(1);
+            }
+            for (PrinterConfig &printer : opts.print.printers()) {
+                if (printer.enabled) {
+                    // Clients only get errors back.
+                    logger->error("You may not use --daemon with --print.");
+                    throw EarlyReturnWithCode(1);
+                }
+            }
+        }
         opts.disableWatchman = raw["disable-watchman"].as<bool>();
         opts.watchmanPath = raw["watchman-path"].as<string>();
         if ((opts.print.Autogen.enabled || opts.print.AutogenMsgPack.enabled || opts.print.AutogenClasslist.enabled) &&
@@ -608,8 +673,9 @@ void readOptions(Options &opts, int argc, char *argv[],
         opts.noStdlib = raw["no-stdlib"].as<bool>();
         opts.stdoutHUPHack = raw["stdout-hup-hack"].as<bool>();
 
-        opts.threads = opts.runLSP ? raw["max-threads"].as<int>()
-                                   : min(raw["max-threads"].as<int>(), int(opts.inputFileNames.size() / 2));
+        opts.threads = (opts.runLSP || opts.runDaemon)
+                           ? raw["max-threads"].as<int>()
+                           : min(raw["max-threads"].as<int>(), int(opts.inputFileNames.size() / 2));
 
         if (raw["h"].as<bool>()) {
             logger->info("{}", options.help({""}));
@@ -644,8 +710,42 @@ void readOptions(Options &opts, int argc, char *argv[],
             opts.configatronFiles = raw["configatron-file"].as<vector<string>>();
         }
         opts.skipDSLPasses = raw["skip-dsl-passes"].as<bool>();
+        opts.skipUntypedMethodBodies = raw["skip-untyped-method-bodies"].as<bool>();
+        if (opts.skipUntypedMethodBodies && opts.runLSP) {
+            // LSP answers queries about every method body.
+            logger->error("You may not use --skip-untyped-method-bodies with --lsp.");
+            throw EarlyReturnWithCode(1);
+        }
         opts.storeState = raw["store-state"].as<string>();
         opts.suggestTyped = raw["suggest-typed"].as<bool>();
+        opts.incremental = raw["incremental"].as<bool>();
+        if (opts.incremental) {
+            if (raw["cache-dir"].as<string>().empty()) {
+                logger->error("--incremental requires --cache-dir");
+                throw EarlyReturnWithCode(1);
+            }
+            if (opts.autocorrect || opts.suggestTyped) {
+                // Errors replayed from the cache carry no autocorrects, and don't count towards `# typed:` levels.
+                logger->error("You may not use --incremental with --autocorrect or --suggest-typed.");
+                throw EarlyReturnWithCode(1);
+            }
+            // Printing some phases disables the cache.
+            opts.incremental = !opts.cacheDir.empty();
+        }
+        opts.typecheckProcesses = raw["typecheck-processes"].as<int>();
+        if (opts.typecheckProcesses > 1) {
+            bool printing = false;
+            for (PrinterConfig &printer : opts.print.printers()) {
+                printing = printing || printer.enabled;
+            }
+            if (printing || opts.autocorrect || opts.suggestTyped || opts.incremental) {
+                // Typecheck processes only report errors back, without autocorrects, and their file tables are
+                // their own.
+                logger->error("You may not use --typecheck-processes with --print, --autocorrect, --suggest-typed "
+                              "or --incremental.");
+                throw EarlyReturnWithCode(1);
+            }
+        }
         opts.waitForDebugger = raw["wait-for-dbg"].as<bool>();
         opts.stressIncrementalResolver = raw["stress-incremental-resolver"].as<bool>();
         opts.suggestRuntimeProfiledType = raw["suggest-runtime-profiled"].as<bool>();
@@ -724,13 +824,16 @@ void readOptions(Options &opts, int argc, char *argv[],
         }
 
         opts.supressNonCriticalErrors = raw["suppress-non-critical"].as<bool>();
-        if (!raw["typed-override"].as<string>().empty()) {
-            opts.strictnessOverrides = extractStricnessOverrides(raw["typed-override"].as<string>(), logger);
+        opts.typedOverrideFile = raw["typed-override"].as<string>();
+        if (!opts.typedOverrideFile.empty()) {
+            opts.strictnessOverrides = extractStricnessOverrides(opts.typedOverrideFile, logger);
         }
-        if (!raw["dsl-plugins"].as<string>().empty()) {
-            auto dslConfig = extractDslPlugins(raw["dsl-plugins"].as<string>(), logger);
+        opts.dslPluginsFile = raw["dsl-plugins"].as<string>();
+        if (!opts.dslPluginsFile.empty()) {
+            auto dslConfig = extractDslPlugins(opts.dslPluginsFile, logger);
             opts.dslPluginTriggers = std::move(dslConfig.triggers);
             opts.dslRubyExtraArgs = std::move(dslConfig.rubyExtraArgs);
+            opts.dslPersistentPlugins = std::move(dslConfig.persistentPlugins);
         }
     } catch (cxxopts::OptionParseException &e) {
         logger->info("{}\n\n{}", e.what(), options.help({"", "advanced", "dev"}));
@@ -73,6 +73,8 @@ struct Printers {
     PrinterConfig AutogenMsgPack;
     PrinterConfig AutogenClasslist;
     PrinterConfig PluginGeneratedCode;
+    // Estimated memory of GlobalState's tables, the retained trees and CFGs, and resident memory after each phase.
+    PrinterConfig MemoryReport;
     // Ensure everything here is in PrinterConfig::printers().
 
     std::vector<std::reference_wrapper<PrinterConfig>> printers();
@@ -109,6 +111,8 @@ struct Options {
     bool suggestSig = false;
     bool supressNonCriticalErrors = false;
     bool runLSP = false;
+    bool runDaemon = false;
+    std::string daemonSocket = "";
     bool disableWatchman = false;
     std::string watchmanPath = "watchman";
     bool stressIncrementalResolver = false;
@@ -116,17 +120,25 @@ struct Options {
     bool autocorrect = false;
     bool waitForDebugger = false;
     bool skipDSLPasses = false;
+    // Method bodies in files that won't be inferred are not desugared, see ast::desugar::node2Tree.
+    bool skipUntypedMethodBodies = false;
     bool suggestRuntimeProfiledType = false;
     int threads = 0;
+    int typecheckProcesses = 0;
     int logLevel = 0; // number of time -v was passed
     int autogenVersion = 0;
     std::string typedSource = "";
     std::string cacheDir = "";
+    bool incremental = false;
     std::vector<std::string> configatronDirs;
     std::vector<std::string> configatronFiles;
     UnorderedMap<std::string, core::StrictLevel> strictnessOverrides;
+    // The yaml files given to `--typed-override` and `--dsl-plugins`, if any.
+    std::string typedOverrideFile;
+    std::string dslPluginsFile;
     UnorderedMap<std::string, std::string> dslPluginTriggers;
     std::vector<std::string> dslRubyExtraArgs;
+    std::vector<std::string> dslPersistentPlugins;
     std::string storeState = "";
     bool enableCounters = false;
     std::vector<std::string> someCounters;
@@ -26,6 +26,9 @@ TEST(OptionsTest, DefaultConstructorMatchesReadOptions) {
     EXPECT_EQ(empty.suggestSig, opts.suggestSig);
     EXPECT_EQ(empty.supressNonCriticalErrors, opts.supressNonCriticalErrors);
     EXPECT_EQ(empty.runLSP, opts.runLSP);
+    EXPECT_EQ(empty.runDaemon, opts.runDaemon);
+    EXPECT_EQ(empty.typecheckProcesses, opts.typecheckProcesses);
+    EXPECT_EQ(empty.daemonSocket, opts.daemonSocket);
     EXPECT_EQ(empty.disableWatchman, opts.disableWatchman);
     EXPECT_EQ(empty.watchmanPath, opts.watchmanPath);
     EXPECT_EQ(empty.stressIncrementalResolver, opts.stressIncrementalResolver);
@@ -44,7 +47,9 @@ TEST(OptionsTest, DefaultConstructorMatchesReadOptions) {
     EXPECT_EQ(empty.strictnessOverrides.size(), opts.strictnessOverrides.size());
     EXPECT_EQ(empty.dslPluginTriggers.size(), opts.dslPluginTriggers.size());
     EXPECT_EQ(empty.dslRubyExtraArgs.size(), opts.dslRubyExtraArgs.size());
+    EXPECT_EQ(empty.dslPersistentPlugins.size(), opts.dslPersistentPlugins.size());
     EXPECT_EQ(empty.storeState, opts.storeState);
+    EXPECT_EQ(empty.incremental, opts.incremental);
     EXPECT_EQ(empty.enableCounters, opts.enableCounters);
     EXPECT_EQ(empty.someCounters.size(), opts.someCounters.size());
     EXPECT_EQ(empty.errorUrlBase, opts.errorUrlBase);
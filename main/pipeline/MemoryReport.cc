@@ -0,0 +1,115 @@
+#include "main/pipeline/MemoryReport.h"
+#include "absl/synchronization/mutex.h"
+#include "ast/treemap/treemap.h"
+#include "common/os/os.h"
+#include <atomic>
+
+using namespace std;
+
+namespace sorbet::realmain::pipeline {
+
+namespace {
+
+struct PhaseMemory {
+    string phase;
+    size_t resident;
+    size_t peak;
+};
+
+absl::Mutex phasesMutex;
+vector<PhaseMemory> phases GUARDED_BY(phasesMutex);
+
+atomic<u8> cfgCount{0};
+atomic<u8> cfgBytes{0};
+atomic<u8> largestCfgBytes{0};
+
+template <class T> u8 vectorBytes(const vector<T> &vec) {
+    return vec.capacity() * sizeof(T);
+}
+
+template <class... Nodes> u8 nodeBytes(const ast::Expression *node) {
+    u8 bytes = sizeof(ast::Expression);
+    ((ast::cast_tree_const<Nodes>(node) != nullptr ? (bytes = sizeof(Nodes), true) : false) || ...);
+    return bytes;
+}
+
+class TreeMemoryWalk {
+public:
+    u8 nodes = 0;
+    u8 bytes = 0;
+
+    void preWalkExpression(core::Context ctx, const ast::Expression &tree) {
+        nodes++;
+        bytes += nodeBytes<ast::ClassDef, ast::MethodDef, ast::If, ast::While, ast::Break, ast::Retry, ast::Next,
+                           ast::Return, ast::RescueCase, ast::Rescue, ast::Field, ast::Local, ast::UnresolvedIdent,
+                           ast::RestArg, ast::KeywordArg, ast::OptionalArg, ast::BlockArg, ast::ShadowArg,
+                           ast::Assign, ast::Send, ast::Cast, ast::Hash, ast::Array, ast::Literal,
+                           ast::UnresolvedConstantLit, ast::ConstantLit, ast::ZSuperArgs, ast::Block, ast::InsSeq,
+                           ast::EmptyTree>(&tree);
+    }
+};
+
+string kib(u8 bytes) {
+    return to_string((bytes + 1023) / 1024);
+}
+
+} // namespace
+
+void MemoryReport::phaseDone(const options::Options &opts, string_view phase) {
+    if (!opts.print.MemoryReport.enabled) {
+        return;
+    }
+    absl::MutexLock lck(&phasesMutex);
+    phases.push_back({string(phase), currentResidentMemory(), peakResidentMemory()});
+}
+
+void MemoryReport::cfgBuilt(const options::Options &opts, const cfg::CFG &cfg) {
+    if (!opts.print.MemoryReport.enabled) {
+        return;
+    }
+    u8 bytes = sizeof(cfg::CFG) + vectorBytes(cfg.basicBlocks) + vectorBytes(cfg.forwardsTopoSort);
+    for (auto &bb : cfg.basicBlocks) {
+        bytes += sizeof(cfg::BasicBlock) + vectorBytes(bb->args) + vectorBytes(bb->exprs) + vectorBytes(bb->backEdges);
+    }
+    cfgCount++;
+    cfgBytes += bytes;
+    auto largest = largestCfgBytes.load();
+    while (bytes > largest && !largestCfgBytes.compare_exchange_weak(largest, bytes)) {
+    }
+}
+
+void MemoryReport::print(const options::Options &opts, const core::GlobalState &gs,
+                         const vector<ast::ParsedFile> &trees) {
+    if (!opts.print.MemoryReport.enabled) {
+        return;
+    }
+    auto &out = opts.print.MemoryReport;
+
+    out.fmt("{:<16}{:>14}{:>14}{:>14}\n", "phase", "rss KiB", "peak KiB", "peak growth");
+    {
+        absl::MutexLock lck(&phasesMutex);
+        size_t previousPeak = 0;
+        for (auto &phase : phases) {
+            out.fmt("{:<16}{:>14}{:>14}{:>14}\n", phase.phase, kib(phase.resident), kib(phase.peak),
+                    kib(phase.peak > previousPeak ? phase.peak - previousPeak : 0));
+            previousPeak = max(previousPeak, phase.peak);
+        }
+    }
+    out.fmt("\n");
+
+    out.fmt("{:<16}{:>14}{:>14}\n", "table", "entries", "KiB");
+    for (auto &table : gs.memoryUsage()) {
+        out.fmt("{:<16}{:>14}{:>14}\n", table.table, table.entries, kib(table.bytes));
+    }
+
+    TreeMemoryWalk walk;
+    core::Context ctx(gs, core::Symbols::root());
+    for (auto &tree : trees) {
+        ast::TreeWalk::apply(ctx, walk, tree.tree.get());
+    }
+    out.fmt("{:<16}{:>14}{:>14}\n", "trees", walk.nodes, kib(walk.bytes));
+    out.fmt("{:<16}{:>14}{:>14}\n", "cfgs", cfgCount.load(), kib(cfgBytes.load()));
+    out.fmt("{:<16}{:>14}{:>14}\n", "largestCfg", cfgCount.load() > 0 ? 1 : 0, kib(largestCfgBytes.load()));
+}
+
+} // namespace sorbet::realmain::pipeline
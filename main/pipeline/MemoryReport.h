@@ -0,0 +1,32 @@
+#ifndef SORBET_PIPELINE_MEMORYREPORT_H
+#define SORBET_PIPELINE_MEMORYREPORT_H
+
+#include "ast/ast.h"
+#include "cfg/CFG.h"
+#include "main/options/options.h"
+
+namespace sorbet::realmain::pipeline {
+
+/**
+ * Collects what `--print=memory-report` shows: the resident memory at the end of every pipeline phase, the sizes of
+ * the CFGs built while typechecking, and, once everything ran, an estimate of what GlobalState's tables and the
+ * retained trees take.
+ *
+ * Resident memory is measured, everything else is estimated from container capacities and object sizes, so it doesn't
+ * include allocator overhead.
+ */
+class MemoryReport final {
+public:
+    // Records the resident memory at the end of `phase`, if the report was asked for.
+    static void phaseDone(const options::Options &opts, std::string_view phase);
+
+    // Records the size of a CFG, if the report was asked for. Can be called from any thread.
+    static void cfgBuilt(const options::Options &opts, const cfg::CFG &cfg);
+
+    // Prints the report.
+    static void print(const options::Options &opts, const core::GlobalState &gs,
+                      const std::vector<ast::ParsedFile> &trees);
+};
+
+} // namespace sorbet::realmain::pipeline
+#endif // SORBET_PIPELINE_MEMORYREPORT_H
@@ -2,18 +2,24 @@
 #include "core/proto/proto.h"
 #include <sstream>
 
+#include "MemoryReport.h"
 #include "ProgressIndicator.h"
 #include "absl/strings/escaping.h" // BytesToHexString
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "ast/desugar/Desugar.h"
 #include "ast/substitute/substitute.h"
 #include "ast/treemap/treemap.h"
 #include "cfg/CFG.h"
 #include "cfg/builder/builder.h"
 #include "cfg/proto/proto.h"
+#include "common/Arena.h"
 #include "common/FileOps.h"
 #include "common/Timer.h"
 #include "common/concurrency/ConcurrentQueue.h"
 #include "common/crypto_hashing/crypto_hashing.h"
+#include "common/os/os.h"
 #include "core/GlobalSubstitution.h"
 #include "core/Unfreeze.h"
 #include "core/errors/parser.h"
@@ -30,6 +36,14 @@
 #include "plugin/Plugins.h"
 #include "plugin/SubprocessTextPlugin.h"
 #include "resolver/resolver.h"
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -41,17 +55,58 @@ class CFGCollectorAndTyper {
 public:
     CFGCollectorAndTyper(const options::Options &opts) : opts(opts){};
 
-    unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> m) {
-        if (m->loc.file().data(ctx).strictLevel < core::StrictLevel::True || m->symbol.data(ctx)->isOverloaded()) {
-            return m;
+    // Counts the nodes visited, so that they can be compared with the nodes in the tree.
+    u8 visited = 0;
+
+    // Types every method in a flattened tree, in tree order. Like TreeMap, reports where it was when it crashed.
+    void typecheck(core::Context ctx, ast::Expression *tree) {
+        try {
+            typecheckDefinitions(ctx, tree);
+        } catch (ast::ReportedRubyException &exception) {
+            Exception::failInFuzzer();
+            if (auto e = ctx.state.beginError(exception.onLoc, core::errors::Internal::InternalError)) {
+                e.setHeader("Failed to process tree (backtrace is above)");
+            }
+            throw exception.reported;
+        }
+    }
+
+private:
+    // Flattening leaves every method definition at the top level or directly in a class body, so method bodies don't
+    // need to be walked to find them.
+    void typecheckDefinitions(core::Context ctx, ast::Expression *tree) {
+        visited++;
+        if (auto *m = ast::cast_tree<ast::MethodDef>(tree)) {
+            try {
+                typecheckMethod(ctx, *m);
+            } catch (SorbetException &e) {
+                Exception::failInFuzzer();
+                throw ast::ReportedRubyException{e, m->loc};
+            }
+        } else if (auto *klass = ast::cast_tree<ast::ClassDef>(tree)) {
+            for (auto &def : klass->rhs) {
+                typecheckDefinitions(ctx, def.get());
+            }
+        } else if (auto *seq = ast::cast_tree<ast::InsSeq>(tree)) {
+            for (auto &stat : seq->stats) {
+                typecheckDefinitions(ctx, stat.get());
+            }
+            typecheckDefinitions(ctx, seq->expr.get());
+        }
+    }
+
+    void typecheckMethod(core::Context ctx, ast::MethodDef &m) {
+        if (m.loc.file().data(ctx).strictLevel < core::StrictLevel::True || m.symbol.data(ctx)->isOverloaded()) {
+            return;
         }
         auto &print = opts.print;
-        auto cfg = cfg::CFGBuilder::buildFor(ctx.withOwner(m->symbol), *m);
+        auto cfg = cfg::CFGBuilder::buildFor(ctx.withOwner(m.symbol), m);
 
         if (opts.stopAfterPhase == options::Phase::CFG) {
-            return m;
+            return;
         }
         cfg = infer::Inference::run(ctx.withOwner(cfg->symbol), move(cfg));
+        MemoryReport::cfgBuilt(opts, *cfg);
         if (print.CFG.enabled) {
             print.CFG.fmt("{}\n\n", cfg->toString(ctx));
         }
@@ -66,27 +121,113 @@ public:
                 print.CFGProto.print(buf);
             }
         }
-        return m;
     }
 };
 
-string fileKey(core::GlobalState &gs, core::FileRef file) {
+string contentHash(const core::GlobalState &gs, core::FileRef file) {
+    auto hashBytes = sorbet::crypto_hashing::hash64(file.data(gs).source());
+    return absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)});
+}
+
+string fileKey(const core::GlobalState &gs, core::FileRef file) {
     auto path = file.data(gs).path();
     string key(path.begin(), path.end());
     key += "//";
-    auto hashBytes = sorbet::crypto_hashing::hash64(file.data(gs).source());
-    key += absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)});
+    key += contentHash(gs, file);
     return key;
 }
 
-unique_ptr<ast::Expression> fetchTreeFromCache(core::GlobalState &gs, core::FileRef file,
-                                               const unique_ptr<KeyValueStore> &kvstore) {
+// Whether nothing will ever look into the method bodies of `file`, beyond naming and resolving them.
+bool canSkipMethodBodies(const options::Options &opts, const core::GlobalState &gs, core::FileRef file) {
+    auto &data = file.data(gs);
+    // RBIs are left alone: their method bodies are nearly always empty, and desugar checks that they are.
+    return opts.skipUntypedMethodBodies && !gs.runningUnderAutogen && !data.isRBI() &&
+           data.strictLevel < core::StrictLevel::True;
+}
+
+// Trees are compressed against a dictionary that is trained on the first trees that are cached, and stored as its id
+// followed by its contents. Serializer::VERSION is part of the cache's version, so the dictionary is retrained along
+// with every change to how trees are serialized.
+const string TREE_DICTIONARY_KEY = "tree_dictionary";
+// Lizard looks at most 64KB back for matches, so a dictionary any larger would only help the first bytes of a tree.
+constexpr size_t TREE_DICTIONARY_BYTES = 64 * 1024;
+// A dictionary trained on fewer trees than this knows too little about the rest of the codebase to be worth keeping.
+constexpr size_t TREE_DICTIONARY_MIN_TRAINING_TREES = 100;
+// Training runs on the main thread while indexing waits for it, and the dictionary stops getting better long before it
+// has seen every tree. So it is trained on an evenly spread sample of about this much source.
+constexpr size_t TREE_DICTIONARY_SAMPLE_BYTES = 100 * TREE_DICTIONARY_BYTES;
+constexpr size_t TREE_DICTIONARY_ID_SIZE = 16;
+
+struct TreeDictionary {
+    string id = "none";
+    string contents;
+};
+
+// Every file needs the dictionary, so it is read once per indexing run. It is copied out of the store, because writing
+// to the store invalidates what was read from it.
+TreeDictionary readTreeDictionary(const unique_ptr<KeyValueStore> &kvstore) {
+    if (!kvstore) {
+        return TreeDictionary{};
+    }
+    auto stored = kvstore->readStringPinned(TREE_DICTIONARY_KEY);
+    if (stored.size() <= TREE_DICTIONARY_ID_SIZE) {
+        return TreeDictionary{};
+    }
+    return TreeDictionary{string(stored.substr(0, TREE_DICTIONARY_ID_SIZE)),
+                          string(stored.substr(TREE_DICTIONARY_ID_SIZE))};
+}
+
+TreeDictionary trainTreeDictionary(core::GlobalState &gs, vector<ast::ParsedFile> &trees) {
+    Timer timeit(gs.tracer(), "trainTreeDictionary");
+    auto start = chrono::steady_clock::now();
+    size_t sourceBytes = 0;
+    for (auto &tree : trees) {
+        sourceBytes += tree.file.data(gs).source().size();
+    }
+    const size_t stride = sourceBytes / TREE_DICTIONARY_SAMPLE_BYTES + 1;
+    // The sampled trees are moved out for training, and back afterwards.
+    vector<ast::ParsedFile> sample;
+    size_t sampleBytes = 0;
+    for (size_t i = 0; i < trees.size(); i += stride) {
+        sampleBytes += trees[i].file.data(gs).source().size();
+        sample.emplace_back(move(trees[i]));
+    }
+    auto contents = core::serialize::Serializer::trainExpressionDictionary(sample, TREE_DICTIONARY_BYTES);
+    for (size_t i = 0, j = 0; i < trees.size(); i += stride, j++) {
+        trees[i] = move(sample[j]);
+    }
+    auto hashBytes = sorbet::crypto_hashing::hash64(contents);
+    auto id = absl::BytesToHexString(string_view{(char *)hashBytes.data(), TREE_DICTIONARY_ID_SIZE / 2});
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    prodCounterAdd("types.input.files.kvstore.dictionary.sample_trees", sample.size());
+    prodCounterAdd("types.input.files.kvstore.dictionary.sample_bytes", sampleBytes);
+    prodCounterAdd("types.input.files.kvstore.dictionary.training_ms", elapsed.count());
+    return TreeDictionary{move(id), move(contents)};
+}
+
+// Trees only depend on where their file is through whether it is an RBI, so they are cached by content, and a moved or
+// copied file still hits the cache. Loading a tree puts it under the FileRef it is loaded for.
+//
+// A file's strictness can be overridden from the command line, so whether its cached tree has method bodies is part
+// of the key rather than of the cache's flavor. So is the dictionary that it was compressed with, so that trees from
+// before a dictionary was trained are simply not found.
+string treeKey(const options::Options &opts, const core::GlobalState &gs, core::FileRef file,
+               const TreeDictionary &dictionary) {
+    return absl::StrCat("tree//", contentHash(gs, file), file.data(gs).isRBI() ? "//rbi" : "",
+                        canSkipMethodBodies(opts, gs, file) ? "//nobodies" : "", "//dict-", dictionary.id);
+}
+
+unique_ptr<ast::Expression> fetchTreeFromCache(const options::Options &opts, core::GlobalState &gs, core::FileRef file,
+                                               const unique_ptr<KeyValueStore> &kvstore,
+                                               const TreeDictionary &dictionary) {
     if (kvstore && file.id() < gs.filesUsed()) {
-        string fileHashKey = fileKey(gs, file);
+        string fileHashKey = treeKey(opts, gs, file, dictionary);
         auto maybeCached = kvstore->read(fileHashKey);
         if (maybeCached) {
             prodCounterInc("types.input.files.kvstore.hit");
-            auto cachedTree = core::serialize::Serializer::loadExpression(gs, maybeCached, file.id());
+            auto cachedTree =
+                core::serialize::Serializer::loadExpression(gs, maybeCached, file.id(), dictionary.contents);
             file.data(gs).cachedParseTree = true;
             ENFORCE(cachedTree->loc.file() == file);
             return cachedTree;
@@ -97,16 +238,23 @@ unique_ptr<ast::Expression> fetchTreeFromCache(core::GlobalState &gs, core::File
     return nullptr;
 }
 
-void cacheTrees(core::GlobalState &gs, unique_ptr<KeyValueStore> &kvstore, vector<ast::ParsedFile> &trees) {
+void cacheTrees(const options::Options &opts, core::GlobalState &gs, unique_ptr<KeyValueStore> &kvstore,
+                vector<ast::ParsedFile> &trees) {
     if (!kvstore) {
         return;
     }
+    // An earlier batch of this run may have trained the dictionary.
+    auto dictionary = readTreeDictionary(kvstore);
+    if (dictionary.contents.empty() && trees.size() >= TREE_DICTIONARY_MIN_TRAINING_TREES) {
+        dictionary = trainTreeDictionary(gs, trees);
+        kvstore->writeStringPinned(TREE_DICTIONARY_KEY, absl::StrCat(dictionary.id, dictionary.contents));
+    }
     for (auto &tree : trees) {
         if (tree.file.data(gs).cachedParseTree) {
             continue;
         }
-        string fileHashKey = fileKey(gs, tree.file);
-        kvstore->write(fileHashKey, core::serialize::Serializer::storeExpression(gs, tree.tree));
+        string fileHashKey = treeKey(opts, gs, tree.file, dictionary);
+        kvstore->write(fileHashKey, core::serialize::Serializer::storeExpression(gs, tree.tree, dictionary.contents));
     }
 }
 
@@ -127,14 +275,19 @@ unique_ptr<parser::Node> runParser(core::GlobalState &gs, core::FileRef file, co
 }
 
 unique_ptr<ast::Expression> runDesugar(core::GlobalState &gs, core::FileRef file, unique_ptr<parser::Node> parseTree,
-                                       const options::Printers &print) {
+                                       const options::Options &opts) {
+    auto &print = opts.print;
     Timer timeit(gs.tracer(), "runDesugar", {{"file", (string)file.data(gs).path()}});
     unique_ptr<ast::Expression> ast;
     core::MutableContext ctx(gs, core::Symbols::root());
     {
         core::ErrorRegion errs(gs, file);
         core::UnfreezeNameTable nameTableAccess(gs); // creates temporaries during desugaring
-        ast = ast::desugar::node2Tree(ctx, move(parseTree));
+        bool skipMethodBodies = canSkipMethodBodies(opts, gs, file);
+        if (skipMethodBodies) {
+            prodCounterInc("types.input.files.method_bodies_skipped");
+        }
+        ast = ast::desugar::node2Tree(ctx, move(parseTree), skipMethodBodies);
     }
     if (print.Desugared.enabled) {
         print.Desugared.fmt("{}\n", ast->toStringWithTabs(gs, 0));
@@ -164,15 +317,18 @@ ast::ParsedFile emptyParsedFile(core::FileRef file) {
 }
 
 ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, core::FileRef file,
-                         unique_ptr<KeyValueStore> &kvstore) {
+                         unique_ptr<KeyValueStore> &kvstore, const TreeDictionary &dictionary) {
     auto &print = opts.print;
     ast::ParsedFile dslsInlined{nullptr, file};
 
     Timer timeit(lgs.tracer(), "indexOne");
+    // Every node built for this file comes from arenas that are freed along with its tree.
+    Arena::Scope treeArena(ast::Expression::arena);
     try {
-        unique_ptr<ast::Expression> tree = fetchTreeFromCache(lgs, file, kvstore);
+        unique_ptr<ast::Expression> tree = fetchTreeFromCache(opts, lgs, file, kvstore, dictionary);
 
         if (!tree) {
+            Arena::Scope parseTreeArena(parser::Node::arena);
             // tree isn't cached. Need to start from parser
             if (file.data(lgs).strictLevel == core::StrictLevel::Ignore) {
                 return emptyParsedFile(file);
@@ -181,7 +337,7 @@ ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, c
             if (opts.stopAfterPhase == options::Phase::PARSER) {
                 return emptyParsedFile(file);
             }
-            tree = runDesugar(lgs, file, move(parseTree), print);
+            tree = runDesugar(lgs, file, move(parseTree), opts);
             if (opts.stopAfterPhase == options::Phase::DESUGARER) {
                 return emptyParsedFile(file);
             }
@@ -214,22 +370,30 @@ ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, c
     }
 }
 
+ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, core::FileRef file,
+                         unique_ptr<KeyValueStore> &kvstore) {
+    return indexOne(opts, lgs, file, kvstore, readTreeDictionary(kvstore));
+}
+
 pair<ast::ParsedFile, vector<shared_ptr<core::File>>> emptyPluginFile(core::FileRef file) {
     return {emptyParsedFile(file), vector<shared_ptr<core::File>>()};
 }
 
-pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const options::Options &opts,
-                                                                          core::GlobalState &gs, core::FileRef file,
-                                                                          unique_ptr<KeyValueStore> &kvstore) {
+pair<ast::ParsedFile, vector<shared_ptr<core::File>>>
+indexOneWithPlugins(const options::Options &opts, core::GlobalState &gs, core::FileRef file,
+                    unique_ptr<KeyValueStore> &kvstore, const TreeDictionary &dictionary,
+                    plugin::SubprocessTextPlugin::CacheEntries &pluginCacheEntries) {
     auto &print = opts.print;
     ast::ParsedFile dslsInlined{nullptr, file};
     vector<shared_ptr<core::File>> resultPluginFiles;
 
     Timer timeit(gs.tracer(), "indexOneWithPlugins", {{"file", (string)file.data(gs).path()}});
+    Arena::Scope treeArena(ast::Expression::arena);
     try {
-        unique_ptr<ast::Expression> tree = fetchTreeFromCache(gs, file, kvstore);
+        unique_ptr<ast::Expression> tree = fetchTreeFromCache(opts, gs, file, kvstore, dictionary);
 
         if (!tree) {
+            Arena::Scope parseTreeArena(parser::Node::arena);
             // tree isn't cached. Need to start from parser
             if (file.data(gs).strictLevel == core::StrictLevel::Ignore) {
                 return emptyPluginFile(file);
@@ -238,7 +402,7 @@ pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const
             if (opts.stopAfterPhase == options::Phase::PARSER) {
                 return emptyPluginFile(file);
             }
-            tree = runDesugar(gs, file, move(parseTree), print);
+            tree = runDesugar(gs, file, move(parseTree), opts);
             if (opts.stopAfterPhase == options::Phase::DESUGARER) {
                 return emptyPluginFile(file);
             }
@@ -246,7 +410,8 @@ pair<ast::ParsedFile, vector<shared_ptr<core::File>>> indexOneWithPlugins(const
                 Timer timeit(gs.tracer(), "plugins_text");
                 core::MutableContext ctx(gs, core::Symbols::root());
                 core::ErrorRegion errs(gs, file);
-                auto [pluginTree, pluginFiles] = plugin::SubprocessTextPlugin::run(ctx, move(tree));
+                auto [pluginTree, pluginFiles] =
+                    plugin::SubprocessTextPlugin::run(ctx, move(tree), kvstore, pluginCacheEntries);
                 tree = move(pluginTree);
                 resultPluginFiles = move(pluginFiles);
             }
@@ -343,25 +508,82 @@ vector<core::FileRef> reserveFiles(unique_ptr<core::GlobalState> &gs, const vect
     return ret;
 }
 
-core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::FileRef file,
-                                    const options::Options &opts) {
-    auto &fileData = file.data(gs);
+namespace {
+const string TABLE_SIZES_KEY = "table_sizes";
+
+// Rough averages over Ruby codebases, for predicting table sizes when there is no previous run to go by.
+constexpr u8 BYTES_PER_NAME = 100;
+constexpr u8 BYTES_PER_SYMBOL = 150;
+
+u4 scaled(u4 count, u8 inputBytes, u8 previousInputBytes) {
+    return min<u8>(u8(count) * inputBytes / previousInputBytes, numeric_limits<u4>::max());
+}
+
+bool mispredicted(u4 actual, u4 predicted) {
+    return actual > predicted || actual < predicted - predicted / 8;
+}
+} // namespace
+
+TableSizes presizeTables(core::GlobalState &gs, const vector<core::FileRef> &files,
+                         const unique_ptr<KeyValueStore> &kvstore) {
+    Timer timeit(gs.tracer(), "presizeTables");
+    TableSizes predicted;
+    for (auto file : files) {
+        auto &data = file.data(gs);
+        if (data.sourceType != core::File::Type::NotYetRead) {
+            predicted.inputBytes += data.source().size();
+            continue;
+        }
+        struct stat st;
+        if (stat(string(data.path()).c_str(), &st) == 0) {
+            predicted.inputBytes += st.st_size;
+        }
+    }
+
+    TableSizes previous;
+    if (kvstore) {
+        vector<string_view> fields = absl::StrSplit(kvstore->readStringPinned(TABLE_SIZES_KEY), ' ');
+        if (fields.size() != 4 || !absl::SimpleAtoi(fields[0], &previous.inputBytes) ||
+            !absl::SimpleAtoi(fields[1], &previous.names) || !absl::SimpleAtoi(fields[2], &previous.symbols) ||
+            !absl::SimpleAtoi(fields[3], &previous.files)) {
+            previous = TableSizes{};
+        }
+    }
+    if (previous.inputBytes > 0) {
+        predicted.names = scaled(previous.names, predicted.inputBytes, previous.inputBytes);
+        predicted.symbols = scaled(previous.symbols, predicted.inputBytes, previous.inputBytes);
+        predicted.files = scaled(previous.files, predicted.inputBytes, previous.inputBytes);
+    } else {
+        predicted.names = gs.namesUsed() + predicted.inputBytes / BYTES_PER_NAME;
+        predicted.symbols = gs.symbolsUsed() + predicted.inputBytes / BYTES_PER_SYMBOL;
+        predicted.files = gs.filesUsed();
+    }
+
+    prodCounterAdd("names.resizes_avoided", gs.reserveTables(predicted.names, predicted.symbols, predicted.files));
+    return predicted;
+}
+
+bool tablesMispredicted(const core::GlobalState &gs, const TableSizes &predicted) {
+    return mispredicted(gs.namesUsed(), predicted.names) || mispredicted(gs.symbolsUsed(), predicted.symbols) ||
+           mispredicted(gs.filesUsed(), predicted.files);
+}
 
+void recordTableSizes(const core::GlobalState &gs, u8 inputBytes, unique_ptr<KeyValueStore> &kvstore) {
+    auto sizes = absl::StrCat(inputBytes, " ", gs.namesUsed(), " ", gs.symbolsUsed(), " ", gs.filesUsed());
+    kvstore->writeStringPinned(TABLE_SIZES_KEY, sizes);
+}
+
+core::StrictLevel strictLevelForSigil(const core::GlobalState &gs, string_view path, core::StrictLevel sigil,
+                                      const options::Options &opts) {
     core::StrictLevel level;
-    auto fnd = opts.strictnessOverrides.find(string(fileData.path()));
+    auto fnd = opts.strictnessOverrides.find(string(path));
     if (fnd != opts.strictnessOverrides.end()) {
-        if (fnd->second == fileData.originalSigil) {
-            core::ErrorRegion errs(gs, file);
-            if (auto e = gs.beginError(sorbet::core::Loc::none(file), core::errors::Parser::ParserError)) {
-                e.setHeader("Useless override of strictness level");
-            }
-        }
         level = fnd->second;
     } else {
-        if (fileData.originalSigil == core::StrictLevel::None) {
+        if (sigil == core::StrictLevel::None) {
             level = core::StrictLevel::False;
         } else {
-            level = fileData.originalSigil;
+            level = sigil;
         }
     }
 
@@ -379,6 +601,20 @@ core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::Fil
     return level;
 }
 
+core::StrictLevel decideStrictLevel(const core::GlobalState &gs, const core::FileRef file,
+                                    const options::Options &opts) {
+    auto &fileData = file.data(gs);
+
+    auto fnd = opts.strictnessOverrides.find(string(fileData.path()));
+    if (fnd != opts.strictnessOverrides.end() && fnd->second == fileData.originalSigil) {
+        core::ErrorRegion errs(gs, file);
+        if (auto e = gs.beginError(sorbet::core::Loc::none(file), core::errors::Parser::ParserError)) {
+            e.setHeader("Useless override of strictness level");
+        }
+    }
+    return strictLevelForSigil(gs, fileData.path(), fileData.originalSigil, opts);
+}
+
 void incrementStrictLevelCounter(core::StrictLevel level) {
     switch (level) {
         case core::StrictLevel::None:
@@ -414,6 +650,26 @@ void incrementStrictLevelCounter(core::StrictLevel level) {
     }
 }
 
+// Enough to hold the leading comments of nearly every file.
+constexpr size_t SIGIL_PREFIX_BYTES = 4 * 1024;
+
+// Reads the file, unless its first lines show that it is ignored. Only those lines are read then, since nothing but
+// the sigil of an ignored file is ever looked at.
+string readUnlessIgnored(const core::GlobalState &gs, string_view path, const options::Options &opts) {
+    auto prefix = opts.fs->readFilePrefix(path, SIGIL_PREFIX_BYTES);
+    if (prefix.size() < SIGIL_PREFIX_BYTES) {
+        return prefix;
+    }
+    auto sigil = core::File::fileSigilFromPrefix(prefix, false);
+    if (!sigil.has_value() || strictLevelForSigil(gs, path, *sigil, opts) != core::StrictLevel::Ignore) {
+        return opts.fs->readFile(path);
+    }
+    prodCounterInc("types.input.files.read_skipped");
+    // Cut at the end of a line, so that the truncated source still has the same sigil.
+    prefix.resize(prefix.rfind('\n') + 1);
+    return prefix;
+}
+
 void readFileWithStrictnessOverrides(unique_ptr<core::GlobalState> &gs, core::FileRef file,
                                      const options::Options &opts) {
     if (file.dataAllowingUnsafe(*gs).sourceType != core::File::NotYetRead) {
@@ -424,7 +680,7 @@ void readFileWithStrictnessOverrides(unique_ptr<core::GlobalState> &gs, core::Fi
     string src;
     bool fileFound = true;
     try {
-        src = opts.fs->readFile(fileName);
+        src = readUnlessIgnored(*gs, fileName, opts);
     } catch (FileNotFoundException e) {
         // continue with an empty source, because the
         // assertion below requires every input file to map
@@ -464,6 +720,7 @@ struct IndexResult {
     unique_ptr<core::GlobalState> gs;
     vector<ast::ParsedFile> trees;
     vector<shared_ptr<core::File>> pluginGeneratedFiles;
+    plugin::SubprocessTextPlugin::CacheEntries pluginCacheEntries;
 };
 
 struct IndexThreadResultPack {
@@ -487,7 +744,8 @@ IndexResult mergeIndexResults(const shared_ptr<core::GlobalState> cgs, const opt
                 ENFORCE(ret.trees.empty());
                 ret.trees = move(threadResult.res.trees);
                 ret.pluginGeneratedFiles = move(threadResult.res.pluginGeneratedFiles);
-                cacheTrees(*ret.gs, kvstore, ret.trees);
+                cacheTrees(opts, *ret.gs, kvstore, ret.trees);
+                plugin::SubprocessTextPlugin::cacheOutputs(kvstore, threadResult.res.pluginCacheEntries);
             } else {
                 core::GlobalSubstitution substitution(*threadResult.res.gs, *ret.gs, cgs.get());
                 core::MutableContext ctx(*ret.gs, core::Symbols::root());
@@ -501,7 +759,8 @@ IndexResult mergeIndexResults(const shared_ptr<core::GlobalState> cgs, const opt
                         }
                     }
                 }
-                cacheTrees(*ret.gs, kvstore, threadResult.res.trees);
+                cacheTrees(opts, *ret.gs, kvstore, threadResult.res.trees);
+                plugin::SubprocessTextPlugin::cacheOutputs(kvstore, threadResult.res.pluginCacheEntries);
                 ret.trees.insert(ret.trees.end(), make_move_iterator(threadResult.res.trees.begin()),
                                  make_move_iterator(threadResult.res.trees.end()));
 
@@ -517,7 +776,8 @@ IndexResult mergeIndexResults(const shared_ptr<core::GlobalState> cgs, const opt
 }
 
 IndexResult indexSuppliedFiles(const shared_ptr<core::GlobalState> &baseGs, vector<core::FileRef> &files,
-                               const options::Options &opts, WorkerPool &workers, unique_ptr<KeyValueStore> &kvstore) {
+                               const options::Options &opts, WorkerPool &workers, unique_ptr<KeyValueStore> &kvstore,
+                               const TreeDictionary &dictionary) {
     Timer timeit(baseGs->tracer(), "indexSuppliedFiles");
     auto resultq = make_shared<BlockingBoundedQueue<IndexThreadResultPack>>(files.size());
     auto fileq = make_shared<ConcurrentBoundedQueue<core::FileRef>>(files.size());
@@ -525,7 +785,7 @@ IndexResult indexSuppliedFiles(const shared_ptr<core::GlobalState> &baseGs, vect
         fileq->push(move(file), 1);
     }
 
-    workers.multiplexJob("indexSuppliedFiles", [baseGs, &opts, fileq, resultq, &kvstore]() {
+    workers.multiplexJob("indexSuppliedFiles", [baseGs, &opts, fileq, resultq, &kvstore, &dictionary]() {
         Timer timeit(baseGs->tracer(), "indexSuppliedFilesWorker");
         unique_ptr<core::GlobalState> localGs = baseGs->deepCopy();
         IndexThreadResultPack threadResult;
@@ -536,7 +796,8 @@ IndexResult indexSuppliedFiles(const shared_ptr<core::GlobalState> &baseGs, vect
                 if (result.gotItem()) {
                     core::FileRef file = job;
                     readFileWithStrictnessOverrides(localGs, file, opts);
-                    auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, *localGs, file, kvstore);
+                    auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, *localGs, file, kvstore, dictionary,
+                                                                         threadResult.res.pluginCacheEntries);
                     threadResult.res.pluginGeneratedFiles.insert(threadResult.res.pluginGeneratedFiles.end(),
                                                                  make_move_iterator(pluginFiles.begin()),
                                                                  make_move_iterator(pluginFiles.end()));
@@ -557,7 +818,7 @@ IndexResult indexSuppliedFiles(const shared_ptr<core::GlobalState> &baseGs, vect
 }
 
 IndexResult indexPluginFiles(IndexResult firstPass, const options::Options &opts, WorkerPool &workers,
-                             unique_ptr<KeyValueStore> &kvstore) {
+                             unique_ptr<KeyValueStore> &kvstore, const TreeDictionary &dictionary) {
     if (firstPass.pluginGeneratedFiles.empty()) {
         return firstPass;
     }
@@ -572,7 +833,7 @@ IndexResult indexPluginFiles(IndexResult firstPass, const options::Options &opts
         }
     }
     const shared_ptr<core::GlobalState> protoGs = move(firstPass.gs);
-    workers.multiplexJob("indexPluginFiles", [protoGs, &opts, pluginFileq, resultq, &kvstore]() {
+    workers.multiplexJob("indexPluginFiles", [protoGs, &opts, pluginFileq, resultq, &kvstore, &dictionary]() {
         Timer timeit(protoGs->tracer(), "indexPluginFilesWorker");
         auto localGs = protoGs->deepCopy();
         IndexThreadResultPack threadResult;
@@ -582,7 +843,7 @@ IndexResult indexPluginFiles(IndexResult firstPass, const options::Options &opts
             if (result.gotItem()) {
                 core::FileRef file = job;
                 file.data(*localGs).strictLevel = decideStrictLevel(*localGs, file, opts);
-                threadResult.res.trees.emplace_back(indexOne(opts, *localGs, file, kvstore));
+                threadResult.res.trees.emplace_back(indexOne(opts, *localGs, file, kvstore, dictionary));
             }
         }
 
@@ -629,12 +890,16 @@ vector<ast::ParsedFile> index(unique_ptr<core::GlobalState> &gs, vector<core::Fi
 
     gs->sanityCheck();
 
+    // Trees that this run caches may use a dictionary trained along the way, but that one has nothing to find yet.
+    const auto dictionary = readTreeDictionary(kvstore);
     if (files.size() < 3) {
         // Run singlethreaded if only using 2 files
         size_t pluginFileCount = 0;
+        plugin::SubprocessTextPlugin::CacheEntries pluginCacheEntries;
         for (auto file : files) {
             readFileWithStrictnessOverrides(gs, file, opts);
-            auto [parsedFile, pluginFiles] = indexOneWithPlugins(opts, *gs, file, kvstore);
+            auto [parsedFile, pluginFiles] =
+                indexOneWithPlugins(opts, *gs, file, kvstore, dictionary, pluginCacheEntries);
             ret.emplace_back(move(parsedFile));
             pluginFileCount += pluginFiles.size();
             for (auto &pluginFile : pluginFiles) {
@@ -644,14 +909,15 @@ vector<ast::ParsedFile> index(unique_ptr<core::GlobalState> &gs, vector<core::Fi
                     pluginFileRef = gs->enterFile(pluginFile);
                     pluginFileRef.data(*gs).strictLevel = decideStrictLevel(*gs, pluginFileRef, opts);
                 }
-                ret.emplace_back(indexOne(opts, *gs, pluginFileRef, kvstore));
+                ret.emplace_back(indexOne(opts, *gs, pluginFileRef, kvstore, dictionary));
             }
-            cacheTrees(*gs, kvstore, ret);
+            cacheTrees(opts, *gs, kvstore, ret);
+            plugin::SubprocessTextPlugin::cacheOutputs(kvstore, pluginCacheEntries);
         }
         ENFORCE(files.size() + pluginFileCount == ret.size());
     } else {
-        auto firstPass = indexSuppliedFiles(move(gs), files, opts, workers, kvstore);
-        auto pluginPass = indexPluginFiles(move(firstPass), opts, workers, kvstore);
+        auto firstPass = indexSuppliedFiles(move(gs), files, opts, workers, kvstore, dictionary);
+        auto pluginPass = indexPluginFiles(move(firstPass), opts, workers, kvstore, dictionary);
         gs = move(pluginPass.gs);
         ret = move(pluginPass.trees);
     }
@@ -663,10 +929,22 @@ vector<ast::ParsedFile> index(unique_ptr<core::GlobalState> &gs, vector<core::Fi
 ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts) {
     ast::ParsedFile result{make_unique<ast::EmptyTree>(), resolved.file};
     core::FileRef f = resolved.file;
-
-    resolved = definition_validator::runOne(ctx, std::move(resolved));
-
-    resolved = flatten::runOne(ctx, move(resolved));
+    core::ErrorRegion errs(ctx, f);
+
+    // Validation and flattening share one traversal, and flattening leaves the methods where typing finds them
+    // without another one.
+    definition_validator::ValidateWalk validate;
+    flatten::FlattenWalk flatten;
+    ast::FusedTransform<definition_validator::ValidateWalk, flatten::FlattenWalk, core::Context> fused(validate,
+                                                                                                     flatten);
+    {
+        Timer timeit(ctx.state.tracer(), "validateAndFlatten");
+        resolved.tree = ast::TreeMap::apply(ctx, fused, move(resolved.tree));
+        resolved.tree = flatten.addClasses(ctx, move(resolved.tree));
+        resolved.tree = flatten.addMethods(ctx, move(resolved.tree));
+    }
+    // Validating and flattening used to take a traversal each.
+    prodCounterAdd("typecheck.fused_passes.node_visits_saved", fused.nodes);
 
     if (opts.print.FlattenedTree.enabled) {
         opts.print.FlattenedTree.fmt("{}\n", resolved.tree->toString(ctx));
@@ -688,10 +966,10 @@ ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const
             opts.print.CFG.fmt("digraph \"{}\" {{\n", FileOps::getFileName(f.data(ctx).path()));
         }
         CFGCollectorAndTyper collector(opts);
-        {
-            core::ErrorRegion errs(ctx, f);
-            result.tree = ast::TreeMap::apply(ctx, collector, move(resolved.tree));
-        }
+        collector.typecheck(ctx, resolved.tree.get());
+        result.tree = move(resolved.tree);
+        // Typing used to take a traversal of the whole tree too.
+        prodCounterAdd("typecheck.fused_passes.node_visits_saved", fused.nodes - min(fused.nodes, collector.visited));
         if (opts.print.CFG.enabled) {
             opts.print.CFG.fmt("}}\n\n");
         }
@@ -723,6 +1001,9 @@ vector<ast::ParsedFile> name(core::GlobalState &gs, vector<ast::ParsedFile> what
 
         int i = 0;
         for (auto &tree : what) {
+            if (gs.wasTypecheckingCanceled()) {
+                return what;
+            }
             auto file = tree.file;
             try {
                 ast::ParsedFile ast;
@@ -751,9 +1032,8 @@ vector<ast::ParsedFile> name(core::GlobalState &gs, vector<ast::ParsedFile> what
 class GatherUnresolvedConstantsWalk {
 public:
     vector<string> unresolvedConstants;
-    unique_ptr<ast::Expression> postTransformConstantLit(core::MutableContext ctx,
-                                                         unique_ptr<ast::ConstantLit> original) {
-        auto unresolvedPath = original->fullUnresolvedPath(ctx);
+    void postWalkConstantLit(core::Context ctx, const ast::ConstantLit &original) {
+        auto unresolvedPath = original.fullUnresolvedPath(ctx);
         if (unresolvedPath.has_value()) {
             unresolvedConstants.emplace_back(fmt::format(
                 "{}::{}",
@@ -761,17 +1041,16 @@ public:
                 fmt::map_join(unresolvedPath->second,
                               "::", [&](const auto &el) -> string { return el.data(ctx)->show(ctx); })));
         }
-        return original;
     }
 };
 
 vector<ast::ParsedFile> printMissingConstants(core::GlobalState &gs, const options::Options &opts,
                                               vector<ast::ParsedFile> what) {
     Timer timeit(gs.tracer(), "printMissingConstants");
-    core::MutableContext ctx(gs, core::Symbols::root());
+    core::Context ctx(gs, core::Symbols::root());
     GatherUnresolvedConstantsWalk walk;
     for (auto &resolved : what) {
-        resolved.tree = ast::TreeMap::apply(ctx, walk, move(resolved.tree));
+        ast::TreeWalk::apply(ctx, walk, resolved.tree.get());
     }
     fast_sort(walk.unresolvedConstants);
     opts.print.MissingConstants.fmt("{}\n", fmt::join(walk.unresolvedConstants, "\n"));
@@ -782,6 +1061,7 @@ vector<ast::ParsedFile> resolve(unique_ptr<core::GlobalState> &gs, vector<ast::P
                                 const options::Options &opts, WorkerPool &workers, bool skipConfigatron) {
     try {
         what = name(*gs, move(what), opts, skipConfigatron);
+        MemoryReport::phaseDone(opts, "name");
 
         for (auto &named : what) {
             if (opts.print.NameTree.enabled) {
@@ -792,7 +1072,7 @@ vector<ast::ParsedFile> resolve(unique_ptr<core::GlobalState> &gs, vector<ast::P
             }
         }
 
-        if (opts.stopAfterPhase == options::Phase::NAMER) {
+        if (opts.stopAfterPhase == options::Phase::NAMER || gs->wasTypecheckingCanceled()) {
             return what;
         }
 
@@ -877,6 +1157,10 @@ vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast:
                     for (auto result = fileq->try_pop(job); !result.done(); result = fileq->try_pop(job)) {
                         if (result.gotItem()) {
                             processedByThread++;
+                            if (ctx.state.wasTypecheckingCanceled()) {
+                                // Keep draining the queue so that the main thread gets a result for every file.
+                                continue;
+                            }
                             core::FileRef file = job.file;
                             try {
                                 threadResult.trees.emplace_back(typecheckOne(ctx, move(job), opts));
@@ -953,15 +1237,14 @@ vector<ast::ParsedFile> typecheck(unique_ptr<core::GlobalState> &gs, vector<ast:
 class AllSendsCollector {
 public:
     core::UsageHash acc;
-    unique_ptr<ast::Send> preTransformSend(core::Context ctx, unique_ptr<ast::Send> original) {
-        acc.usages.emplace_back(ctx.state, original->fun.data(ctx));
-        return original;
+    void preWalkSend(core::Context ctx, const ast::Send &original) {
+        acc.usages.emplace_back(ctx.state, original.fun.data(ctx));
     }
 };
 
-core::UsageHash getAllSends(const core::GlobalState &gs, unique_ptr<ast::Expression> &tree) {
+core::UsageHash getAllSends(const core::GlobalState &gs, const ast::Expression *tree) {
     AllSendsCollector collector;
-    tree = ast::TreeMap::apply(core::Context(gs, core::Symbols::root()), collector, move(tree));
+    ast::TreeWalk::apply(core::Context(gs, core::Symbols::root()), collector, tree);
     fast_sort(collector.acc.usages);
     collector.acc.usages.resize(std::distance(collector.acc.usages.begin(),
                                               std::unique(collector.acc.usages.begin(), collector.acc.usages.end())));
@@ -992,11 +1275,392 @@ core::FileHash computeFileHash(shared_ptr<core::File> forWhat, spdlog::logger &l
             return {move(invalid), {}};
         }
     }
-    auto allSends = getAllSends(*lgs, single[0].tree);
+    auto allSends = getAllSends(*lgs, single[0].tree.get());
     auto workers = WorkerPool::create(0, lgs->tracer());
     pipeline::resolve(lgs, move(single), emptyOpts, *workers, true);
 
     return {move(*lgs->hash()), move(allSends)};
 }
 
+class MethodNamesCollector {
+public:
+    vector<core::NameHash> names;
+    void preWalkSend(core::Context ctx, const ast::Send &original) {
+        names.emplace_back(ctx.state, original.fun.data(ctx));
+    }
+    void preWalkMethodDef(core::Context ctx, const ast::MethodDef &original) {
+        // Overrides are checked against the methods of the same name in parents.
+        names.emplace_back(ctx.state, original.name.data(ctx));
+    }
+};
+
+core::TypecheckRecord dependenciesOf(const core::GlobalState &gs, const ast::ParsedFile &resolved,
+                                     const core::GlobalStateHash &hash) {
+    MethodNamesCollector collector;
+    ast::TreeWalk::apply(core::Context(gs, core::Symbols::root()), collector, resolved.tree.get());
+    fast_sort(collector.names);
+    collector.names.erase(unique(collector.names.begin(), collector.names.end()), collector.names.end());
+
+    core::TypecheckRecord record;
+    record.hierarchyHash = hash.hierarchyHash;
+    for (auto name : collector.names) {
+        auto methodHash = hash.methodHashes.find(name);
+        record.methodHashes.emplace_back(name, methodHash == hash.methodHashes.end() ? 0 : methodHash->second);
+    }
+    return record;
+}
+
+bool isUpToDate(const core::GlobalState &gs, const core::TypecheckRecord &record, const core::GlobalStateHash &hash) {
+    if (record.hierarchyHash != hash.hierarchyHash) {
+        return false;
+    }
+    for (auto &[name, methodHash] : record.methodHashes) {
+        auto current = hash.methodHashes.find(name);
+        if ((current == hash.methodHashes.end() ? 0 : current->second) != methodHash) {
+            return false;
+        }
+    }
+    for (auto &[path, fileHash] : record.referencedFiles) {
+        auto file = gs.findFileByPath(path);
+        if (!file.exists() || contentHash(gs, file) != fileHash) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void replayErrors(core::GlobalState &gs, core::FileRef file, const core::TypecheckRecord &record) {
+    for (auto &cached : record.errors) {
+        // Files the errors point into are among the referenced files, so they still exist.
+        auto errorFile = cached.path.empty() ? file : gs.findFileByPath(cached.path);
+        auto error = make_unique<core::Error>(core::Loc(errorFile, cached.beginPos, cached.endPos),
+                                              core::ErrorClass(cached.code, (core::StrictLevel)cached.minLevel),
+                                              cached.header, vector<core::ErrorSection>(),
+                                              vector<core::AutocorrectSuggestion>(), false);
+        gs.errorQueue->pushCachedError(move(error), cached.text);
+    }
+    gs.errorQueue->markFileForFlushing(file);
+}
+
+vector<ast::ParsedFile> typecheckIncrementally(unique_ptr<core::GlobalState> &gs, vector<ast::ParsedFile> what,
+                                               const options::Options &opts, WorkerPool &workers,
+                                               unique_ptr<KeyValueStore> &kvstore, string_view configKey) {
+    Timer timeit(gs->tracer(), "typecheckIncrementally");
+    auto hash = gs->hash();
+    vector<ast::ParsedFile> result;
+    vector<ast::ParsedFile> toTypecheck;
+    UnorderedMap<core::FileRef, pair<string, core::TypecheckRecord>> records;
+    for (auto &resolved : what) {
+        // The strictness a file is checked at may come from outside it, so it's part of the key too.
+        auto key = absl::StrCat("typecheck//", configKey, "//", (int)resolved.file.data(*gs).strictLevel, "//",
+                                fileKey(*gs, resolved.file));
+        if (auto cached = kvstore->read(key)) {
+            auto record = core::serialize::Serializer::loadTypecheckRecord(cached);
+            if (isUpToDate(*gs, record, *hash)) {
+                prodCounterInc("types.input.files.typecheck_cache.hit");
+                replayErrors(*gs, resolved.file, record);
+                result.emplace_back(move(resolved));
+                continue;
+            }
+        }
+        prodCounterInc("types.input.files.typecheck_cache.miss");
+        records[resolved.file] = make_pair(move(key), dependenciesOf(*gs, resolved, *hash));
+        toTypecheck.emplace_back(move(resolved));
+    }
+    gs->errorQueue->flushErrors();
+
+    bool hadCriticalError = false;
+    gs->errorQueue->observeFlushedErrors([&](const core::ErrorQueueMessage &msg) {
+        auto &error = *msg.error;
+        hadCriticalError = hadCriticalError || error.isCritical();
+        // An error belongs to the file that was being typechecked when it was reported, wherever it points.
+        auto fnd = records.find(msg.regionFile);
+        if (fnd == records.end() || error.isSilenced || !msg.whatFile.exists()) {
+            return;
+        }
+        auto &record = fnd->second.second;
+        string path;
+        if (msg.whatFile != msg.regionFile) {
+            path = string(msg.whatFile.data(*gs).path());
+            record.referencedFiles.emplace_back(path, contentHash(*gs, msg.whatFile));
+        }
+        record.errors.push_back({error.what.code, (u1)error.what.minLevel, move(path), error.loc.beginPos(),
+                                 error.loc.endPos(), error.header, msg.text});
+        for (auto &section : error.sections) {
+            for (auto &line : section.messages) {
+                auto other = line.loc.file();
+                if (other.exists() && other != msg.regionFile) {
+                    record.referencedFiles.emplace_back(other.data(*gs).path(), contentHash(*gs, other));
+                }
+            }
+        }
+    });
+    auto typechecked = typecheck(gs, move(toTypecheck), opts, workers);
+    // Some errors are only flushed at the very end. They have to be seen here.
+    gs->errorQueue->flushErrors(true);
+    gs->errorQueue->observeFlushedErrors(nullptr);
+
+    // A crash leaves the errors of a file incomplete.
+    if (!hadCriticalError) {
+        for (auto &[file, keyAndRecord] : records) {
+            auto &[key, record] = keyAndRecord;
+            fast_sort(record.referencedFiles);
+            record.referencedFiles.erase(unique(record.referencedFiles.begin(), record.referencedFiles.end()),
+                                         record.referencedFiles.end());
+            kvstore->write(key, core::serialize::Serializer::storeTypecheckRecord(record));
+        }
+    }
+
+    result.insert(result.end(), make_move_iterator(typechecked.begin()), make_move_iterator(typechecked.end()));
+    return result;
+}
+
+namespace {
+void writeToParent(int toParent, string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = ::write(toParent, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Nobody is left to report to.
+            _exit(1);
+        }
+        data.remove_prefix(written);
+    }
+}
+
+/**
+ * Runs in a process forked after resolve. Typechecks `shard` and sends the parent, in this order:
+ * - `errors <file id> <length>\n` and a `TypecheckRecord` with the errors reported for that file, if there are any
+ * - `done <file id>\n` for every typechecked file
+ * - `counters <length>\n` and the counters of this process, at the end
+ */
+[[noreturn]] void runTypecheckProcess(core::GlobalState &gs, vector<ast::ParsedFile> &what, const vector<int> &shard,
+                                      const options::Options &opts, int toParent) {
+    // These were counted by the parent already.
+    getAndClearThreadCounters();
+    gs.errorQueue->ignoreFlushes = true;
+    core::Context ctx(gs, core::Symbols::root());
+    for (auto i : shard) {
+        core::FileRef file = what[i].file;
+        try {
+            typecheckOne(ctx, move(what[i]), opts);
+        } catch (SorbetException &) {
+            Exception::failInFuzzer();
+            gs.tracer().error("Exception typing file: {} (backtrace is above)", file.data(gs).path());
+        }
+        UnorderedMap<core::FileRef, core::TypecheckRecord> errorsByFile;
+        for (auto &error : gs.errorQueue->drainAllErrors()) {
+            if (error->isSilenced) {
+                continue;
+            }
+            errorsByFile[error->loc.file()].errors.push_back({error->what.code, (u1)error->what.minLevel, "",
+                                                              error->loc.beginPos(), error->loc.endPos(),
+                                                              error->header, error->toString(gs)});
+        }
+        for (auto &[errorFile, record] : errorsByFile) {
+            auto serialized = core::serialize::Serializer::storeTypecheckRecord(record);
+            writeToParent(toParent, fmt::format("errors {} {}\n", errorFile.id(), serialized.size()));
+            writeToParent(toParent, string_view((const char *)serialized.data(), serialized.size()));
+        }
+        writeToParent(toParent, fmt::format("done {}\n", file.id()));
+    }
+    auto counters = getAndClearThreadCountersForParent();
+    writeToParent(toParent, fmt::format("counters {}\n", counters.size()));
+    writeToParent(toParent, counters);
+    // Everything we have belongs to the parent. Don't run destructors or flush its buffered output a second time.
+    _exit(0);
+}
+
+struct TypecheckProcess {
+    pid_t pid;
+    int fromChild;
+    string buffered;
+    vector<int> shard;
+    UnorderedSet<u4> done;
+    // Errors of the file that is being typechecked. They are only reported once it is done: if the process dies before
+    // that, the file is typechecked again here, and would report them a second time.
+    vector<pair<core::FileRef, core::TypecheckRecord>> pendingErrors;
+};
+
+/** Handles the complete messages that `process` sent so far, and drops them from `process.buffered`. */
+void handleMessages(core::GlobalState &gs, TypecheckProcess &process) {
+    size_t consumed = 0;
+    while (true) {
+        auto newline = process.buffered.find('\n', consumed);
+        if (newline == string::npos) {
+            break;
+        }
+        auto line = string_view(process.buffered).substr(consumed, newline - consumed);
+        vector<string_view> header = absl::StrSplit(line, ' ');
+        u4 id;
+        size_t length;
+        if (header.size() == 2 && header[0] == "done" && absl::SimpleAtoi(header[1], &id)) {
+            process.done.insert(id);
+            for (auto &[file, record] : process.pendingErrors) {
+                for (auto &error : record.errors) {
+                    if ((core::StrictLevel)error.minLevel == core::StrictLevel::Internal) {
+                        gs.errorQueue->hadCritical = true;
+                    }
+                }
+                replayErrors(gs, file, record);
+            }
+            process.pendingErrors.clear();
+            consumed = newline + 1;
+            continue;
+        }
+        bool hasPayload = (header.size() == 3 && header[0] == "errors" && absl::SimpleAtoi(header[1], &id) &&
+                           absl::SimpleAtoi(header[2], &length)) ||
+                          (header.size() == 2 && header[0] == "counters" && absl::SimpleAtoi(header[1], &length));
+        if (!hasPayload) {
+            Exception::raise("Unexpected message from typecheck process {}: {}", process.pid, line);
+        }
+        if (process.buffered.size() < newline + 1 + length) {
+            break;
+        }
+        auto payload = string_view(process.buffered).substr(newline + 1, length);
+        if (header[0] == "counters") {
+            counterConsumeFromChild(payload);
+        } else {
+            process.pendingErrors.emplace_back(
+                core::FileRef(id), core::serialize::Serializer::loadTypecheckRecord((const u1 *)payload.data()));
+        }
+        consumed = newline + 1 + length;
+    }
+    process.buffered.erase(0, consumed);
+}
+} // namespace
+
+vector<ast::ParsedFile> typecheckInProcesses(unique_ptr<core::GlobalState> &gs, vector<ast::ParsedFile> what,
+                                             const options::Options &opts, WorkerPool &workers) {
+    Timer timeit(gs->tracer(), "typecheckInProcesses");
+    int processCount = min(opts.typecheckProcesses, (int)what.size());
+
+    // Hand out the largest files first, each to the process with the least source so far.
+    vector<int> bySize;
+    for (int i = 0; i < what.size(); i++) {
+        bySize.emplace_back(i);
+    }
+    auto sourceSize = [&](int i) -> size_t { return what[i].file.data(*gs).source().size(); };
+    fast_sort(bySize, [&](int left, int right) -> bool { return sourceSize(left) > sourceSize(right); });
+    vector<vector<int>> shards(processCount);
+    vector<size_t> shardSizes(processCount);
+    for (auto i : bySize) {
+        int smallest = 0;
+        for (int shard = 1; shard < processCount; shard++) {
+            if (shardSizes[shard] < shardSizes[smallest]) {
+                smallest = shard;
+            }
+        }
+        shards[smallest].emplace_back(i);
+        shardSizes[smallest] += sourceSize(i);
+    }
+
+    vector<TypecheckProcess> processes;
+    vector<int> typecheckHere;
+    for (auto &shard : shards) {
+        int fds[2];
+        // Close-on-exec only keeps the pipe from programs that Sorbet runs. The processes forked here don't exec.
+        if (!pipeCloseOnExec(fds)) {
+            typecheckHere.insert(typecheckHere.end(), shard.begin(), shard.end());
+            continue;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            // The read ends of the processes forked before this one, which fork copied.
+            for (auto &process : processes) {
+                close(process.fromChild);
+            }
+            runTypecheckProcess(*gs, what, shard, opts, fds[1]);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            typecheckHere.insert(typecheckHere.end(), shard.begin(), shard.end());
+            continue;
+        }
+        processes.push_back(TypecheckProcess{pid, fds[0], "", move(shard), {}});
+    }
+    prodCounterAdd("types.typecheck.processes", processes.size());
+
+    vector<TypecheckProcess *> running;
+    for (auto &process : processes) {
+        running.emplace_back(&process);
+    }
+    while (!running.empty()) {
+        vector<pollfd> fds;
+        for (auto process : running) {
+            fds.push_back({process->fromChild, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Without poll we can't tell what the processes typechecked, so nothing they did can be trusted.
+            auto pollError = errno;
+            for (auto &process : processes) {
+                kill(process.pid, SIGKILL);
+                waitpid(process.pid, nullptr, 0);
+            }
+            Exception::raise("poll failed while waiting for typecheck processes: {}", strerror(pollError));
+        }
+        vector<TypecheckProcess *> stillRunning;
+        for (int i = 0; i < fds.size(); i++) {
+            auto process = running[i];
+            if (fds[i].revents == 0) {
+                stillRunning.emplace_back(process);
+                continue;
+            }
+            array<char, 64 * 1024> chunk;
+            const ssize_t bytesRead = ::read(process->fromChild, chunk.data(), chunk.size());
+            if (bytesRead > 0) {
+                process->buffered.append(chunk.data(), bytesRead);
+                handleMessages(*gs, *process);
+                stillRunning.emplace_back(process);
+            } else if (bytesRead < 0 && errno == EINTR) {
+                stillRunning.emplace_back(process);
+            } else {
+                close(process->fromChild);
+            }
+        }
+        running = move(stillRunning);
+        gs->errorQueue->flushErrors();
+    }
+
+    // If a process died, typecheck what it didn't get to here.
+    for (auto &process : processes) {
+        int status = 0;
+        while (waitpid(process.pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            continue;
+        }
+        gs->tracer().error("Typecheck process {} failed with status {}, typechecking the rest of its files here",
+                           process.pid, status);
+        for (auto i : process.shard) {
+            if (process.done.find(what[i].file.id()) == process.done.end()) {
+                typecheckHere.emplace_back(i);
+            }
+        }
+    }
+
+    vector<ast::ParsedFile> leftOver;
+    for (auto i : typecheckHere) {
+        leftOver.emplace_back(move(what[i]));
+    }
+    vector<ast::ParsedFile> result;
+    for (auto &tree : what) {
+        if (tree.tree) {
+            result.emplace_back(move(tree));
+        }
+    }
+    if (!leftOver.empty()) {
+        auto typechecked = typecheck(gs, move(leftOver), opts, workers);
+        result.insert(result.end(), make_move_iterator(typechecked.begin()), make_move_iterator(typechecked.end()));
+    }
+    return result;
+}
+
 } // namespace sorbet::realmain::pipeline
@@ -7,17 +7,33 @@
 #include "common/kvstore/KeyValueStore.h"
 #include "core/NameHash.h"
 #include "main/options/options.h"
+#include "plugin/SubprocessTextPlugin.h"
 
 namespace sorbet::realmain::pipeline {
 ast::ParsedFile indexOne(const options::Options &opts, core::GlobalState &lgs, core::FileRef file,
                          std::unique_ptr<KeyValueStore> &kvstore);
 
-std::pair<ast::ParsedFile, std::vector<std::shared_ptr<core::File>>>
-indexOneWithPlugins(const options::Options &opts, core::GlobalState &lgs, core::FileRef file,
-                    std::unique_ptr<KeyValueStore> &kvstore);
-
 std::vector<core::FileRef> reserveFiles(std::unique_ptr<core::GlobalState> &gs, const std::vector<std::string> &files);
 
+struct TableSizes {
+    u8 inputBytes = 0;
+    u4 names = 0;
+    u4 symbols = 0;
+    u4 files = 0;
+};
+
+// Reserves room in GlobalState's tables for everything that typechecking `files` is predicted to enter, so that they
+// are resized once up front instead of while indexing and naming. The prediction scales the table sizes at the end of
+// the last run that used `kvstore` by how much the input grew since, and falls back to averages without one.
+TableSizes presizeTables(core::GlobalState &gs, const std::vector<core::FileRef> &files,
+                         const std::unique_ptr<KeyValueStore> &kvstore);
+
+// Whether the table sizes at the end of this run are too far off what `presizeTables` predicted.
+bool tablesMispredicted(const core::GlobalState &gs, const TableSizes &predicted);
+
+// Stores the current table sizes, for the next run's `presizeTables`.
+void recordTableSizes(const core::GlobalState &gs, u8 inputBytes, std::unique_ptr<KeyValueStore> &kvstore);
+
 std::vector<ast::ParsedFile> index(std::unique_ptr<core::GlobalState> &gs, std::vector<core::FileRef> files,
                                    const options::Options &opts, WorkerPool &workers,
                                    std::unique_ptr<KeyValueStore> &kvstore);
@@ -36,6 +52,19 @@ std::vector<ast::ParsedFile> typecheck(std::unique_ptr<core::GlobalState> &gs, s
 
 ast::ParsedFile typecheckOne(core::Context ctx, ast::ParsedFile resolved, const options::Options &opts);
 
+// Only typechecks the files whose contents or dependencies changed since they were last typechecked with the same
+// `configKey`, and replays the errors recorded in `kvstore` for the others.
+std::vector<ast::ParsedFile> typecheckIncrementally(std::unique_ptr<core::GlobalState> &gs,
+                                                    std::vector<ast::ParsedFile> what, const options::Options &opts,
+                                                    WorkerPool &workers, std::unique_ptr<KeyValueStore> &kvstore,
+                                                    std::string_view configKey);
+
+// Like `typecheck`, but forks `opts.typecheckProcesses` processes that share `gs` copy-on-write and each typecheck a
+// share of the files. Their errors and counters are reported back to this process.
+std::vector<ast::ParsedFile> typecheckInProcesses(std::unique_ptr<core::GlobalState> &gs,
+                                                  std::vector<ast::ParsedFile> what, const options::Options &opts,
+                                                  WorkerPool &workers);
+
 core::FileHash computeFileHash(std::shared_ptr<core::File> forWhat, spdlog::logger &logger);
 
 } // namespace sorbet::realmain::pipeline
@@ -14,7 +14,9 @@
 #include "core/lsp/QueryResponse.h"
 #include "core/serialize/serialize.h"
 #include "main/autogen/autogen.h"
+#include "main/lsp/daemon.h"
 #include "main/lsp/lsp.h"
+#include "main/pipeline/MemoryReport.h"
 #include "main/pipeline/pipeline.h"
 #include "main/realmain.h"
 #include "payload/payload.h"
@@ -242,6 +244,38 @@ void runAutogen(core::Context ctx, options::Options &opts, WorkerPool &workers,
     }
 } // namespace sorbet::realmain
 
+unique_ptr<KeyValueStore> openCache(const options::Options &opts) {
+    // Cached trees have no header of their own, so the serializer version is part of the cache's version.
+    return make_unique<KeyValueStore>(
+        absl::StrCat(Version::full_version_string, "-v", core::serialize::Serializer::VERSION), opts.cacheDir,
+        opts.skipDSLPasses ? "nodsl" : "default");
+}
+
+// Errors depend on nearly every option, and their text on whether colors are on, so `--incremental` only reuses
+// errors from runs with the same options. Besides the command line, options come from `sorbet/config`, `@file`
+// arguments and the yaml files some options name.
+string incrementalConfigKey(const options::Options &opts, int argc, char *argv[]) {
+    string key = core::ErrorColors::enabled() ? "color" : "nocolor";
+    auto appendContents = [&](string_view path) {
+        if (FileOps::exists(path)) {
+            absl::StrAppend(&key, "\n", FileOps::read(path));
+        }
+    };
+    appendContents("sorbet/config");
+    for (int i = 1; i < argc; i++) {
+        absl::StrAppend(&key, "\n", argv[i]);
+        if (argv[i][0] == '@') {
+            appendContents(argv[i] + 1);
+        }
+    }
+    for (auto &file : {opts.typedOverrideFile, opts.dslPluginsFile}) {
+        if (!file.empty()) {
+            appendContents(file);
+        }
+    }
+    return absl::StrCat(absl::Hex(std::hash<string>()(key), absl::kZeroPad16));
+}
+
 int realmain(int argc, char *argv[]) {
     absl::InitializeSymbolizer(argv[0]);
     returnCode = 0;
@@ -319,6 +353,12 @@ int realmain(int argc, char *argv[]) {
                          "or set SORBET_SILENCE_DEV_MESSAGE=1 in your shell environment.\n");
         }
     }
+    if (!opts.daemonSocket.empty() && !opts.runDaemon) {
+        auto configKey = lsp::daemonConfigKey(vector<string>(argv + 1, argv + argc));
+        if (auto exitCode = lsp::forwardToDaemon(opts, *logger, *typeErrorsConsole, configKey)) {
+            return *exitCode;
+        }
+    }
     unique_ptr<WorkerPool> workers = WorkerPool::create(opts.threads, *logger);
 
     unique_ptr<core::GlobalState> gs =
@@ -330,8 +370,7 @@ int realmain(int argc, char *argv[]) {
     logger->trace("building initial global state");
     unique_ptr<KeyValueStore> kvstore;
     if (!opts.cacheDir.empty()) {
-        kvstore = make_unique<KeyValueStore>(Version::full_version_string, opts.cacheDir,
-                                             opts.skipDSLPasses ? "nodsl" : "default");
+        kvstore = openCache(opts);
     }
     payload::createInitialGlobalState(gs, opts, kvstore);
     if (opts.silenceErrors) {
@@ -358,8 +397,10 @@ int realmain(int argc, char *argv[]) {
     for (auto &plugin : opts.dslPluginTriggers) {
         core::UnfreezeNameTable nameTableAccess(*gs);
         gs->addDslPlugin(plugin.first, plugin.second);
+        gs->dslPluginScriptHashes[plugin.second] = plugin::SubprocessTextPlugin::hashScript(plugin.second);
     }
     gs->dslRubyExtraArgs = opts.dslRubyExtraArgs;
+    gs->dslPersistentPlugins = opts.dslPersistentPlugins;
 
     logger->trace("done building initial global state");
 
@@ -371,8 +412,18 @@ int realmain(int argc, char *argv[]) {
                       "If you're developing an LSP extension to some editor, make sure to run sorbet with `-v` flag,"
                       "it will enable outputing the LSP session to stderr(`Write: ` and `Read: ` log lines)",
                       Version::full_version_string);
-        lsp::LSPLoop loop(move(gs), opts, logger, *workers, STDIN_FILENO, cout);
+        lsp::LSPLoop loop(move(gs), opts, logger, *workers, STDIN_FILENO, cout, false, false, move(kvstore));
         gs = loop.runLSP();
+    } else if (opts.runDaemon) {
+        gs->errorQueue->ignoreFlushes = true;
+        vector<string> clientArgs;
+        for (int i = 1; i < argc; i++) {
+            if (string_view(argv[i]) != "--daemon") {
+                clientArgs.emplace_back(argv[i]);
+            }
+        }
+        lsp::LSPLoop loop(move(gs), opts, logger, *workers, STDIN_FILENO, cout, false, false, move(kvstore));
+        gs = loop.runDaemon(opts.daemonSocket, lsp::daemonConfigKey(clientArgs));
     } else {
         Timer timeall(logger, "wall_time");
         vector<core::FileRef> inputFiles;
@@ -396,7 +447,10 @@ int realmain(int argc, char *argv[]) {
             }
         }
 
+        auto predictedTableSizes = pipeline::presizeTables(*gs, inputFiles, kvstore);
+        pipeline::MemoryReport::phaseDone(opts, "init");
         { indexed = pipeline::index(gs, inputFiles, opts, *workers, kvstore); }
+        pipeline::MemoryReport::phaseDone(opts, "index");
 
         payload::retainGlobalState(gs, opts, kvstore);
 
@@ -424,7 +478,30 @@ int realmain(int argc, char *argv[]) {
             runAutogen(ctx, opts, *workers, indexed);
         } else {
             indexed = pipeline::resolve(gs, move(indexed), opts, *workers);
-            indexed = pipeline::typecheck(gs, move(indexed), opts, *workers);
+            pipeline::MemoryReport::phaseDone(opts, "resolve");
+            if (opts.incremental) {
+                if (!kvstore) {
+                    // `retainGlobalState` commits the cache when it writes to it.
+                    kvstore = openCache(opts);
+                }
+                indexed = pipeline::typecheckIncrementally(gs, move(indexed), opts, *workers, kvstore,
+                                                           incrementalConfigKey(opts, argc, argv));
+                KeyValueStore::commit(move(kvstore));
+            } else if (opts.typecheckProcesses > 1) {
+                indexed = pipeline::typecheckInProcesses(gs, move(indexed), opts, *workers);
+            } else {
+                indexed = pipeline::typecheck(gs, move(indexed), opts, *workers);
+            }
+            pipeline::MemoryReport::phaseDone(opts, "typecheck");
+        }
+        pipeline::MemoryReport::print(opts, *gs, indexed);
+        if (!opts.cacheDir.empty() && !gs->hadCriticalError() &&
+            pipeline::tablesMispredicted(*gs, predictedTableSizes)) {
+            if (!kvstore) {
+                kvstore = openCache(opts);
+            }
+            pipeline::recordTableSizes(*gs, predictedTableSizes.inputBytes, kvstore);
+            KeyValueStore::commit(move(kvstore));
         }
 
         if (opts.suggestTyped) {
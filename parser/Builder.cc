@@ -206,7 +206,7 @@ public:
     }
 
     unique_ptr<Node> attrAsgn(unique_ptr<Node> receiver, const token *dot, const token *selector) {
-        core::NameRef method = gs_.enterNameUTF8(selector->string() + "=");
+        core::NameRef method = gs_.enterNameUTF8(std::string(selector->string()) + "=");
         core::Loc loc = receiver->loc.join(tokLoc(selector));
         if ((dot != nullptr) && dot->string() == "&.") {
             return make_unique<CSend>(loc, std::move(receiver), method, sorbet::parser::NodeVec());
@@ -414,7 +414,7 @@ public:
     }
 
     unique_ptr<Node> complex(const token *tok) {
-        return make_unique<Complex>(tokLoc(tok), tok->string());
+        return make_unique<Complex>(tokLoc(tok), std::string(tok->string()));
     }
 
     unique_ptr<Node> compstmt(sorbet::parser::NodeVec nodes) {
@@ -567,11 +567,11 @@ public:
     }
 
     unique_ptr<Node> float_(const token *tok) {
-        return make_unique<Float>(tokLoc(tok), tok->string());
+        return make_unique<Float>(tokLoc(tok), std::string(tok->string()));
     }
 
     unique_ptr<Node> floatComplex(const token *tok) {
-        return make_unique<Complex>(tokLoc(tok), tok->string());
+        return make_unique<Complex>(tokLoc(tok), std::string(tok->string()));
     }
 
     unique_ptr<Node> for_(const token *for_, unique_ptr<Node> iterator, const token *in_, unique_ptr<Node> iteratee,
@@ -601,7 +601,7 @@ public:
     }
 
     unique_ptr<Node> integer(const token *tok) {
-        return make_unique<Integer>(tokLoc(tok), tok->string());
+        return make_unique<Integer>(tokLoc(tok), std::string(tok->string()));
     }
 
     unique_ptr<Node> ivar(const token *tok) {
@@ -766,7 +766,7 @@ public:
     }
 
     unique_ptr<Node> nth_ref(const token *tok) {
-        return make_unique<NthRef>(tokLoc(tok), atoi(tok->string().c_str()));
+        return make_unique<NthRef>(tokLoc(tok), atoi(std::string(tok->string()).c_str()));
     }
 
     unique_ptr<Node> op_assign(unique_ptr<Node> lhs, const token *op, unique_ptr<Node> rhs) {
@@ -827,13 +827,13 @@ public:
     }
 
     unique_ptr<Node> rational(const token *tok) {
-        return make_unique<Rational>(tokLoc(tok), tok->string());
+        return make_unique<Rational>(tokLoc(tok), std::string(tok->string()));
     }
 
     unique_ptr<Node> rational_complex(const token *tok) {
         // TODO(nelhage): We're losing this information that this was marked as
         // a Rational in the source.
-        return make_unique<Complex>(tokLoc(tok), tok->string());
+        return make_unique<Complex>(tokLoc(tok), std::string(tok->string()));
     }
 
     unique_ptr<Node> regexp_compose(const token *begin, sorbet::parser::NodeVec parts, const token *end,
@@ -843,7 +843,7 @@ public:
     }
 
     unique_ptr<Node> regexp_options(const token *regopt) {
-        return make_unique<Regopt>(tokLoc(regopt), regopt->string());
+        return make_unique<Regopt>(tokLoc(regopt), std::string(regopt->string()));
     }
 
     unique_ptr<Node> rescue_body(const token *rescue, unique_ptr<Node> excList, const token *assoc,
@@ -949,15 +949,15 @@ public:
         core::Loc loc = tokLoc(oper).join(receiver->loc);
 
         if (auto *num = parser::cast_node<Integer>(receiver.get())) {
-            return make_unique<Integer>(loc, oper->string() + num->val);
+            return make_unique<Integer>(loc, std::string(oper->string()) + num->val);
         }
 
         if (oper->type() != ruby_parser::token_type::tTILDE) {
             if (auto *num = parser::cast_node<Float>(receiver.get())) {
-                return make_unique<Float>(loc, oper->string() + num->val);
+                return make_unique<Float>(loc, std::string(oper->string()) + num->val);
             }
             if (auto *num = parser::cast_node<Rational>(receiver.get())) {
-                return make_unique<Rational>(loc, oper->string() + num->val);
+                return make_unique<Rational>(loc, std::string(oper->string()) + num->val);
             }
         }
 
@@ -9,6 +9,8 @@ using namespace std;
 
 namespace sorbet::parser {
 
+thread_local Arena *Node::arena = nullptr;
+
 void Node::printTabs(fmt::memory_buffer &to, int count) const {
     int i = 0;
     while (i < count) {
@@ -1,3 +1,4 @@
+#include "common/Arena.h"
 #include "common/common.h"
 #include "core/core.h"
 #include <memory>
@@ -19,6 +20,15 @@ public:
     virtual std::string nodeName() = 0;
     core::Loc loc;
 
+    // The arena that nodes allocated on this thread come from, while an `Arena::Scope` over it is open.
+    static thread_local Arena *arena;
+    static void *operator new(size_t size) {
+        return Arena::allocate(arena, size);
+    }
+    static void operator delete(void *ptr) {
+        Arena::deallocate(ptr);
+    }
+
 protected:
     void printTabs(fmt::memory_buffer &to, int count) const;
     void printNode(fmt::memory_buffer &to, const std::unique_ptr<Node> &node, const core::GlobalState &gs,
@@ -0,0 +1,59 @@
+// Measures how fast the parser goes through a set of files, by default the payload RBIs:
+//
+//   bazel run -c opt //parser:parse_benchmark [-- <rounds> <file>...]
+//
+// Reports the best of all rounds, so that a warm cache and a fully grown name table are what is measured.
+#include "common/FileOps.h"
+#include "core/Error.h"
+#include "core/Unfreeze.h"
+#include "core/core.h"
+#include "parser/parser.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <rounds> <file>...\n";
+        return 1;
+    }
+    int rounds = max(atoi(argv[1]), 1);
+    vector<pair<string, string>> files;
+    size_t bytes = 0;
+    for (int i = 2; i < argc; i++) {
+        auto source = sorbet::FileOps::read(argv[i]);
+        bytes += source.size();
+        files.emplace_back(argv[i], move(source));
+    }
+
+    auto logger = spdlog::stderr_color_mt("parse_benchmark");
+    auto errorQueue = make_shared<sorbet::core::ErrorQueue>(*logger, *logger);
+    sorbet::core::GlobalState gs(errorQueue);
+    gs.initEmpty();
+    sorbet::core::UnfreezeNameTable nameTableAccess(gs);
+    sorbet::core::UnfreezeFileTable fileTableAccess(gs);
+
+    // Files are entered once, so that only parsing is timed.
+    vector<sorbet::core::FileRef> refs;
+    for (auto &[path, source] : files) {
+        refs.emplace_back(gs.enterFile(path, source));
+    }
+
+    chrono::duration<double> best = chrono::duration<double>::max();
+    for (int round = 0; round < rounds; round++) {
+        auto start = chrono::steady_clock::now();
+        for (auto file : refs) {
+            sorbet::parser::Parser::run(gs, file);
+        }
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start));
+        errorQueue->drainAllErrors();
+    }
+
+    auto megabytes = bytes / (1024.0 * 1024.0);
+    cout << fmt::format("parsed {} files, {:.2f} MB, in {:.1f} ms: {:.1f} MB/s\n", files.size(), megabytes,
+                        best.count() * 1000, megabytes / best.count());
+    return 0;
+}
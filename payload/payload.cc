@@ -16,7 +16,7 @@ constexpr string_view GLOBAL_STATE_KEY = "GlobalState"sv;
 void createInitialGlobalState(unique_ptr<core::GlobalState> &gs, const realmain::options::Options &options,
                               unique_ptr<KeyValueStore> &kvstore) {
     if (kvstore) {
-        auto maybeGsBytes = kvstore->read(GLOBAL_STATE_KEY);
+        auto maybeGsBytes = kvstore->readPinned(GLOBAL_STATE_KEY);
         if (maybeGsBytes) {
             Timer timeit(gs->tracer(), "read_global_state.kvstore");
             core::serialize::Serializer::loadGlobalState(*gs, maybeGsBytes);
@@ -62,7 +62,7 @@ void retainGlobalState(unique_ptr<core::GlobalState> &gs, const realmain::option
                        unique_ptr<KeyValueStore> &kvstore) {
     if (kvstore && gs->wasModified() && !gs->hadCriticalError()) {
         Timer timeit(gs->tracer(), "write_global_state.kvstore");
-        kvstore->write(GLOBAL_STATE_KEY, core::serialize::Serializer::storePayloadAndNameTable(*gs));
+        kvstore->writePinned(GLOBAL_STATE_KEY, core::serialize::Serializer::storePayloadAndNameTable(*gs));
         KeyValueStore::commit(move(kvstore));
     }
 }
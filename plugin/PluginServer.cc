@@ -0,0 +1,105 @@
+#include "plugin/PluginServer.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "common/Counters.h"
+#include "common/Subprocess.h"
+
+using namespace std;
+
+namespace sorbet::plugin {
+
+namespace {
+
+class IdleServers {
+    absl::Mutex mtx;
+    // Keyed by the whole command line, since that's what identifies a server.
+    UnorderedMap<string, vector<unique_ptr<PersistentSubprocess>>> idle;
+
+public:
+    unique_ptr<PersistentSubprocess> take(const string &key) {
+        absl::MutexLock lck(&mtx);
+        auto it = idle.find(key);
+        if (it == idle.end() || it->second.empty()) {
+            return nullptr;
+        }
+        auto server = move(it->second.back());
+        it->second.pop_back();
+        return server;
+    }
+
+    void giveBack(const string &key, unique_ptr<PersistentSubprocess> server) {
+        absl::MutexLock lck(&mtx);
+        idle[key].emplace_back(move(server));
+    }
+};
+
+IdleServers &idleServers() {
+    static IdleServers servers;
+    return servers;
+}
+
+void appendField(string &batch, string_view field) {
+    absl::StrAppend(&batch, field.size(), "\n", field);
+}
+
+// Returns false if the server can't be used anymore. Replies that were read before that are kept.
+bool runBatch(PersistentSubprocess &server, const vector<PluginRequest> &requests,
+              vector<optional<string>> &outputs) {
+    string batch = absl::StrCat(requests.size(), "\n");
+    for (auto &request : requests) {
+        appendField(batch, request.className);
+        appendField(batch, request.method);
+        appendField(batch, request.source);
+    }
+    if (!server.write(batch)) {
+        return false;
+    }
+    for (auto &output : outputs) {
+        auto header = server.readLine();
+        int64_t length;
+        if (!header || !absl::SimpleAtoi(*header, &length) || length < -1) {
+            return false;
+        }
+        if (length == -1) {
+            continue;
+        }
+        output = server.read(length);
+        if (!output) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+vector<optional<string>> PluginServerPool::run(const vector<string> &rubyExtraArgs, string_view command,
+                                               const vector<PluginRequest> &requests) {
+    vector<optional<string>> outputs(requests.size());
+    vector<string> args(rubyExtraArgs);
+    args.emplace_back(command);
+    args.emplace_back("--server");
+    auto key = absl::StrJoin(args, "\n");
+
+    auto server = idleServers().take(key);
+    if (!server) {
+        server = PersistentSubprocess::spawn("ruby", move(args));
+        if (!server) {
+            return outputs;
+        }
+        prodCounterInc("plugin.servers.spawned");
+    }
+    prodCounterInc("plugin.servers.batches");
+    prodCounterAdd("plugin.servers.calls", requests.size());
+    if (runBatch(*server, requests, outputs)) {
+        idleServers().giveBack(key, move(server));
+    } else {
+        // The server died or broke the protocol. Drop it; the next batch starts a fresh one.
+        prodCounterInc("plugin.servers.failed");
+    }
+    return outputs;
+}
+
+} // namespace sorbet::plugin
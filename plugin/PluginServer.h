@@ -0,0 +1,42 @@
+#ifndef SORBET_PLUGIN_PLUGIN_SERVER_H
+#define SORBET_PLUGIN_PLUGIN_SERVER_H
+
+#include "common/common.h"
+
+namespace sorbet::plugin {
+
+struct PluginRequest {
+    std::string className;
+    std::string method;
+    std::string source;
+};
+
+/**
+ * Runs DSL plugins that are listed under `persistent_plugins` in the plugin configuration. Those are started once as
+ * `ruby <ruby_extra_args> <command> --server` and then answer every call site of a file in one round trip.
+ *
+ * The protocol is length-prefixed, so that sources can contain anything. Sorbet writes a batch as
+ *
+ *     <number of calls>\n
+ *     <length>\n<class name><length>\n<method name><length>\n<source of the send>
+ *     ... repeated for every call
+ *
+ * and the plugin answers each call in order with either `<length>\n<generated code>`, or `-1\n` if the call failed.
+ * The plugin exits when its stdin is closed.
+ *
+ * Each command gets its own pool of servers. A thread takes an idle server, or starts a new one when they are all
+ * busy, so there are never more servers for a command than threads running plugins.
+ */
+class PluginServerPool final {
+public:
+    // Returns the generated code for each request, or nullopt for requests that failed.
+    static std::vector<std::optional<std::string>> run(const std::vector<std::string> &rubyExtraArgs,
+                                                       std::string_view command,
+                                                       const std::vector<PluginRequest> &requests);
+
+    PluginServerPool() = delete;
+};
+
+} // namespace sorbet::plugin
+
+#endif // SORBET_PLUGIN_PLUGIN_SERVER_H
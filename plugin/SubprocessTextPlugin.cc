@@ -1,13 +1,21 @@
 #include "plugin/SubprocessTextPlugin.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 #include "ast/treemap/treemap.h"
+#include "common/Counters.h"
+#include "common/FileOps.h"
 #include "common/Subprocess.h"
+#include "common/crypto_hashing/crypto_hashing.h"
+#include "plugin/PluginServer.h"
 #include "core/errors/plugin.h"
 
 using namespace std;
 
 namespace sorbet::plugin {
 
+namespace {
+
 struct Namespace {
     enum NamespaceType { Class, Module };
     NamespaceType type;
@@ -41,12 +49,44 @@ private:
     }
 };
 
+struct PluginCall {
+    core::Loc loc;
+    string_view command;
+    PluginRequest request;
+    // The generated code is wrapped in the nesting of the call site.
+    string nestingPrologue;
+    int nestingDepth;
+};
+
 struct SpawningWalker {
-    vector<shared_ptr<core::File>> subprocessResults;
+    vector<PluginCall> calls;
     InlinedVector<Namespace, 5> nesting;
 
     SpawningWalker() {}
 
+    string nestingPrologue(core::Context ctx) {
+        fmt::memory_buffer prologue;
+        for (auto &n : nesting) {
+            if (!n.components.empty() && n.components.back() == core::Names::singleton()) {
+                format_to(prologue, "{}", "class << self;");
+            } else {
+                bool first = true;
+                format_to(prologue, "{}", (n.type == Namespace::Class ? "class " : "module "));
+                for (auto it = n.components.rbegin(); it != n.components.rend(); it++) {
+                    if (!first) {
+                        format_to(prologue, "{}", "::");
+                    }
+                    first = false;
+                    if (auto &name = *it; name != core::Names::Constants::Root()) {
+                        format_to(prologue, "{}", name.data(ctx)->shortName(ctx));
+                    }
+                }
+                format_to(prologue, "{}", ';');
+            }
+        }
+        return fmt::to_string(prologue);
+    }
+
     unique_ptr<ast::ClassDef> preTransformClassDef(core::Context ctx, unique_ptr<ast::ClassDef> klass) {
         if (klass->symbol == core::Symbols::root()) {
             return klass;
@@ -62,59 +102,10 @@ struct SpawningWalker {
                 continue;
             }
 
-            optional<string> output;
-            {
-                string className = klass->name->loc.source(ctx);
-                string_view shortName = send->fun.data(ctx)->shortName(ctx);
-                string sendSource = send->loc.source(ctx);
-
-                vector<string> args(ctx.state.dslRubyExtraArgs);
-                args.emplace_back(*command);
-                args.emplace_back("--class");
-                args.emplace_back(move(className));
-                args.emplace_back("--method");
-                args.emplace_back(shortName);
-                args.emplace_back("--source");
-                args.emplace_back(move(sendSource));
-
-                output = Subprocess::spawn("ruby", move(args));
-            }
-
-            if (output) {
-                fmt::memory_buffer generatedSource;
-                for (auto &n : nesting) {
-                    if (!n.components.empty() && n.components.back() == core::Names::singleton()) {
-                        format_to(generatedSource, "{}", "class << self;");
-                    } else {
-                        bool first = true;
-                        format_to(generatedSource, "{}", (n.type == Namespace::Class ? "class " : "module "));
-                        for (auto it = n.components.rbegin(); it != n.components.rend(); it++) {
-                            if (!first) {
-                                format_to(generatedSource, "{}", "::");
-                            }
-                            first = false;
-                            if (auto &name = *it; name != core::Names::Constants::Root()) {
-                                format_to(generatedSource, "{}", name.data(ctx)->shortName(ctx));
-                            }
-                        }
-                        format_to(generatedSource, "{}", ';');
-                    }
-                }
-                format_to(generatedSource, "\n{}", *output);
-                for (int i = 0; i < nesting.size(); i++) {
-                    format_to(generatedSource, "{}", "end;");
-                }
-
-                auto path = fmt::format("{}//plugin-generated|{}", klass->loc.file().data(ctx).path(),
-                                        subprocessResults.size());
-                auto file = make_shared<core::File>(move(path), fmt::to_string(generatedSource), core::File::Normal);
-                file->pluginGenerated = true;
-                subprocessResults.emplace_back(move(file));
-            } else {
-                if (auto e = ctx.state.beginError(send->loc, core::errors::Plugin::SubProcessError)) {
-                    e.setHeader("Error while executing subprocess plugin `{}`", *command);
-                }
-            }
+            PluginRequest request{klass->name->loc.source(ctx), string(send->fun.data(ctx)->shortName(ctx)),
+                                  send->loc.source(ctx)};
+            calls.emplace_back(
+                PluginCall{send->loc, *command, move(request), nestingPrologue(ctx), (int)nesting.size()});
         }
         return klass;
     }
@@ -127,14 +118,145 @@ struct SpawningWalker {
     }
 };
 
+optional<string> spawnOnce(core::Context ctx, const PluginCall &call) {
+    vector<string> args(ctx.state.dslRubyExtraArgs);
+    args.emplace_back(call.command);
+    args.emplace_back("--class");
+    args.emplace_back(call.request.className);
+    args.emplace_back("--method");
+    args.emplace_back(call.request.method);
+    args.emplace_back("--source");
+    args.emplace_back(call.request.source);
+    return Subprocess::spawn("ruby", move(args));
+}
+
+string cacheKey(core::Context ctx, const PluginCall &call) {
+    string contents;
+    auto scriptHash = ctx.state.dslPluginScriptHashes.find(call.command);
+    if (scriptHash != ctx.state.dslPluginScriptHashes.end()) {
+        contents = scriptHash->second;
+    }
+    // Length-prefix every part, so that no two calls hash the same text.
+    for (auto &arg : ctx.state.dslRubyExtraArgs) {
+        absl::StrAppend(&contents, arg.size(), ":", arg);
+    }
+    absl::StrAppend(&contents, call.command.size(), ":", call.command, call.request.className.size(), ":",
+                    call.request.className, call.request.method.size(), ":", call.request.method,
+                    call.request.source.size(), ":", call.request.source);
+    auto hashBytes = crypto_hashing::hash64(contents);
+    return absl::StrCat("plugin//", absl::BytesToHexString(string_view{(char *)hashBytes.data(), size(hashBytes)}));
+}
+
+// Persistent plugins get every call site of the file in one batch. Other plugins are spawned once per call site.
+vector<optional<string>> runCalls(core::Context ctx, const vector<PluginCall> &calls,
+                                  const unique_ptr<KeyValueStore> &kvstore,
+                                  SubprocessTextPlugin::CacheEntries &newCacheEntries) {
+    vector<optional<string>> outputs(calls.size());
+    vector<string> keys;
+    vector<bool> fromCache(calls.size());
+    if (kvstore) {
+        keys.reserve(calls.size());
+        for (int i = 0; i < calls.size(); i++) {
+            keys.emplace_back(cacheKey(ctx, calls[i]));
+            if (auto cached = kvstore->readStringIfPresent(keys.back())) {
+                outputs[i] = string(*cached);
+                fromCache[i] = true;
+                prodCounterInc("plugin.cache.hit");
+            } else {
+                prodCounterInc("plugin.cache.miss");
+            }
+        }
+    }
+
+    UnorderedMap<string_view, vector<int>> batches;
+    const auto &persistent = ctx.state.dslPersistentPlugins;
+    for (int i = 0; i < calls.size(); i++) {
+        auto &call = calls[i];
+        if (outputs[i]) {
+            continue;
+        }
+        if (absl::c_find(persistent, call.command) != persistent.end()) {
+            batches[call.command].emplace_back(i);
+        } else {
+            outputs[i] = spawnOnce(ctx, call);
+        }
+    }
+    for (auto &[command, indices] : batches) {
+        vector<PluginRequest> requests;
+        requests.reserve(indices.size());
+        for (auto i : indices) {
+            requests.emplace_back(calls[i].request);
+        }
+        auto batchOutputs = PluginServerPool::run(ctx.state.dslRubyExtraArgs, command, requests);
+        for (int j = 0; j < indices.size(); j++) {
+            outputs[indices[j]] = move(batchOutputs[j]);
+        }
+    }
+
+    if (kvstore) {
+        for (int i = 0; i < calls.size(); i++) {
+            // Failures aren't cached: they may not happen on the next run.
+            if (outputs[i] && !fromCache[i]) {
+                newCacheEntries.emplace_back(move(keys[i]), *outputs[i]);
+            }
+        }
+    }
+    return outputs;
+}
+
+} // namespace
+
 pair<unique_ptr<ast::Expression>, vector<shared_ptr<core::File>>>
-SubprocessTextPlugin::run(core::Context ctx, unique_ptr<ast::Expression> tree) {
+SubprocessTextPlugin::run(core::Context ctx, unique_ptr<ast::Expression> tree, const unique_ptr<KeyValueStore> &kvstore,
+                          CacheEntries &newCacheEntries) {
+    vector<shared_ptr<core::File>> subprocessResults;
     if (!ctx.state.hasAnyDslPlugin()) {
-        vector<shared_ptr<core::File>> empty;
-        return {move(tree), empty};
+        return {move(tree), move(subprocessResults)};
     }
     SpawningWalker walker;
-    return {ast::TreeMap::apply(ctx, walker, move(tree)), move(walker.subprocessResults)};
+    tree = ast::TreeMap::apply(ctx, walker, move(tree));
+
+    auto outputs = runCalls(ctx, walker.calls, kvstore, newCacheEntries);
+    for (int i = 0; i < walker.calls.size(); i++) {
+        auto &call = walker.calls[i];
+        auto &output = outputs[i];
+        if (!output) {
+            if (auto e = ctx.state.beginError(call.loc, core::errors::Plugin::SubProcessError)) {
+                e.setHeader("Error while executing subprocess plugin `{}`", call.command);
+            }
+            continue;
+        }
+
+        fmt::memory_buffer generatedSource;
+        format_to(generatedSource, "{}\n{}", call.nestingPrologue, *output);
+        for (int j = 0; j < call.nestingDepth; j++) {
+            format_to(generatedSource, "{}", "end;");
+        }
+
+        auto path = fmt::format("{}//plugin-generated|{}", call.loc.file().data(ctx).path(), subprocessResults.size());
+        auto file = make_shared<core::File>(move(path), fmt::to_string(generatedSource), core::File::Normal);
+        file->pluginGenerated = true;
+        subprocessResults.emplace_back(move(file));
+    }
+    return {move(tree), move(subprocessResults)};
+}
+
+string SubprocessTextPlugin::hashScript(string_view command) {
+    string script;
+    if (FileOps::exists(command)) {
+        script = FileOps::read(command);
+    }
+    auto hashBytes = crypto_hashing::hash64(script);
+    return string((char *)hashBytes.data(), size(hashBytes));
+}
+
+void SubprocessTextPlugin::cacheOutputs(unique_ptr<KeyValueStore> &kvstore, CacheEntries &entries) {
+    if (kvstore) {
+        for (auto &[key, output] : entries) {
+            kvstore->writeString(key, output);
+        }
+    }
+    entries.clear();
 }
 
 }; // namespace sorbet::plugin
@@ -1,13 +1,27 @@
 #ifndef SORBET_PLUGIN_SUBPROCESS_TEXT_H
 #define SORBET_PLUGIN_SUBPROCESS_TEXT_H
 #include "ast/ast.h"
+#include "common/kvstore/KeyValueStore.h"
 
 namespace sorbet::plugin {
 
 class SubprocessTextPlugin final {
 public:
+    // Plugin output that wasn't in the cache yet, as (key, output). Only the thread that owns the KeyValueStore can
+    // write it, so `run` hands it back instead of writing it.
+    using CacheEntries = std::vector<std::pair<std::string, std::string>>;
+
+    // Plugin output only depends on the command, the class, the method and the source of the call, so it is read
+    // from `kvstore` when it has it.
     static std::pair<std::unique_ptr<ast::Expression>, std::vector<std::shared_ptr<core::File>>>
-    run(core::Context ctx, std::unique_ptr<ast::Expression> tree);
+    run(core::Context ctx, std::unique_ptr<ast::Expression> tree, const std::unique_ptr<KeyValueStore> &kvstore,
+        CacheEntries &newCacheEntries);
+
+    static void cacheOutputs(std::unique_ptr<KeyValueStore> &kvstore, CacheEntries &entries);
+
+    // Hashes the script that `command` runs, for `GlobalState::dslPluginScriptHashes`. Editing a script then
+    // invalidates the output cached for its call sites.
+    static std::string hashScript(std::string_view command);
 
     SubprocessTextPlugin() = delete;
 };
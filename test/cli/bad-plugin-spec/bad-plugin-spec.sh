@@ -14,3 +14,5 @@ echo ---
 main/sorbet --dsl-plugins test/cli/bad-plugin-spec/values-not-scalar.yaml -e '' 2>&1
 echo ---
 main/sorbet --dsl-plugins test/cli/bad-plugin-spec/duplicate-triggers.yaml -e '' 2>&1
+echo ---
+main/sorbet --dsl-plugins test/cli/bad-plugin-spec/persistent-plugin-not-a-trigger.yaml -e '' 2>&1
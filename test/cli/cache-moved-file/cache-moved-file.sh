@@ -0,0 +1,24 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+set -e
+
+mkdir "$dir/cache" "$dir/a" "$dir/b"
+cat > "$dir/a/test.rb" <<EOF
+# typed: true
+class A; end
+EOF
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" "$dir/a/test.rb" 2>&1
+
+# Trees are cached by content, so the same file at another path is not parsed again.
+mv "$dir/a/test.rb" "$dir/b/moved.rb"
+main/sorbet --silence-dev-message --cache-dir "$dir/cache" \
+    --metrics-prefix=cache-moved-file --metrics-file="$dir/metrics.json" "$dir/b/moved.rb" 2>&1
+if grep -q "types.input.files.kvstore.hit" "$dir/metrics.json"; then
+    echo "moved file was found in the cache"
+else
+    echo "FAILED: moved file was not found in the cache"
+fi
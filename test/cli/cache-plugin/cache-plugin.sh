@@ -0,0 +1,45 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+set -e
+cp test/cli/cache-plugin/hooks.rb "$dir/hooks.rb"
+cp test/cli/cache-plugin/define_method.rb "$dir/define_method.rb"
+cat > "$dir/triggers.yaml" <<YAML
+triggers:
+  generate: $dir/define_method.rb
+YAML
+
+run() {
+    main/sorbet \
+        --silence-dev-message \
+        --cache-dir "$dir/" \
+        --dsl-plugins "$dir/triggers.yaml" \
+        --metrics-file="$dir/metrics.json" \
+        "$dir/hooks.rb" 2>&1
+    grep -A1 "\"ruby_typer.unknown..plugin.cache" "$dir/metrics.json" || true
+}
+
+echo ------ Nothing cached yet
+run
+
+# Editing the file misses the tree cache, but the output for the call sites
+# that didn't change comes from the cache.
+cat >> "$dir/hooks.rb" <<RUBY
+class A
+  generate :third
+end
+A.new.third
+RUBY
+echo ------ One new call site
+run
+
+# Editing the plugin script misses the cache for every call site. The comment in hooks.rb misses the tree cache, so
+# that the plugin runs at all.
+echo "# A comment" >> "$dir/define_method.rb"
+echo "# A comment" >> "$dir/hooks.rb"
+echo ------ Edited plugin
+run
@@ -0,0 +1,3 @@
+# Defines a method named after the first argument of the call.
+name = ARGV[5][/:(\w+)/, 1]
+puts "def #{name}; end"
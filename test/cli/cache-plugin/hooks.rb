@@ -0,0 +1,11 @@
+# typed: true
+
+class A
+  def self.generate(name); end
+
+  generate :first
+  generate :second
+end
+
+A.new.first
+A.new.second
@@ -0,0 +1,59 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    if [ -n "$daemon" ]; then
+        kill "$daemon"
+        wait "$daemon" 2> /dev/null
+    fi
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+set -e
+cp -r test/cli/daemon/src "$dir/src"
+
+main/sorbet --silence-dev-message --daemon --daemon-socket "$dir/sock" "$dir/src" 2> "$dir/daemon.log" &
+daemon=$!
+# The daemon only listens once it typechecked everything.
+for _ in $(seq 1 600); do
+    if [ -S "$dir/sock" ]; then
+        break
+    fi
+    sleep 0.1
+done
+
+# Runs a typecheck through the daemon, and the same typecheck without it.
+run() {
+    set +e
+    main/sorbet --silence-dev-message --daemon-socket "$dir/sock" "$dir/src" > "$dir/daemon.out" 2>&1
+    echo "exit: $?"
+    main/sorbet --silence-dev-message "$dir/src" > "$dir/local.out" 2>&1
+    set -e
+    tail -n 1 "$dir/daemon.out"
+    diff "$dir/local.out" "$dir/daemon.out" && echo "same as without the daemon"
+}
+
+echo ------ Served from the warm state
+run
+
+echo ------ After an edit
+cat > "$dir/src/lib.rb" <<RUBY
+# typed: true
+class Lib
+  def self.go(x, y=nil); end
+end
+RUBY
+run
+
+echo ------ After adding a file
+cat > "$dir/src/new.rb" <<RUBY
+# typed: true
+Lib.go
+RUBY
+run
+
+# The daemon doesn't typecheck for this one, so it doesn't show up in its log.
+main/sorbet --silence-dev-message --daemon-socket "$dir/sock" --typed=strict "$dir/src" > /dev/null 2>&1 || true
+
+echo ------ Daemon log
+sed "s#$dir/##" "$dir/daemon.log"
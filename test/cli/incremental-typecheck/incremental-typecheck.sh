@@ -0,0 +1,48 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+set -e
+cp test/cli/incremental-typecheck/{lib,use,other,unrelated}.rb "$dir/"
+
+run() {
+    main/sorbet \
+        --silence-dev-message \
+        --cache-dir "$dir/" \
+        --incremental \
+        --metrics-file="$dir/metrics.json" \
+        "${@:2}" \
+        "$dir/lib.rb" "$dir/use.rb" "$dir/other.rb" "$dir/unrelated.rb" 2>&1 | sed "s#$dir/##" > "$dir/$1" || true
+    tail -n 1 "$dir/$1"
+    grep -A1 "\"ruby_typer.unknown..types.input.files.typecheck_cache" "$dir/metrics.json" || true
+}
+
+echo ------ Nothing cached yet
+run first.out
+
+echo ------ Errors are replayed from the cache
+run second.out
+diff "$dir/first.out" "$dir/second.out" && echo "same errors"
+
+# `use.rb` and `other.rb` call the method that changed, so they are typechecked
+# again, even though their own contents didn't change.
+cat > "$dir/lib.rb" <<RUBY
+# typed: true
+class Lib
+  def self.go(x, y=nil); end
+end
+RUBY
+echo ------ A method signature changed
+run third.out
+
+echo ------ A strictness override was added
+printf 'false:\n  - %s\n' "$dir/unrelated.rb" > "$dir/override.yaml"
+run fourth.out --typed-override="$dir/override.yaml"
+
+# The contents of the override file are part of the key, not just its name.
+echo ------ The strictness override changed
+printf 'true:\n  - %s\n' "$dir/unrelated.rb" > "$dir/override.yaml"
+run fifth.out --typed-override="$dir/override.yaml"
@@ -0,0 +1,4 @@
+# typed: true
+class Lib
+  def self.go(x); end
+end
@@ -0,0 +1,6 @@
+# typed: true
+class Other
+  def run
+    Lib.go(1)
+  end
+end
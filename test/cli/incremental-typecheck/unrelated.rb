@@ -0,0 +1,6 @@
+# typed: true
+class Unrelated
+  def run
+    1 + 2
+  end
+end
@@ -0,0 +1,2 @@
+# typed: true
+Lib.go(1, 2)
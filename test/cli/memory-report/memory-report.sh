@@ -0,0 +1,12 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+main/sorbet --silence-dev-message --print=memory-report -e 'class A; def foo; 1; end; end' 2>/dev/null > "$dir/report"
+
+# Sizes change with every platform and allocator, so only look at which rows there are, and that they aren't empty.
+awk '{print $1}' "$dir/report"
+awk '($1 == "symbols" || $1 == "trees" || $1 == "cfgs") && $2 > 0 {print $1, "measured"}' "$dir/report"
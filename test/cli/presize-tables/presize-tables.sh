@@ -0,0 +1,29 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+# Far more names per byte than real code has, so that the first run's prediction falls short.
+for i in $(seq 1 30000); do
+    echo "def method_$i; end"
+done > "$dir/many_names.rb"
+
+run() {
+    main/sorbet --silence-dev-message --cache-dir "$dir/" --metrics-file="$dir/metrics.json" "$dir/many_names.rb" 2>&1
+    if grep -q "\"ruby_typer.unknown..names.resizes\"" "$dir/metrics.json"; then
+        echo "resized the name table"
+    else
+        echo "didn't resize the name table"
+    fi
+    grep -c "\"ruby_typer.unknown..names.resizes_avoided\"" "$dir/metrics.json"
+}
+
+echo ------ Nothing cached yet
+run
+
+echo "def one_more; end" >> "$dir/many_names.rb"
+
+echo ------ Sized from the previous run
+run
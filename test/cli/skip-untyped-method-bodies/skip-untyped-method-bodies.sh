@@ -0,0 +1,8 @@
+#!/bin/bash
+
+# The body of `greet` is never looked at, so the constant in it is not reported, but the method itself is still
+# defined, with its arguments.
+main/sorbet --silence-dev-message --skip-untyped-method-bodies \
+    test/cli/skip-untyped-method-bodies/untyped.rb test/cli/skip-untyped-method-bodies/typed.rb 2>&1
+
+main/sorbet --silence-dev-message --skip-untyped-method-bodies --lsp --disable-watchman . 2>&1
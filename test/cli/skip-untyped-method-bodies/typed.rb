@@ -0,0 +1,2 @@
+# typed: true
+Untyped.new.greet
@@ -0,0 +1,10 @@
+# typed: false
+class Untyped
+  def initialize
+    @count = 0
+  end
+
+  def greet(name)
+    NotDefinedAnywhere.new(name)
+  end
+end
@@ -0,0 +1,26 @@
+# Speaks the persistent plugin protocol from plugin/PluginServer.h. Answers every
+# call with the lines echo_argv.rb prints, plus which call of which batch it was,
+# which shows that one process handled all of them.
+abort 'only runs as a persistent plugin' unless ARGV == ['--server']
+
+def read_field
+  length = Integer(STDIN.gets)
+  STDIN.read(length)
+end
+
+STDOUT.binmode
+batch = 0
+while (header = STDIN.gets)
+  batch += 1
+  Integer(header).times do |call|
+    klass = read_field
+    method = read_field
+    source = read_field
+    output = "# batch #{batch}, call #{call + 1}\n"
+    ['--class', klass, '--method', method, '--source', source].each do |arg|
+      output << arg.inspect << "\n"
+    end
+    STDOUT.write("#{output.bytesize}\n#{output}")
+  end
+  STDOUT.flush
+end
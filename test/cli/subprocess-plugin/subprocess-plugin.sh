@@ -15,3 +15,5 @@ main/sorbet --silence-dev-message --dsl-plugins test/cli/subprocess-plugin/bad_p
 echo ------ Bad plugin output on many files
 main/sorbet --silence-dev-message --dsl-plugins test/cli/subprocess-plugin/bad_plugin.yaml test/cli/subprocess-plugin/trigger_bad_plugin.rb a b c d e f 2>&1 \
   | grep 'Parse Error: unexpected token: syntax error'
+echo ------ Persistent plugin server
+main/sorbet --silence-dev-message --dsl-plugins test/cli/subprocess-plugin/server_echo.yaml --print plugin-generated-code test/cli/subprocess-plugin/permute.rb
@@ -0,0 +1,5 @@
+# typed: true
+class A
+  def self.go(x); end
+end
+A.go(1, 2)
@@ -0,0 +1,6 @@
+# typed: true
+class B
+  def run
+    A.go
+  end
+end
@@ -0,0 +1,4 @@
+# typed: strict
+class C
+  def untyped; end
+end
@@ -0,0 +1,24 @@
+#!/bin/bash
+dir=$(mktemp -d)
+cleanup() {
+    rm -r "$dir"
+}
+trap cleanup EXIT
+
+files=(test/cli/typecheck-processes/{a,b,c}.rb)
+main/sorbet --silence-dev-message "${files[@]}" > "$dir/threads.out" 2>&1
+echo "exit with threads: $?"
+main/sorbet --silence-dev-message --typecheck-processes=2 \
+    --metrics-file="$dir/metrics.json" "${files[@]}" > "$dir/processes.out" 2>&1
+echo "exit with processes: $?"
+tail -n 1 "$dir/processes.out"
+
+# Files are typechecked in a different order, so errors may be, too.
+diff <(sort "$dir/threads.out") <(sort "$dir/processes.out") && echo "same errors"
+
+# Counters of the typecheck processes make it back.
+grep -A1 "\"ruby_typer.unknown..types.typecheck.processes\"" "$dir/metrics.json"
+grep -c "\"ruby_typer.unknown..types.input.methods.typechecked\"" "$dir/metrics.json"
+
+echo ------ Incompatible options
+main/sorbet --silence-dev-message --typecheck-processes=2 --autocorrect "${files[@]}" 2>&1
@@ -171,6 +171,98 @@ TEST(PreOrderTreeMap, CountTrees) { // NOLINT
     EXPECT_EQ(c.count, 3);
 }
 
+TEST(TreeWalk, VisitsInOrderWithOwners) { // NOLINT
+    class Recorder {
+    public:
+        vector<pair<string, core::SymbolRef>> visits;
+        void preWalkClassDef(core::Context ctx, const ast::ClassDef &original) {
+            visits.emplace_back("pre ClassDef", ctx.owner);
+        }
+        void preWalkMethodDef(core::Context ctx, const ast::MethodDef &original) {
+            visits.emplace_back("pre MethodDef", ctx.owner);
+        }
+        void postWalkLocal(core::Context ctx, const ast::Local &original) {
+            visits.emplace_back("post Local", ctx.owner);
+        }
+        void postWalkLiteral(core::Context ctx, const ast::Literal &original) {
+            visits.emplace_back("post Literal", ctx.owner);
+        }
+        void postWalkMethodDef(core::Context ctx, const ast::MethodDef &original) {
+            visits.emplace_back("post MethodDef", ctx.owner);
+        }
+    };
+
+    sorbet::core::GlobalState cb(errorQueue);
+    cb.initEmpty();
+    sorbet::core::Loc loc(sorbet::core::FileRef(), 42, 91);
+    sorbet::core::UnfreezeNameTable nt(cb);
+    sorbet::core::UnfreezeSymbolTable st(cb);
+
+    auto name = cb.enterNameUTF8("foo");
+    auto classSym = cb.enterClassSymbol(loc, sorbet::core::Symbols::root(), cb.enterNameConstant("Foo"));
+    auto methodSym = cb.enterMethodSymbol(loc, classSym, name);
+
+    ast::MethodDef::ARGS_store args;
+    args.emplace_back(make_unique<ast::Local>(loc, core::LocalVariable(name, 0)));
+    ast::ClassDef::RHS_store classrhs;
+    classrhs.emplace_back(
+        make_unique<ast::MethodDef>(loc, loc, methodSym, name, std::move(args), ast::MK::Int(loc, 5), false));
+    unique_ptr<ast::Expression> tree = make_unique<ast::ClassDef>(
+        loc, loc, classSym, make_unique<ast::UnresolvedConstantLit>(loc, make_unique<ast::EmptyTree>(), name),
+        ast::ClassDef::ANCESTORS_store(), std::move(classrhs), ast::ClassDefKind::Class);
+
+    Recorder r;
+    ast::TreeWalk::apply(core::Context(cb, core::Symbols::root()), r, tree.get());
+    vector<pair<string, core::SymbolRef>> expected{{"pre ClassDef", core::Symbols::root()},
+                                                   {"pre MethodDef", classSym},
+                                                   {"post Local", methodSym},
+                                                   {"post Literal", methodSym},
+                                                   {"post MethodDef", classSym}};
+    EXPECT_EQ(r.visits, expected);
+}
+
+TEST(FusedTransform, NestsHooksOfBothPasses) { // NOLINT
+    class Pass {
+    public:
+        string name;
+        vector<string> &visits;
+        Pass(string name, vector<string> &visits) : name(name), visits(visits) {}
+
+        unique_ptr<ast::MethodDef> preTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> original) {
+            visits.emplace_back("pre " + name);
+            return original;
+        }
+        unique_ptr<ast::Expression> postTransformLiteral(core::Context ctx, unique_ptr<ast::Literal> original) {
+            visits.emplace_back("literal " + name);
+            return original;
+        }
+        unique_ptr<ast::Expression> postTransformMethodDef(core::Context ctx, unique_ptr<ast::MethodDef> original) {
+            visits.emplace_back("post " + name);
+            return original;
+        }
+    };
+
+    sorbet::core::GlobalState cb(errorQueue);
+    cb.initEmpty();
+    sorbet::core::Loc loc(sorbet::core::FileRef(), 42, 91);
+    sorbet::core::UnfreezeNameTable nt(cb);
+    sorbet::core::UnfreezeSymbolTable st(cb);
+
+    auto name = cb.enterNameUTF8("foo");
+    auto methodSym = cb.enterMethodSymbol(loc, core::Symbols::Object(), name);
+    unique_ptr<ast::Expression> tree = make_unique<ast::MethodDef>(
+        loc, loc, methodSym, name, ast::MethodDef::ARGS_store(), ast::MK::Int(loc, 5), false);
+
+    vector<string> visits;
+    Pass first("first", visits);
+    Pass second("second", visits);
+    ast::FusedTransform<Pass, Pass, core::Context> fused(first, second);
+    tree = ast::TreeMap::apply(core::Context(cb, core::Symbols::root()), fused, std::move(tree));
+    EXPECT_EQ(visits, (vector<string>{"pre first", "pre second", "literal second", "literal first", "post second",
+                                      "post first"}));
+    EXPECT_EQ(fused.nodes, 2);
+}
+
 TEST(PayloadTests, CloneSubstitutePayload) {
     auto logger = spd::stderr_color_mt("ClonePayload");
     auto errorQueue = make_shared<sorbet::core::ErrorQueue>(*logger, *logger);
@@ -192,4 +284,31 @@ TEST(PayloadTests, CloneSubstitutePayload) {
     ASSERT_EQ(c1->symbolsUsed(), c2->symbolsUsed());
     ASSERT_EQ(c1->symbolsUsed(), gs.symbolsUsed());
 }
+
+TEST(PayloadTests, CompactNames) {
+    auto logger = spd::stderr_color_mt("CompactNames");
+    auto errorQueue = make_shared<sorbet::core::ErrorQueue>(*logger, *logger);
+
+    sorbet::core::GlobalState gs(errorQueue);
+    sorbet::core::serialize::Serializer::loadGlobalState(gs, getNameTablePayload);
+    auto firstCollectable = gs.namesUsed();
+
+    sorbet::core::NameRef dead, live;
+    {
+        sorbet::core::UnfreezeNameTable thaw(gs);
+        dead = gs.enterNameUTF8("dead name");
+        live = gs.enterNameConstant(gs.enterNameUTF8("LiveName"));
+    }
+
+    vector<bool> used(gs.namesUsed());
+    used[live.id()] = true;
+    vector<sorbet::core::NameRef> substitution;
+    auto compacted = gs.compactNames(firstCollectable, move(used), substitution);
+
+    sorbet::core::GlobalSubstitution subst(move(substitution), *compacted);
+    ASSERT_EQ(gs.namesUsed() - 1, compacted->namesUsed());
+    ASSERT_FALSE(subst.substitute(dead).exists());
+    ASSERT_EQ("<C <U LiveName>>", subst.substitute(live).showRaw(*compacted));
+    ASSERT_EQ(sorbet::core::Names::initialize(), subst.substitute(sorbet::core::Names::initialize()));
+}
 } // namespace sorbet
@@ -150,6 +150,33 @@ TEST_F(ProtocolTest, MergeDidChangeAfterCancellation) {
     EXPECT_EQ(diagnosticCount, 1) << "Expected a diagnostic error for foo.rb";
 }
 
+// Reports the syntax errors of a file that was indexed by a slow path that got canceled.
+TEST_F(ProtocolTest, ReportsIndexingErrorsOfCanceledSlowPath) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("foo.rb", "# typed: true\nclass Foo\nend\n")), {});
+
+    lspWrapper->cancelSlowPathsOfNextRequest();
+    assertDiagnostics(send(*openFile("bar.rb", "# typed: true\n1j\n")), {});
+
+    assertDiagnostics(send(*changeFile("foo.rb", "# typed: true\nclass Foo\n  def foo; end\nend\n", 2)),
+                      {{"bar.rb", 1, "unexpected token"}});
+}
+
+// Fast paths index files against a copy of the name table, which compacting the real one must not mix up.
+TEST_F(ProtocolTest, CompactsNamesAfterFastPath) {
+    assertDiagnostics(initializeLSP(), {});
+    assertDiagnostics(send(*openFile("foo.rb", "# typed: true\nclass Foo\n  def foo\n    1\n  end\nend\n")), {});
+    assertDiagnostics(
+        send(*changeFile("foo.rb", "# typed: true\nclass Foo\n  def foo\n    1.brand_new_method\n  end\nend\n", 2)),
+        {{"foo.rb", 3, "Method `brand_new_method` does not exist"}});
+
+    // A new file takes the slow path.
+    lspWrapper->compactNamesOnNextSlowPath();
+    assertDiagnostics(send(*openFile("bar.rb", "# typed: true\nclass Bar\n  def bar\n    1.other\n  end\nend\n")),
+                      {{"foo.rb", 3, "Method `brand_new_method` does not exist"},
+                       {"bar.rb", 3, "Method `other` does not exist"}});
+}
+
 // Applies all consecutive file changes at once.
 TEST_F(ProtocolTest, MergesDidChangesAcrossFiles) {
     assertDiagnostics(initializeLSP(), {});
@@ -1,11 +1,32 @@
 #include <ruby_parser/capi.hh>
 #include <cstdio>
 
+namespace {
+
+struct padded_source {
+	std::string source;
+
+	padded_source(const char* source_ptr, size_t source_length)
+		: source(source_ptr, source_length) {
+		source.append("\0\0", 2);
+	}
+};
+
+// The lexer borrows its source, and callers of the C API don't keep theirs,
+// so these drivers own a copy. `padded_source` is initialized first.
+class owning_typedruby25 : private padded_source, public ruby_parser::typedruby25 {
+public:
+	owning_typedruby25(const char* source_ptr, size_t source_length, const ruby_parser::builder& builder)
+		: padded_source(source_ptr, source_length),
+		typedruby25(std::string_view(source.data(), source_length), builder) {}
+};
+
+}
+
 ruby_parser::typedruby25*
 rbdriver_typedruby25_new(const char* source_ptr, size_t source_length, const ruby_parser::builder* builder)
 {
-	std::string source { source_ptr, source_length };
-	return new ruby_parser::typedruby25(source, *builder);
+	return new owning_typedruby25(source_ptr, source_length, *builder);
 }
 
 void
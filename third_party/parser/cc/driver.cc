@@ -6,7 +6,7 @@
 
 namespace ruby_parser {
 
-base_driver::base_driver(ruby_version version, const std::string& source, const struct builder& builder)
+base_driver::base_driver(ruby_version version, std::string_view source, const struct builder& builder)
 	: build(builder),
 	lex(diagnostics, version, source),
 	pending_error(false),
@@ -15,7 +15,7 @@ base_driver::base_driver(ruby_version version, const std::string& source, const
 {
 }
 
-typedruby25::typedruby25(const std::string& source, const struct builder& builder)
+typedruby25::typedruby25(std::string_view source, const struct builder& builder)
 	: base_driver(ruby_version::RUBY_25, source, builder)
 {}
 
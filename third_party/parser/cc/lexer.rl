@@ -111,6 +111,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <ruby_parser/driver.hh>
 #include <cassert>
+#include <functional>
 #include "absl/strings/numbers.h"
 
 %% write data nofinal;
@@ -120,10 +121,10 @@ using namespace std::string_literals;
 
 %% prepush { check_stack_capacity(); }
 
-lexer::lexer(diagnostics_t &diag, ruby_version version, const std::string& source_buffer_)
+lexer::lexer(diagnostics_t &diag, ruby_version version, std::string_view source_buffer_)
   : diagnostics(diag)
   , version(version)
-  , source_buffer(source_buffer_ + std::string("\0\0", 2))
+  , source_buffer(source_buffer_.data(), source_buffer_.size() + 2)
   , cs(lex_en_line_begin)
   , _p(source_buffer.data())
   , _pe(source_buffer.data() + source_buffer.size())
@@ -148,6 +149,8 @@ lexer::lexer(diagnostics_t &diag, ruby_version version, const std::string& sourc
   // check_stack_capacity:
   stack.resize(16);
 
+  assert(source_buffer[source_buffer.size() - 2] == '\0' && source_buffer[source_buffer.size() - 1] == '\0');
+
   static_env.push(environment());
 }
 
@@ -189,6 +192,25 @@ std::string lexer::tok(const char* start, const char* end) {
   return std::string(start, (size_t)(end - start));
 }
 
+std::string_view lexer::tok_view() const {
+  return tok_view(ts, te);
+}
+
+std::string_view lexer::tok_view(const char* start, const char* end) const {
+  assert(start <= end);
+
+  return std::string_view(start, (size_t)(end - start));
+}
+
+std::string_view lexer::intern(std::string_view str) {
+  std::less<const char*> before;
+  if (!before(str.data(), source_buffer.data()) &&
+      !before(source_buffer.data() + source_buffer.size(), str.data() + str.size())) {
+    return str;
+  }
+  return owned_strings.emplace_back(str);
+}
+
 char lexer::unescape(uint32_t codepoint) {
     switch (codepoint) {
     case 'a': return '\a';
@@ -457,25 +479,25 @@ token_t lexer::advance_() {
 
   if (cs == lex_error) {
     size_t start = (size_t)(p - source_buffer.data());
-    return mempool.alloc(token_type::error, start, start + 1, std::string(p - 1, 1));
+    return mempool.alloc(token_type::error, start, start + 1, tok_view(p - 1, p));
   }
 
   return mempool.alloc(token_type::eof, source_buffer.size(), source_buffer.size(), "");
 }
 
 void lexer::emit(token_type type) {
-  emit(type, tok());
+  emit(type, tok_view());
 }
 
-void lexer::emit(token_type type, const std::string& str) {
+void lexer::emit(token_type type, std::string_view str) {
   emit(type, str, ts, te);
 }
 
-void lexer::emit(token_type type, const std::string& str, const char* start, const char* end) {
+void lexer::emit(token_type type, std::string_view str, const char* start, const char* end) {
   size_t offset_start = (size_t)(start - source_buffer.data());
   size_t offset_end = (size_t)(end - source_buffer.data());
 
-  token_queue.push(mempool.alloc(type, offset_start, offset_end, str));
+  token_queue.push(mempool.alloc(type, offset_start, offset_end, intern(str)));
 }
 
 void lexer::emit_do(bool do_block) {
@@ -489,7 +511,7 @@ void lexer::emit_do(bool do_block) {
 }
 
 void lexer::emit_table(const token_table_entry* table) {
-  auto value = tok();
+  auto value = tok_view();
 
   for (; table->token; ++table) {
     if (value == table->token) {
@@ -1430,7 +1452,7 @@ void lexer::set_state_expr_value() {
 
   # Ruby is context-sensitive wrt/ local identifiers.
   action local_ident {
-    auto ident = tok();
+    auto ident = tok_view();
 
     emit(token_type::tIDENTIFIER, ident);
 
@@ -2598,11 +2620,11 @@ void lexer::unextend() {
   static_env.pop();
 }
 
-void lexer::declare(const std::string& name) {
-  static_env.top().insert(name);
+void lexer::declare(std::string_view name) {
+  static_env.top().insert(intern(name));
 }
 
-bool lexer::is_declared(const std::string& identifier) const {
+bool lexer::is_declared(std::string_view identifier) const {
   const environment& env = static_env.top();
 
   return env.find(identifier) != env.end();
@@ -134,7 +134,8 @@ public:
 	size_t def_level;
 	ForeignPtr ast;
 
-	base_driver(ruby_version version, const std::string& source, const struct builder& builder);
+	// See `lexer::lexer` for what `source` must look like.
+	base_driver(ruby_version version, std::string_view source, const struct builder& builder);
 	virtual ~base_driver() {}
 	virtual ForeignPtr parse(SelfPtr self) = 0;
 
@@ -161,7 +162,7 @@ public:
 
 class typedruby25 : public base_driver {
 public:
-	typedruby25(const std::string& source, const struct builder& builder);
+	typedruby25(std::string_view source, const struct builder& builder);
 	virtual ForeignPtr parse(SelfPtr self);
 	~typedruby25() {}
 };
@@ -2,6 +2,8 @@
 #define RUBY_PARSER_LEXER_HH
 
 #include <string>
+#include <string_view>
+#include <deque>
 #include <stack>
 #include <queue>
 #include <set>
@@ -9,6 +11,8 @@
 #include <map>
 #include <optional>
 
+#include "absl/container/flat_hash_set.h"
+
 #include "diagnostic.hh"
 #include "literal.hh"
 #include "token.hh"
@@ -30,7 +34,8 @@ namespace ruby_parser {
 
   class lexer {
   public:
-    using environment = std::set<std::string>;
+    // Names in an environment view token strings, which live as long as the lexer.
+    using environment = absl::flat_hash_set<std::string_view>;
     struct token_table_entry {
         const char* token;
         token_type type;
@@ -50,7 +55,11 @@ namespace ruby_parser {
 	pool<token, 64> mempool;
 
     ruby_version version;
-    const std::string source_buffer;
+    // Borrowed from the caller, including the two NULs that end it.
+    std::string_view source_buffer;
+    // Token strings that aren't a slice of the source, e.g. unescaped
+    // string contents. A deque, so that they never move.
+    std::deque<std::string> owned_strings;
 
     std::stack<environment> static_env;
     std::stack<literal> literal_stack;
@@ -106,9 +115,12 @@ namespace ruby_parser {
     std::string tok();
     std::string tok(const char* start);
     std::string tok(const char* start, const char* end);
+    std::string_view tok_view() const;
+    std::string_view tok_view(const char* start, const char* end) const;
+    std::string_view intern(std::string_view str);
     void emit(token_type type);
-    void emit(token_type type, const std::string& str);
-    void emit(token_type type, const std::string& str, const char* start, const char* end);
+    void emit(token_type type, std::string_view str);
+    void emit(token_type type, std::string_view str, const char* start, const char* end);
     void emit_do(bool do_block = false);
     void emit_table(const token_table_entry* table);
     void emit_num(const std::string& num);
@@ -134,7 +146,10 @@ namespace ruby_parser {
 
     bool in_kwarg;            // true at the end of "def foo a:"
 
-    lexer(diagnostics_t &diag, ruby_version version, const std::string& source_buffer_);
+    // `source_buffer_` is lexed in place, so it must outlive the lexer and
+    // be followed by two NULs in memory, which the lexer reads as the end
+    // of input.
+    lexer(diagnostics_t &diag, ruby_version version, std::string_view source_buffer_);
 
     token_t advance();
 
@@ -146,8 +161,8 @@ namespace ruby_parser {
     void extend_static();
     void extend_dynamic();
     void unextend();
-    void declare(const std::string& name);
-    bool is_declared(const std::string& identifier) const;
+    void declare(std::string_view name);
+    bool is_declared(std::string_view identifier) const;
 
     optional_size dedentLevel();
   };
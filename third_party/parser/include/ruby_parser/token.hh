@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <string>
+#include <string_view>
 #include <memory>
 
 // these token values are mirrored in src/grammars/*.y
@@ -168,15 +169,17 @@ namespace ruby_parser {
     token_type _type;
     size_t _start;
     size_t _end;
-    std::string _string;
+    // Views either the lexer's source buffer or a string the lexer owns,
+    // so it is valid for as long as the lexer is.
+    std::string_view _string;
 
   public:
-    token(token_type type, size_t start, size_t end, const std::string& str);
+    token(token_type type, size_t start, size_t end, std::string_view str);
 
     token_type type() const;
     size_t start() const;
     size_t end() const;
-    const std::string& string() const;
+    std::string_view string() const;
   };
 
   using token_t = token*;